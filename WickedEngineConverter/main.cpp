@@ -0,0 +1,33 @@
+#include "stdafx.h"
+#include "SceneConverter.h"
+#include "GraphicsDevice_Null.h"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+using namespace std;
+
+// The packages are opened by the editor, they carry its version
+int __editorVersion = 0;
+
+// Command line converter, see SceneConverter.h for the arguments
+//	Only the serialization code is built in: no window is created and the engine gets a null device, the
+//	textures of the materials are not read.
+int main(int argc, char* argv[])
+{
+	vector<string> arguments(argv + 1, argv + argc);
+	SceneConverter::Options options;
+	if (!SceneConverter::ParseArguments(arguments, options))
+	{
+		printf("WickedEngineConverter -convert <files or directories...> [-out <directory>] [-threads <count>] [-dedup] [-optimize] [-lods] [-levels <count>]\n");
+		printf("WickedEngineConverter -validate <files or directories...> [-threads <count>]\n");
+		printf("WickedEngineConverter -lodbench <files or directories...> [-threads <count>] [-levels <count>]\n");
+		return 1;
+	}
+
+	GraphicsDevice_Null* device = GraphicsDevice_Null::Install();
+	int result = SceneConverter::Run(options);
+	printf("%u texture files not read, %u resources created on the null device\n", device->GetCount(GraphicsDevice_Null::COUNTER_TEXTUREFILE), device->GetCount(GraphicsDevice_Null::COUNTER_CREATE));
+	return result;
+}
@@ -0,0 +1,87 @@
+#include "stdafx.h"
+#include "AtlasPacker.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace DirectX;
+
+
+AtlasPacker::AtlasPacker(uint32_t pageSize, uint32_t padding) :pageSize(pageSize), padding(padding)
+{
+}
+
+bool AtlasPacker::Place(vector<Shelf>& shelves, uint32_t width, uint32_t height, Rect& rect) const
+{
+	for (auto& x : shelves)
+	{
+		if (height <= x.height && x.used + width <= pageSize)
+		{
+			rect.x = x.used;
+			rect.y = x.y;
+			x.used += width;
+			return true;
+		}
+	}
+	uint32_t bottom = shelves.empty() ? 0 : shelves.back().y + shelves.back().height;
+	if (bottom + height > pageSize)
+	{
+		return false;
+	}
+	Shelf shelf;
+	shelf.y = bottom;
+	shelf.height = height;
+	shelf.used = width;
+	shelves.push_back(shelf);
+	rect.x = 0;
+	rect.y = bottom;
+	return true;
+}
+
+bool AtlasPacker::Pack(const vector<pair<uint32_t, uint32_t>>& sizes, vector<Rect>& rects)
+{
+	pages.clear();
+	rects.assign(sizes.size(), Rect());
+
+	vector<size_t> order(sizes.size());
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		order[i] = i;
+		if (sizes[i].first + padding > pageSize || sizes[i].second + padding > pageSize)
+		{
+			return false;
+		}
+	}
+	stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return sizes[a].second != sizes[b].second ? sizes[a].second > sizes[b].second : sizes[a].first > sizes[b].first;
+	});
+
+	for (auto& i : order)
+	{
+		// the padding is part of the space taken, not of the rectangle
+		uint32_t width = sizes[i].first + padding;
+		uint32_t height = sizes[i].second + padding;
+		Rect& rect = rects[i];
+		rect.width = sizes[i].first;
+		rect.height = sizes[i].second;
+		bool placed = false;
+		for (size_t p = 0; p < pages.size() && !placed; ++p)
+		{
+			placed = Place(pages[p], width, height, rect);
+			rect.page = (uint32_t)p;
+		}
+		if (!placed)
+		{
+			pages.push_back(vector<Shelf>());
+			Place(pages.back(), width, height, rect);
+			rect.page = (uint32_t)pages.size() - 1;
+		}
+	}
+	return true;
+}
+
+XMFLOAT4 AtlasPacker::GetUV(const Rect& rect) const
+{
+	float scale = 1.0f / (float)pageSize;
+	return XMFLOAT4(rect.x * scale, rect.y * scale, rect.width * scale, rect.height * scale);
+}
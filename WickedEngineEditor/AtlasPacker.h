@@ -0,0 +1,47 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// Shelf packing of rectangles into square atlas pages
+//	The rectangles are placed tallest first, each on the first shelf of the first page with room left.
+//	A new shelf is opened under the last one of a page, and a new page when no page has room for one.
+//	Impostors are all about the same size, so the shelves stay nearly full.
+class AtlasPacker
+{
+public:
+	struct Rect
+	{
+		uint32_t page;
+		uint32_t x, y;
+		uint32_t width, height;
+	};
+
+private:
+	struct Shelf
+	{
+		uint32_t y, height;
+		uint32_t used;	// width taken on the shelf
+	};
+
+	uint32_t pageSize, padding;
+	std::vector<std::vector<Shelf>> pages;
+
+	bool Place(std::vector<Shelf>& shelves, uint32_t width, uint32_t height, Rect& rect) const;
+
+public:
+	// padding texels are kept free to the right of and under every rectangle, so that filtering doesn't
+	//	bleed between neighbours
+	AtlasPacker(uint32_t pageSize = 4096, uint32_t padding = 2);
+
+	// Packs sizes (width, height) into new pages, rects[i] is where sizes[i] goes. Returns false if a
+	//	size is bigger than a page.
+	bool Pack(const std::vector<std::pair<uint32_t, uint32_t>>& sizes, std::vector<Rect>& rects);
+
+	uint32_t GetPageSize() const { return pageSize; }
+	uint32_t GetPageCount() const { return (uint32_t)pages.size(); }
+	// Offset (x, y) and scale (z, w) of the rectangle in the texture coordinates of its page
+	DirectX::XMFLOAT4 GetUV(const Rect& rect) const;
+};
@@ -0,0 +1,222 @@
+#include "stdafx.h"
+#include "BakeCache.h"
+#include "MeshLODs.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+using namespace std;
+
+BakeCache* BakeCache::instance = nullptr;
+
+BakeCache* BakeCache::GetInstance()
+{
+	if (instance == nullptr)
+	{
+		instance = new BakeCache;
+	}
+	return instance;
+}
+
+uint64_t BakeCache::GetMaterialHash(const Material* material) const
+{
+	if (material == nullptr)
+	{
+		return 0;
+	}
+
+	// Everything that ends up in the shaders, the name is left out
+	uint64_t hash = Hash(&material->baseColor, sizeof(material->baseColor));
+	hash = Hash(&material->alpha, sizeof(material->alpha), hash);
+	hash = Hash(&material->roughness, sizeof(material->roughness), hash);
+	hash = Hash(&material->metalness, sizeof(material->metalness), hash);
+	hash = Hash(&material->reflectance, sizeof(material->reflectance), hash);
+	hash = Hash(&material->emissive, sizeof(material->emissive), hash);
+	hash = Hash(&material->refractionIndex, sizeof(material->refractionIndex), hash);
+	hash = Hash(&material->subsurfaceScattering, sizeof(material->subsurfaceScattering), hash);
+	hash = Hash(&material->normalMapStrength, sizeof(material->normalMapStrength), hash);
+	hash = Hash(&material->parallaxOcclusionMapping, sizeof(material->parallaxOcclusionMapping), hash);
+	hash = Hash(&material->planar_reflections, sizeof(material->planar_reflections), hash);
+	hash = Hash(&material->water, sizeof(material->water), hash);
+	hash = Hash(material->textureName.data(), material->textureName.size(), hash);
+	hash = Hash(material->normalMapName.data(), material->normalMapName.size(), hash);
+	hash = Hash(material->surfaceMapName.data(), material->surfaceMapName.size(), hash);
+	hash = Hash(material->displacementMapName.data(), material->displacementMapName.size(), hash);
+	return hash;
+}
+
+uint64_t BakeCache::GetGeometryHash(const Mesh* mesh)
+{
+	auto it = geometryHashes.find(mesh);
+	if (it != geometryHashes.end())
+	{
+		return it->second;
+	}
+
+	// The indices of the full detail, whatever LOD is shown right now
+	uint64_t hash = Hash(mesh->vertices.data(), mesh->vertices.size() * sizeof(mesh->vertices[0]));
+	const MeshLODs::Chain* chain = MeshLODs::GetInstance()->Get(mesh);
+	if (chain != nullptr)
+	{
+		for (auto& x : chain->levels[0].subsetIndices)
+		{
+			hash = Hash(x.data(), x.size() * sizeof(x[0]), hash);
+		}
+	}
+	else
+	{
+		for (auto& x : mesh->subsets)
+		{
+			hash = Hash(x.subsetIndices.data(), x.subsetIndices.size() * sizeof(x.subsetIndices[0]), hash);
+		}
+	}
+	geometryHashes[mesh] = hash;
+	return hash;
+}
+void BakeCache::InvalidateGeometry(const Mesh* mesh)
+{
+	geometryHashes.erase(mesh);
+}
+
+uint64_t BakeCache::GetSceneHash()
+{
+	uint64_t hash = Hash(nullptr, 0);
+	for (auto& x : wiRenderer::GetScene().models)
+	{
+		for (auto& y : x->objects)
+		{
+			hash = Hash(&y->world, sizeof(y->world), hash);
+			if (y->mesh != nullptr)
+			{
+				uint64_t meshKey = GetImpostorKey(y->mesh);
+				hash = Hash(&meshKey, sizeof(meshKey), hash);
+			}
+		}
+		for (auto& y : x->lights)
+		{
+			hash = Hash(&y->world, sizeof(y->world), hash);
+			hash = Hash(&y->color, sizeof(y->color), hash);
+			hash = Hash(&y->enerDis, sizeof(y->enerDis), hash);
+			hash = Hash(&y->type, sizeof(y->type), hash);
+		}
+	}
+	return hash;
+}
+
+uint64_t BakeCache::GetProbeKey(const XMFLOAT3& position, int resolution)
+{
+	uint64_t hash = GetSceneHash();
+	hash = Hash(&position, sizeof(position), hash);
+	hash = Hash(&resolution, sizeof(resolution), hash);
+	return hash;
+}
+// Geometry and materials, the probes use it for the meshes too
+uint64_t BakeCache::GetImpostorKey(const Mesh* mesh)
+{
+	uint64_t hash = GetGeometryHash(mesh);
+	for (auto& x : mesh->subsets)
+	{
+		uint64_t materialHash = GetMaterialHash(x.material);
+		hash = Hash(&materialHash, sizeof(materialHash), hash);
+	}
+	return hash;
+}
+
+void BakeCache::SetBaked(const void* entity, uint64_t key, int resolution)
+{
+	Baked entry;
+	entry.key = key;
+	entry.resolution = resolution;
+	baked[entity] = entry;
+}
+bool BakeCache::IsUpToDate(const void* entity, uint64_t key) const
+{
+	auto it = baked.find(entity);
+	return it != baked.end() && it->second.key == key;
+}
+int BakeCache::GetResolution(const void* entity) const
+{
+	auto it = baked.find(entity);
+	return it != baked.end() ? it->second.resolution : 0;
+}
+void BakeCache::Forget(const void* entity)
+{
+	baked.erase(entity);
+}
+void BakeCache::Clear()
+{
+	baked.clear();
+	geometryHashes.clear();
+}
+
+bool BakeCache::WriteManifest(const string& fileName) const
+{
+	stringstream ss("");
+	ss << setprecision(9);
+	for (auto& x : wiRenderer::GetScene().models)
+	{
+		for (auto& y : x->environmentProbes)
+		{
+			auto it = baked.find(y);
+			if (it != baked.end())
+			{
+				ss << "probe " << y->translation.x << " " << y->translation.y << " " << y->translation.z << " " << it->second.resolution << endl;
+			}
+		}
+		for (auto& y : x->meshes)
+		{
+			if (baked.find(y.second) != baked.end())
+			{
+				ss << "impostor " << y.second->name << endl;
+			}
+		}
+	}
+
+	if (ss.str().empty())
+	{
+		// A stale manifest of an earlier save would bring back bakes that were removed since
+		remove(fileName.c_str());
+		return true;
+	}
+	ofstream file(fileName, ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	file << ss.str();
+	return file.good();
+}
+bool BakeCache::ReadManifest(const string& fileName, vector<ManifestEntry>& entries)
+{
+	ifstream file(fileName);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	string text;
+	while (getline(file, text))
+	{
+		stringstream ss(text);
+		string kind;
+		ManifestEntry entry;
+		entry.position = XMFLOAT3(0, 0, 0);
+		entry.resolution = 0;
+		if (!(ss >> kind))
+		{
+			continue;
+		}
+		if (kind == "probe" && (ss >> entry.position.x >> entry.position.y >> entry.position.z >> entry.resolution))
+		{
+			entry.kind = KIND_PROBE;
+			entries.push_back(entry);
+		}
+		else if (kind == "impostor" && getline(ss >> ws, entry.meshName))
+		{
+			entry.kind = KIND_IMPOSTOR;
+			entries.push_back(entry);
+		}
+	}
+	return true;
+}
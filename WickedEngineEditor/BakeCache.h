@@ -0,0 +1,80 @@
+#pragma once
+#include "WickedEngine.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Keys of the baked data of the scene (environment probes, impostors)
+//	A key is a hash of everything the bake reads, a bake is stale when the key of its inputs changed
+//	since it was made. Geometry is hashed once per mesh and cached, materials, transforms and lights are
+//	hashed every time, so editing a material makes exactly the bakes that read it stale: the impostors of
+//	the meshes that use it and every probe (probes see the whole scene). The baked probe cubemaps are kept
+//	on the disk by their key in a BakeStore.
+class BakeCache
+{
+public:
+	enum Kind
+	{
+		KIND_PROBE,
+		KIND_IMPOSTOR,
+	};
+	// What a scene had baked, so that it can be baked again after the scene is loaded
+	struct ManifestEntry
+	{
+		Kind kind;
+		XMFLOAT3 position;		// probes
+		int resolution;			// probes
+		std::string meshName;	// impostors
+	};
+
+private:
+	struct Baked
+	{
+		uint64_t key;
+		int resolution;
+	};
+
+	static BakeCache* instance;
+	std::unordered_map<const void*, Baked> baked;
+	std::unordered_map<const Mesh*, uint64_t> geometryHashes;
+
+public:
+	static BakeCache* GetInstance();
+
+	// FNV-1a, hash is the running value
+	static uint64_t Hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	uint64_t GetMaterialHash(const Material* material) const;
+	uint64_t GetGeometryHash(const Mesh* mesh);
+	// Call when the vertices or indices of the mesh change
+	void InvalidateGeometry(const Mesh* mesh);
+	// Objects with their transforms, meshes, materials and lights
+	uint64_t GetSceneHash();
+
+	uint64_t GetProbeKey(const XMFLOAT3& position, int resolution);
+	uint64_t GetImpostorKey(const Mesh* mesh);
+
+	void SetBaked(const void* entity, uint64_t key, int resolution = 0);
+	bool IsBaked(const void* entity) const { return baked.find(entity) != baked.end(); }
+	bool IsUpToDate(const void* entity, uint64_t key) const;
+	int GetResolution(const void* entity) const;
+	void Forget(const void* entity);
+	// Call when the scene is cleared, meshes that are freed could come back at the same address
+	void Clear();
+
+	// The bakes are not part of the model archive, they are listed next to it in <scene>.bakes
+	bool WriteManifest(const std::string& fileName) const;
+	static bool ReadManifest(const std::string& fileName, std::vector<ManifestEntry>& entries);
+};
+
@@ -0,0 +1,48 @@
+#include "stdafx.h"
+#include "BakeStore.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+
+using namespace std;
+
+
+BakeStore::BakeStore(const string& directory) :directory(directory), hits(0), misses(0)
+{
+}
+
+string BakeStore::GetFileName(uint64_t key) const
+{
+	stringstream ss("");
+	ss << directory << hex << setw(16) << setfill('0') << key << ".dds";
+	return ss.str();
+}
+bool BakeStore::Contains(uint64_t key) const
+{
+	ifstream file(GetFileName(key), ios::binary);
+	return file.is_open();
+}
+
+bool BakeStore::Restore(uint64_t key, const FileFunction& restore, const FileFunction& bake)
+{
+	string fileName = GetFileName(key);
+	if (Contains(key))
+	{
+		if (restore(fileName))
+		{
+			hits++;
+			return true;
+		}
+		remove(fileName.c_str());
+	}
+
+	misses++;
+	CreateDirectoryA(directory.c_str(), nullptr);
+	if (!bake(fileName))
+	{
+		remove(fileName.c_str());
+	}
+	return false;
+}
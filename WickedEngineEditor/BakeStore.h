@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <functional>
+#include <cstdint>
+
+// Baked textures on the disk, one file per BakeCache key: <directory><key in hex>.dds
+//	The key is a hash of everything the bake read, so a file of the key is up to date by definition, in
+//	this session or in a later one. What a file holds and how it gets into the scene is up to the caller.
+class BakeStore
+{
+public:
+	// Gets the file name to load or to write
+	typedef std::function<bool(const std::string& fileName)> FileFunction;
+
+private:
+	std::string directory;
+	size_t hits, misses;
+
+public:
+	BakeStore(const std::string& directory = "bakes/");
+
+	void SetDirectory(const std::string& value) { directory = value; }
+	std::string GetFileName(uint64_t key) const;
+	bool Contains(uint64_t key) const;
+
+	// Loads the file of the key with restore. If there is none, or restore fails on it, bake runs and
+	//	writes the file instead. A file that failed to load or was left behind by a failed bake is deleted.
+	//	Returns true on a hit, when nothing was baked.
+	bool Restore(uint64_t key, const FileFunction& restore, const FileFunction& bake);
+
+	size_t GetHitCount() const { return hits; }
+	size_t GetMissCount() const { return misses; }
+};
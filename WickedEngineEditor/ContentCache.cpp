@@ -0,0 +1,261 @@
+#include "stdafx.h"
+#include "ContentCache.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+using namespace wiGraphicsTypes;
+
+namespace
+{
+	// Anything that is not a texture costs the size of its file
+	size_t GetFileSize(const string& fileName)
+	{
+		ifstream file(fileName, ios::binary | ios::ate);
+		if (!file.is_open())
+		{
+			return 0;
+		}
+		return (size_t)file.tellg();
+	}
+	// The resource manager decides by the extension what a dynamic resource is
+	bool IsTexture(const string& name, wiResourceManager::Data_Type type)
+	{
+		if (type == wiResourceManager::Data_Type::IMAGE)
+		{
+			return true;
+		}
+		if (type != wiResourceManager::Data_Type::DYNAMIC)
+		{
+			return false;
+		}
+		string extension = name.substr(name.find_last_of('.') + 1);
+		transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		return extension == "dds" || extension == "png" || extension == "jpg" || extension == "jpeg" || extension == "tga" || extension == "bmp";
+	}
+	// Bytes of a 4x4 block for the block compressed formats, zero for the others
+	size_t GetBlockSize(FORMAT format)
+	{
+		switch (format)
+		{
+		case FORMAT_BC1_UNORM:
+		case FORMAT_BC1_UNORM_SRGB:
+		case FORMAT_BC4_UNORM:
+		case FORMAT_BC4_SNORM:
+			return 8;
+		case FORMAT_BC2_UNORM:
+		case FORMAT_BC2_UNORM_SRGB:
+		case FORMAT_BC3_UNORM:
+		case FORMAT_BC3_UNORM_SRGB:
+		case FORMAT_BC5_UNORM:
+		case FORMAT_BC5_SNORM:
+		case FORMAT_BC6H_UF16:
+		case FORMAT_BC6H_SF16:
+		case FORMAT_BC7_UNORM:
+		case FORMAT_BC7_UNORM_SRGB:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+	size_t GetPixelSize(FORMAT format)
+	{
+		switch (format)
+		{
+		case FORMAT_R32G32B32A32_FLOAT:
+			return 16;
+		case FORMAT_R16G16B16A16_FLOAT:
+		case FORMAT_R16G16B16A16_UNORM:
+		case FORMAT_R32G32_FLOAT:
+			return 8;
+		case FORMAT_R8G8_UNORM:
+		case FORMAT_R16_FLOAT:
+		case FORMAT_R16_UNORM:
+			return 2;
+		case FORMAT_R8_UNORM:
+		case FORMAT_A8_UNORM:
+			return 1;
+		default:
+			return 4;
+		}
+	}
+}
+
+ContentCache::ContentCache(wiResourceManager* manager, size_t budget) :manager(manager)
+{
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.evictions = 0;
+	stats.resident = 0;
+	stats.referenced = 0;
+	stats.budget = budget;
+	stats.count = 0;
+}
+ContentCache::~ContentCache()
+{
+	// The resource manager cleans up whatever is still loaded
+}
+
+void ContentCache::SetBudget(size_t value)
+{
+	stats.budget = value;
+	Evict();
+}
+
+void* ContentCache::Acquire(const string& name, wiResourceManager::Data_Type type)
+{
+	auto it = entries.find(name);
+	if (it != entries.end())
+	{
+		stats.hits++;
+		Entry& entry = it->second;
+		if (entry.refCount == 0)
+		{
+			unused.erase(entry.lru);
+			stats.referenced += entry.size;
+		}
+		entry.refCount++;
+		if (entry.resource == nullptr && entry.owner != nullptr)
+		{
+			// tracked, the owner already has it
+			entry.resource = entry.owner->add(name, type);
+		}
+		return entry.resource;
+	}
+
+	stats.misses++;
+	if (manager == nullptr)
+	{
+		return nullptr;
+	}
+	void* resource = manager->add(name, type);
+	if (resource == nullptr)
+	{
+		return nullptr;
+	}
+
+	Entry entry;
+	entry.resource = resource;
+	entry.owner = manager;
+	entry.size = IsTexture(name, type) ? GetTextureSize((Texture2D*)resource) : GetFileSize(name);
+	entry.refCount = 1;
+	entries[name] = entry;
+	stats.resident += entry.size;
+	stats.referenced += entry.size;
+	stats.count = entries.size();
+
+	Evict();
+	return resource;
+}
+void ContentCache::Track(const string& name, wiResourceManager* owner, size_t size)
+{
+	auto it = entries.find(name);
+	if (it != entries.end())
+	{
+		stats.hits++;
+		Entry& entry = it->second;
+		if (entry.refCount == 0)
+		{
+			unused.erase(entry.lru);
+			stats.referenced += entry.size;
+		}
+		entry.refCount++;
+		return;
+	}
+
+	// Loaded by the owner, so it counts as a miss of the cache
+	stats.misses++;
+	Entry entry;
+	entry.resource = nullptr;
+	entry.owner = owner;
+	entry.size = size;
+	entry.refCount = 1;
+	entries[name] = entry;
+	stats.resident += entry.size;
+	stats.referenced += entry.size;
+	stats.count = entries.size();
+
+	Evict();
+}
+void ContentCache::Release(const string& name)
+{
+	auto it = entries.find(name);
+	if (it == entries.end() || it->second.refCount <= 0)
+	{
+		return;
+	}
+
+	Entry& entry = it->second;
+	entry.refCount--;
+	if (entry.refCount == 0)
+	{
+		stats.referenced -= entry.size;
+		entry.lru = unused.insert(unused.end(), name);
+		Evict();
+	}
+}
+void ContentCache::Trim()
+{
+	size_t budget = stats.budget;
+	stats.budget = 0;
+	Evict();
+	stats.budget = budget;
+}
+
+void ContentCache::Evict()
+{
+	// Referenced resources are never evicted, so the cache can stay over budget while they are in use
+	while (stats.resident > stats.budget && !unused.empty())
+	{
+		string name = unused.front();
+		unused.pop_front();
+
+		auto it = entries.find(name);
+		stats.resident -= it->second.size;
+		wiResourceManager* owner = it->second.owner;
+		entries.erase(it);
+		if (owner != nullptr)
+		{
+			owner->del(name);
+		}
+		stats.evictions++;
+	}
+	stats.count = entries.size();
+}
+
+size_t ContentCache::GetTextureSize(const Texture2D* texture)
+{
+	if (texture == nullptr)
+	{
+		return 0;
+	}
+	const TextureDesc& desc = texture->GetDesc();
+	size_t blockSize = GetBlockSize(desc.Format);
+	size_t pixelSize = GetPixelSize(desc.Format);
+	// zero mip levels is the full chain
+	uint32_t mipLevels = desc.MipLevels;
+	if (mipLevels == 0)
+	{
+		for (uint32_t size = max(desc.Width, desc.Height); size > 0; size /= 2)
+		{
+			mipLevels++;
+		}
+	}
+	size_t size = 0;
+	for (uint32_t i = 0; i < mipLevels; ++i)
+	{
+		size_t width = max(desc.Width >> i, 1u);
+		size_t height = max(desc.Height >> i, 1u);
+		if (blockSize > 0)
+		{
+			size += ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+		}
+		else
+		{
+			size += width * height * pixelSize;
+		}
+	}
+	return size * max(desc.ArraySize, 1u);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "WickedEngine.h"
+
+#include <string>
+#include <list>
+#include <unordered_map>
+
+// Reference counted front of a wiResourceManager with a memory budget
+//	Every Acquire() must be paired with a Release(). Resources that nobody references stay loaded (so
+//	reloading them is a hit) until the cache is over its budget, then the least recently used ones are
+//	deleted from the resource manager.
+class ContentCache
+{
+public:
+	struct Stats
+	{
+		size_t hits;
+		size_t misses;
+		size_t evictions;
+		size_t resident;	// bytes of everything in the cache
+		size_t referenced;	// bytes of the resources that are in use
+		size_t budget;
+		size_t count;
+	};
+
+private:
+	struct Entry
+	{
+		void* resource;
+		wiResourceManager* owner;	// the resource is deleted from this one when it is evicted
+		size_t size;
+		int refCount;
+		std::list<std::string>::iterator lru; // only valid while refCount is zero
+	};
+
+	wiResourceManager* manager;
+	std::unordered_map<std::string, Entry> entries;
+	// unreferenced resources, the least recently used at the front
+	std::list<std::string> unused;
+	Stats stats;
+
+	void Evict();
+
+public:
+	ContentCache(wiResourceManager* manager = nullptr, size_t budget = 256 * 1024 * 1024);
+	~ContentCache();
+
+	void SetManager(wiResourceManager* value) { manager = value; }
+	// Shrinking the budget evicts right away
+	void SetBudget(size_t value);
+
+	// Loads (or finds) the resource and adds a reference, nullptr if it can't be loaded
+	void* Acquire(const std::string& name, wiResourceManager::Data_Type type = wiResourceManager::Data_Type::DYNAMIC);
+	// Adds a reference to a resource that owner has already loaded under this name, e.g. a texture of a
+	//	material that was loaded while its model was deserialized. It is evicted like the others. size is
+	//	its memory cost, only used the first time the name is seen.
+	void Track(const std::string& name, wiResourceManager* owner, size_t size);
+	// Drops a reference, the resource becomes evictable when nobody references it
+	void Release(const std::string& name);
+	// Evicts every unreferenced resource
+	void Trim();
+
+	const Stats& GetStats() const { return stats; }
+
+	// Memory of a texture with every mip level and array slice, from its description
+	static size_t GetTextureSize(const wiGraphicsTypes::Texture2D* texture);
+};
+
@@ -0,0 +1,29 @@
+#include "stdafx.h"
+#include "DebugDraw.h"
+
+using namespace std;
+
+
+void DebugDraw::AddBox(const XMFLOAT4X4& boxMatrix, const XMFLOAT4& color)
+{
+	Box box;
+	box.transform = boxMatrix;
+	box.color = color;
+	boxes.push_back(box);
+}
+void DebugDraw::AddBox(const AABB& aabb, const XMFLOAT4& color)
+{
+	XMFLOAT4X4 boxMatrix;
+	XMStoreFloat4x4(&boxMatrix, aabb.getAsBoxMatrix());
+	AddBox(boxMatrix, color);
+}
+
+void DebugDraw::Flush()
+{
+	for (auto& x : boxes)
+	{
+		wiRenderer::AddRenderableBox(x.transform, x.color);
+	}
+	// clear() keeps the capacity for the next frame
+	boxes.clear();
+}
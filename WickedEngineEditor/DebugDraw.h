@@ -0,0 +1,27 @@
+#pragma once
+#include "WickedEngine.h"
+
+#include <vector>
+
+// Frame arena for the editor's debug boxes (hover, selection)
+//	Boxes are collected during the frame into storage that is kept between frames and handed to the
+//	renderer in Flush(), every box is drawn as it was added. There is no batching here: the engine
+//	draws each renderable box on its own, this only saves the per-frame allocations.
+class DebugDraw
+{
+private:
+	struct Box
+	{
+		XMFLOAT4X4 transform;	// maps the [-1, 1] cube to the world
+		XMFLOAT4 color;
+	};
+	std::vector<Box> boxes;
+
+public:
+	void AddBox(const XMFLOAT4X4& boxMatrix, const XMFLOAT4& color);
+	void AddBox(const AABB& aabb, const XMFLOAT4& color);
+	// Hands the boxes to the renderer and clears the arena for the next frame
+	void Flush();
+
+	size_t GetCount() const { return boxes.size(); }
+};
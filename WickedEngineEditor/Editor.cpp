@@ -12,20 +12,49 @@
 #include "EnvProbeWindow.h"
 #include "DecalWindow.h"
 #include "LightWindow.h"
+#include "HistoryJournal.h"
+#include "SelectionSet.h"
+#include "SceneIndex.h"
+#include "EditorPicker.h"
+#include "IconBatch.h"
+#include "DebugDraw.h"
+#include "SceneSnapshot.h"
+#include "ScenePackage.h"
+#include "LoadingPipeline.h"
+#include "MainThreadQueue.h"
+#include "ContentCache.h"
+#include "EngineInput.h"
+#include "EditorCore.h"
+#include "FrameTimings.h"
+#include "IdleState.h"
+#include "EditorProfiler.h"
+#include "BakeCache.h"
+#include "BakeStore.h"
+#include "MeshLODs.h"
 
 #include <Commdlg.h> // openfile
 #include <WinBase.h>
+#include <unordered_set>
 
 // This should be written into any archive operation for future bacwards compatibility!
 int __editorVersion = 0;
 
 using namespace wiGraphicsTypes;
 
+void InitializeIdleWakeup();
+
 
 Editor::Editor()
 {
 	SAFE_INIT(renderComponent);
 	SAFE_INIT(loader);
+
+	historyBudget = 64 * 1024 * 1024;
+	autosaveInterval = 5 * 60;
+	contentBudget = 256 * 1024 * 1024;
+	timingsFile = "timings.csv";
+	idleMode = true;
+	optimizeOnImport = true;
 }
 
 
@@ -80,10 +109,113 @@ void Editor::Initialize()
 
 	activateComponent(loader);
 
+	InitializeIdleWakeup();
+
 	this->infoDisplay.fpsinfo = true;
 
 }
 
+// Package that is being loaded, after the loading screen its chunks are added a few per frame
+PackageLoader packageLoader;
+// Bake manifest of the loaded scene, read when the last chunk is there because the meshes are found by name
+string pendingBakes;
+// Probe cubemaps by bake key, a probe whose scene was already baked once is loaded instead of rendered
+BakeStore bakeStore;
+// Worker threads hand their results to the main thread through this, it is drained by whichever
+//	component is active
+MainThreadQueue mainThreadQueue;
+// Textures that the editor loads on its own (sky, color grading, icons), and the textures of the scene's
+//	materials, which are loaded into the global resource manager while their models are deserialized
+ContentCache contentCache;
+string skyTextureName, colorGradingTextureName;
+size_t lastEvictionCount = 0;
+unordered_set<Material*> trackedMaterials;
+vector<string> trackedTextures;
+// Every material of the scene references its textures in the cache, until the scene is cleared. The
+//	materials keep the names the textures were loaded with, those are the keys of the global manager, and
+//	the loaded textures, those tell the memory they take.
+void TrackSceneTextures()
+{
+	for (auto& x : wiRenderer::GetScene().models)
+	{
+		for (auto& y : x->materials)
+		{
+			Material* material = y.second;
+			if (!trackedMaterials.insert(material).second)
+			{
+				continue;
+			}
+			const string* names[] = { &material->textureName, &material->normalMapName, &material->surfaceMapName, &material->displacementMapName };
+			const Texture2D* textures[] = { material->texture, material->normalMap, material->surfaceMap, material->displacementMap };
+			for (int i = 0; i < 4; ++i)
+			{
+				if (!names[i]->empty())
+				{
+					contentCache.Track(*names[i], wiResourceManager::GetGlobal(), ContentCache::GetTextureSize(textures[i]));
+					trackedTextures.push_back(*names[i]);
+				}
+			}
+		}
+	}
+}
+// Unreferenced textures stay loaded, so loading the same scene again hits them, until the budget is full
+void ReleaseSceneTextures()
+{
+	for (auto& x : trackedTextures)
+	{
+		contentCache.Release(x);
+	}
+	trackedTextures.clear();
+	trackedMaterials.clear();
+}
+// Where the editor logic reads the input from, the live devices unless a script is played
+EngineInput engineInput;
+ScriptedInput scriptedInput;
+RecordingInput recordingInput;
+ReplayInput replayInput;
+EditorInput* editorInput = &engineInput;
+bool inputFinished = false;
+FrameTimings frameTimings;
+// Idle mode: the main loop stops running frames after a few in which nothing changed
+IdleState idleState;
+DWORD mainThreadId = 0;
+
+void InitializeIdleWakeup()
+{
+	// Worker results are input too, a sleeping main loop is woken up by an empty thread message
+	mainThreadId = GetCurrentThreadId();
+	mainThreadQueue.SetWakeup([] {
+		PostThreadMessage(mainThreadId, WM_NULL, 0, 0);
+	});
+}
+bool Editor::IsIdle() const
+{
+	return idleMode && editorInput == &engineInput && idleState.IsIdle();
+}
+void Editor::Wake()
+{
+	idleState.Wake();
+}
+void Editor::Waited()
+{
+	idleState.Waited();
+}
+void Editor::RunFrame()
+{
+	EditorProfiler::GetInstance()->BeginFrame();
+	if (idleState.ConsumeWait())
+	{
+		// run() adds the time since its previous frame to the frame skipping accumulator. Without frame
+		//	skipping it runs one update and only restarts its timer, so the wait is not replayed. Idle mode
+		//	only happens with the live input, which always skips frames.
+		setFrameSkip(false);
+		run();
+		setFrameSkip(true);
+		return;
+	}
+	run();
+}
+
 void EditorLoadingScreen::Load()
 {
 	sprite = wiSprite();
@@ -96,11 +228,25 @@ void EditorLoadingScreen::Load()
 
 	__super::Load();
 }
+void EditorLoadingScreen::Update()
+{
+	// The loading animation never idles
+	idleState.Wake();
+	mainThreadQueue.Drain();
+
+	__super::Update();
+}
 void EditorLoadingScreen::Compose()
 {
 	__super::Compose();
 
-	wiFont("Loading...", wiFontProps(wiRenderer::GetDevice()->GetScreenWidth() * 0.5f, wiRenderer::GetDevice()->GetScreenHeight() * 0.5f, 22,
+	stringstream ss("");
+	ss << "Loading...";
+	if (packageLoader.IsActive())
+	{
+		ss << " " << (int)(packageLoader.GetProgress() * 100) << "%";
+	}
+	wiFont(ss.str(), wiFontProps(wiRenderer::GetDevice()->GetScreenWidth() * 0.5f, wiRenderer::GetDevice()->GetScreenHeight() * 0.5f, 22,
 		WIFALIGN_MID, WIFALIGN_MID)).Draw();
 }
 void EditorLoadingScreen::Unload()
@@ -110,9 +256,40 @@ void EditorLoadingScreen::Unload()
 
 wiTranslator* translator = nullptr;
 bool translator_active = false;
-list<wiRenderer::Picked*> selected;
-map<Transform*,Transform*> savedParents;
+SelectionSet selected;
 wiRenderer::Picked hovered;
+EditorPicker picker;
+IconBatch lightIcons;
+DebugDraw debugDraw;
+SceneWriter sceneWriter;
+
+// Seconds per frame spent on adding streamed chunks to the scene
+const float streamingBudget = 0.008f;
+// Seconds per frame spent on baking environment probes
+const float probeBakeBudget = 0.008f;
+// ... and on making impostors
+const float impostorBakeBudget = 0.008f;
+// Largest error of the mesh LODs on the screen, in pixels
+const float lodErrorPixels = 1.0f;
+
+// Bounds of the whole selection, only recomputed when the selection or the translator changes
+struct SelectionBounds
+{
+	AABB aabb;
+	uint64_t version = ~0ull;
+	XMFLOAT4X4 translatorWorld;
+	// Entity bounds are updated by the engine after the transforms, so a change is followed for an
+	//	extra frame
+	int dirtyFrames = 0;
+	// Result of the last full merge and the translator it was made with. While the selection is being
+	//	dragged it moves with the translator, so this box is carried along instead of merging again.
+	AABB mergedAabb;
+	XMFLOAT4X4 mergedTranslatorWorld;
+	bool merged = false;
+
+	void Invalidate() { dirtyFrames = 2; }
+} selectionBounds;
+void UpdateSelectionBounds();
 void BeginTranslate()
 {
 	translator_active = true;
@@ -149,29 +326,30 @@ void EndTranslate()
 	translator_active = false;
 	translator->detach();
 
-	for (auto& x : selected)
+	for (size_t i = 0; i < selected.size(); ++i)
 	{
+		wiRenderer::Picked* x = selected[i];
 		if (x->transform != nullptr)
 		{
 			x->transform->detach();
-			map<Transform*,Transform*>::iterator it = savedParents.find(x->transform);
-			if (it != savedParents.end())
-			{
-				x->transform->attachTo(it->second);
-			}
+			x->transform->attachTo(selected.GetSavedParent(i));
 		}
 	}
 }
 void ClearSelected()
 {
-	for (auto& x : selected)
-	{
-		SAFE_DELETE(x);
-	}
-	selected.clear();
-	savedParents.clear();
+	selected.Clear();
+}
+// Recreates the pick for a transform that was selected before
+wiRenderer::Picked* PickedFromTransform(Transform* transform)
+{
+	wiRenderer::Picked* picked = new wiRenderer::Picked;
+	picked->transform = transform;
+	picked->object = dynamic_cast<Object*>(transform);
+	picked->light = dynamic_cast<Light*>(transform);
+	picked->decal = dynamic_cast<Decal*>(transform);
+	return picked;
 }
-
 
 wiArchive *clipboard_write = nullptr, *clipboard_read = nullptr;
 enum ClipboardItemType
@@ -180,9 +358,23 @@ enum ClipboardItemType
 	CLIPBOARD_EMPTY
 };
 
-wiArchive* history = nullptr;
-int historyCount = 0;
-int historyPos = -1;
+// In-process clipboard. It keeps detached copies of the copied entities, these still reference
+//	the meshes and materials of the originals, so pasting only creates new instances. The copies
+//	reference no scene nodes and no emitters, so destroying them (or the pasted instances) leaves
+//	the originals alone.
+struct Clipboard
+{
+	vector<Object*> objects;
+	vector<Light*> lights;
+	vector<Decal*> decals;
+
+	bool IsEmpty() const { return objects.empty() && lights.empty() && decals.empty(); }
+} clipboard;
+void CopyToClipboard();
+void ClearClipboard();
+
+HistoryJournal historyJournal;
+HistoryJournal::Record* history = nullptr;
 enum HistoryOperationType
 {
 	HISTORYOP_SELECTION,
@@ -192,176 +384,817 @@ enum HistoryOperationType
 	HISTORYOP_NONE
 };
 void ResetHistory();
-string AdvanceHistory();
+HistoryJournal::Record* AdvanceHistory();
+void EndHistory();
 void ConsumeHistoryOperation(bool undo);
+void MarqueeSelect(const XMFLOAT2& start, const XMFLOAT2& end, int pickType, bool additive);
 
-
-void EditorComponent::Initialize()
+// Entities removed by a delete operation (or a paste that was undone), owned by the tombstone
+//	while they are buried
+struct DeleteTombstone
 {
-	setShadowsEnabled(true);
-	setReflectionsEnabled(true);
-	setSSAOEnabled(false);
-	setSSREnabled(false);
-	setMotionBlurEnabled(false);
-	setColorGradingEnabled(false);
-	setEyeAdaptionEnabled(false);
-	setFXAAEnabled(false);
-	setDepthOfFieldEnabled(false);
-	setLightShaftsEnabled(false);
-
-	SAFE_INIT(materialWnd);
-	SAFE_INIT(postprocessWnd);
-	SAFE_INIT(worldWnd);
-	SAFE_INIT(objectWnd);
-	SAFE_INIT(meshWnd);
-	SAFE_INIT(cameraWnd);
-	SAFE_INIT(rendererWnd);
+	vector<Object*> objects;
+	vector<Light*> lights;
+	vector<Decal*> decals;
+	bool buried = false;
+};
+unordered_map<uint64_t, DeleteTombstone> tombstones;
+void BuryTombstone(DeleteTombstone& tombstone);
+void RestoreTombstone(DeleteTombstone& tombstone);
+void DiscardTombstone(uint64_t historyID);
+void PasteFromClipboard(DeleteTombstone& pasted);
+
+// What the input asks for, done on the scene and in the editor's windows
+class EditorHost : public EditorCore::Host
+{
+public:
+	EditorComponent* component = nullptr;
+
+	bool IsFPSCamera() override;
+	void UpdateCamera(const EditorCore::CameraControl& control) override;
+	void Hover(const XMFLOAT2& pointer) override;
+	void Select(bool additive) override;
+	void MarqueeSelect(const XMFLOAT2& start, const XMFLOAT2& end, bool additive) override;
+	void Delete() override;
+	void Copy() override;
+	void CopyToFile() override;
+	bool IsClipboardEmpty() override;
+	void Paste() override;
+	void PasteFromFile() override;
+	void Duplicate() override;
+	void Undo() override;
+	void Redo() override;
+	void ToggleProfiler() override;
+	void WriteProfile() override;
+	void PutProbe() override;
+} editorHost;
+EditorCore editorCore(&editorHost);
+
+bool EditorHost::IsFPSCamera()
+{
+	return component->cameraWnd->fpscamera;
+}
+void EditorHost::UpdateCamera(const EditorCore::CameraControl& control)
+{
+	Camera* cam = wiRenderer::getCamera();
 
-	__super::Initialize();
+	if (component->cameraWnd->fpscamera)
+	{
+		// FPS Camera
+		cam->detach();
+		cam->Move(XMVectorSet(control.move.x, control.move.y, control.move.z, 0));
+		cam->RotateRollPitchYaw(XMFLOAT3(control.rotation.x, control.rotation.y, 0));
+	}
+	else
+	{
+		// Orbital Camera
+		if (cam->parent == nullptr)
+		{
+			cam->attachTo(component->cameraWnd->orbitalCamTarget);
+		}
+		XMVECTOR V = XMVectorAdd(cam->GetRight() * control.pan.x, cam->GetUp() * control.pan.y);
+		XMFLOAT3 vec;
+		XMStoreFloat3(&vec, V);
+		component->cameraWnd->orbitalCamTarget->Translate(vec);
+		cam->Translate(XMFLOAT3(0, 0, control.zoom));
+		component->cameraWnd->orbitalCamTarget->RotateRollPitchYaw(XMFLOAT3(control.rotation.x, control.rotation.y, 0));
+	}
 }
-void EditorComponent::Load()
+void EditorHost::Hover(const XMFLOAT2& pointer)
 {
-	__super::Load();
+	PROFILE_SCOPE("Picking");
+	hovered = picker.Pick((long)pointer.x, (long)pointer.y, component->rendererWnd->GetPickType());
+}
+void EditorHost::Select(bool additive)
+{
+	wiRenderer::Picked* picked = new wiRenderer::Picked(hovered);
+	if (picked->object != nullptr && picked->object->isArmatureDeformed())
+	{
+		picked->transform = picked->object->mesh->armature;
+	}
 
-	translator = new wiTranslator;
-	translator->enabled = false;
+	history = AdvanceHistory();
+	*history << __editorVersion;
+	*history << (int)HISTORYOP_SELECTION;
 
-	materialWnd = new MaterialWindow(&GetGUI());
-	postprocessWnd = new PostprocessWindow(this);
-	worldWnd = new WorldWindow(&GetGUI());
-	objectWnd = new ObjectWindow(&GetGUI());
-	meshWnd = new MeshWindow(&GetGUI());
-	cameraWnd = new CameraWindow(&GetGUI());
-	rendererWnd = new RendererWindow(this);
-	envProbeWnd = new EnvProbeWindow(&GetGUI());
-	decalWnd = new DecalWindow(&GetGUI());
-	lightWnd = new LightWindow(&GetGUI());
+	bool owned = false;
+	if (!selected.empty() && picked->transform != nullptr && additive)
+	{
+		uint64_t id = picked->transform->GetID();
+		if (!selected.Contains(id))
+		{
+			*history << (int)0; // add sel
+			*history << id;
 
-	float screenW = (float)wiRenderer::GetDevice()->GetScreenWidth();
-	float screenH = (float)wiRenderer::GetDevice()->GetScreenHeight();
+			EndTranslate();
+			owned = selected.Add(picked);
+		}
+		else
+		{
+			*history << (int)1; // remove from sel
+			*history << id;
 
-	float step = 105, x = -step;
+			EndTranslate();
+			selected.Remove(id);
+		}
+	}
+	else
+	{
+		*history << (int)2; // clear sel, new sel
 
-	wiButton* rendererWnd_Toggle = new wiButton("Renderer");
-	rendererWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
-	rendererWnd_Toggle->SetSize(XMFLOAT2(100, 40));
-	rendererWnd_Toggle->SetFontScaling(0.3f);
-	rendererWnd_Toggle->OnClick([=](wiEventArgs args) {
-		rendererWnd->rendererWindow->SetVisible(!rendererWnd->rendererWindow->IsVisible());
-	});
-	GetGUI().AddWidget(rendererWnd_Toggle);
+		EndTranslate();
+		ClearSelected();
+		owned = selected.Add(picked);
+	}
 
-	wiButton* worldWnd_Toggle = new wiButton("World");
-	worldWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
-	worldWnd_Toggle->SetSize(XMFLOAT2(100, 40));
-	worldWnd_Toggle->SetFontScaling(0.4f);
-	worldWnd_Toggle->OnClick([=](wiEventArgs args) {
-		worldWnd->worldWindow->SetVisible(!worldWnd->worldWindow->IsVisible());
-	});
-	GetGUI().AddWidget(worldWnd_Toggle);
+	EndHistory();
 
-	wiButton* objectWnd_Toggle = new wiButton("Object");
-	objectWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
-	objectWnd_Toggle->SetSize(XMFLOAT2(100, 40));
-	objectWnd_Toggle->SetFontScaling(0.4f);
-	objectWnd_Toggle->OnClick([=](wiEventArgs args) {
-		objectWnd->objectWindow->SetVisible(!objectWnd->objectWindow->IsVisible());
-	});
-	GetGUI().AddWidget(objectWnd_Toggle);
+	component->objectWnd->SetObject(picked->object);
 
-	wiButton* meshWnd_Toggle = new wiButton("Mesh");
-	meshWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
-	meshWnd_Toggle->SetSize(XMFLOAT2(100, 40));
-	meshWnd_Toggle->SetFontScaling(0.4f);
-	meshWnd_Toggle->OnClick([=](wiEventArgs args) {
-		meshWnd->meshWindow->SetVisible(!meshWnd->meshWindow->IsVisible());
-	});
-	GetGUI().AddWidget(meshWnd_Toggle);
+	if (picked->transform != nullptr)
+	{
+		EndTranslate();
 
-	wiButton* materialWnd_Toggle = new wiButton("Material");
-	materialWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
-	materialWnd_Toggle->SetSize(XMFLOAT2(100, 40));
-	materialWnd_Toggle->SetFontScaling(0.3f);
-	materialWnd_Toggle->OnClick([=](wiEventArgs args) {
-		materialWnd->materialWindow->SetVisible(!materialWnd->materialWindow->IsVisible());
-	});
-	GetGUI().AddWidget(materialWnd_Toggle);
+		if (picked->object != nullptr)
+		{
+			component->meshWnd->SetMesh(picked->object->mesh);
+			if (picked->subsetIndex < (int)picked->object->mesh->subsets.size())
+			{
+				Material* material = picked->object->mesh->subsets[picked->subsetIndex].material;
 
-	wiButton* postprocessWnd_Toggle = new wiButton("PostProcess");
-	postprocessWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
-	postprocessWnd_Toggle->SetSize(XMFLOAT2(100, 40));
-	postprocessWnd_Toggle->SetFontScaling(0.22f);
-	postprocessWnd_Toggle->OnClick([=](wiEventArgs args) {
-		postprocessWnd->ppWindow->SetVisible(!postprocessWnd->ppWindow->IsVisible());
-	});
-	GetGUI().AddWidget(postprocessWnd_Toggle);
+				component->materialWnd->SetMaterial(material);
+			}
+		}
+		else
+		{
+			component->meshWnd->SetMesh(nullptr);
+			component->materialWnd->SetMaterial(nullptr);
+		}
 
-	wiButton* cameraWnd_Toggle = new wiButton("Camera");
-	cameraWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
-	cameraWnd_Toggle->SetSize(XMFLOAT2(100, 40));
-	cameraWnd_Toggle->SetFontScaling(0.3f);
-	cameraWnd_Toggle->OnClick([=](wiEventArgs args) {
-		cameraWnd->cameraWindow->SetVisible(!cameraWnd->cameraWindow->IsVisible());
-	});
-	GetGUI().AddWidget(cameraWnd_Toggle);
+		if (picked->light != nullptr)
+		{
+		}
+		component->lightWnd->SetLight(picked->light);
+		if (picked->decal != nullptr)
+		{
+		}
+		component->decalWnd->SetDecal(picked->decal);
 
-	wiButton* envProbeWnd_Toggle = new wiButton("EnvProbe");
-	envProbeWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
-	envProbeWnd_Toggle->SetSize(XMFLOAT2(100, 40));
-	envProbeWnd_Toggle->SetFontScaling(0.3f);
-	envProbeWnd_Toggle->OnClick([=](wiEventArgs args) {
-		envProbeWnd->envProbeWindow->SetVisible(!envProbeWnd->envProbeWindow->IsVisible());
-	});
-	GetGUI().AddWidget(envProbeWnd_Toggle);
+		BeginTranslate();
 
-	wiButton* decalWnd_Toggle = new wiButton("Decal");
-	decalWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
-	decalWnd_Toggle->SetSize(XMFLOAT2(100, 40));
-	decalWnd_Toggle->SetFontScaling(0.3f);
-	decalWnd_Toggle->OnClick([=](wiEventArgs args) {
-		decalWnd->decalWindow->SetVisible(!decalWnd->decalWindow->IsVisible());
-	});
-	GetGUI().AddWidget(decalWnd_Toggle);
+	}
+	else
+	{
+		component->meshWnd->SetMesh(nullptr);
+		component->materialWnd->SetMaterial(nullptr);
 
-	wiButton* lightWnd_Toggle = new wiButton("Light");
-	lightWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
-	lightWnd_Toggle->SetSize(XMFLOAT2(100, 40));
-	lightWnd_Toggle->SetFontScaling(0.3f);
-	lightWnd_Toggle->OnClick([=](wiEventArgs args) {
-		lightWnd->lightWindow->SetVisible(!lightWnd->lightWindow->IsVisible());
-	});
-	GetGUI().AddWidget(lightWnd_Toggle);
+		EndTranslate();
+		ClearSelected();
+	}
 
+	if (!owned)
+	{
+		SAFE_DELETE(picked);
+	}
+}
+void EditorHost::MarqueeSelect(const XMFLOAT2& start, const XMFLOAT2& end, bool additive)
+{
+	::MarqueeSelect(start, end, component->rendererWnd->GetPickType(), additive);
+}
+void EditorHost::Delete()
+{
+	// Nothing selected, nothing to record
+	if (selected.empty())
+	{
+		return;
+	}
 
-	////////////////////////////////////////////////////////////////////////////////////
+	EndTranslate();
 
+	history = AdvanceHistory();
+	*history << __editorVersion;
+	*history << HISTORYOP_DELETE;
 
+	// The deleted entities are only taken out of the scene and kept in a tombstone, they
+	//	still reference their meshes and materials, so undo doesn't need to rebuild anything
+	DeleteTombstone& tombstone = tombstones[history->GetID()];
+	for (auto& x : selected)
+	{
+		if (x->object != nullptr)
+		{
+			tombstone.objects.push_back(x->object);
+			x->transform = nullptr;
+		}
 
-	wiCheckBox* translatorCheckBox = new wiCheckBox("Translator: ");
-	translatorCheckBox->SetPos(XMFLOAT2(screenW - 495, 0));
-	translatorCheckBox->SetSize(XMFLOAT2(18, 18));
-	translatorCheckBox->OnClick([=](wiEventArgs args) {
-		if(!args.bValue)
-			EndTranslate();
-		translator->enabled = args.bValue;
-	});
-	GetGUI().AddWidget(translatorCheckBox);
+		if (x->light != nullptr)
+		{
+			tombstone.lights.push_back(x->light);
+			x->transform = nullptr;
+		}
 
-	wiCheckBox* isScalatorCheckBox = new wiCheckBox("S:");
-	isScalatorCheckBox->SetPos(XMFLOAT2(screenW - 575, 22));
-	isScalatorCheckBox->SetSize(XMFLOAT2(18, 18));
-	isScalatorCheckBox->OnClick([=](wiEventArgs args) {
-		translator->isScalator = args.bValue;
-	});
-	isScalatorCheckBox->SetCheck(translator->isScalator);
-	GetGUI().AddWidget(isScalatorCheckBox);
+		if (x->decal != nullptr)
+		{
+			tombstone.decals.push_back(x->decal);
+			x->transform = nullptr;
+		}
 
-	wiCheckBox* isRotatorCheckBox = new wiCheckBox("R:");
-	isRotatorCheckBox->SetPos(XMFLOAT2(screenW - 535, 22));
-	isRotatorCheckBox->SetSize(XMFLOAT2(18, 18));
-	isRotatorCheckBox->OnClick([=](wiEventArgs args) {
-		translator->isRotator = args.bValue;
-	});
+		if (x->transform != nullptr)
+		{
+			EnvironmentProbe* envProbe = dynamic_cast<EnvironmentProbe*>(x->transform);
+			if (envProbe != nullptr)
+			{
+				// A waiting rebake and the bake key must not outlive the probe, the address can be reused
+				component->envProbeWnd->bakeQueue.Forget(envProbe);
+				BakeCache::GetInstance()->Forget(envProbe);
+				SceneIndex::GetInstance()->Remove(envProbe);
+				wiRenderer::Remove(envProbe);
+				SAFE_DELETE(envProbe);
+			}
+		}
+	}
+	BuryTombstone(tombstone);
+	EndHistory();
+	ClearSelected();
+}
+void EditorHost::Copy()
+{
+	CopyToClipboard();
+}
+void EditorHost::CopyToFile()
+{
+	clipboard_write = new wiArchive("temp/clipboard", false);
+	*clipboard_write << __editorVersion;
+	*clipboard_write << CLIPBOARD_MODEL;
+	Model* model = new Model;
+	for (auto& x : selected)
+	{
+		model->Add(x->object);
+		model->Add(x->light);
+		model->Add(x->decal);
+	}
+	model->Serialize(*clipboard_write);
+	SAFE_DELETE(clipboard_write);
+
+	model->objects.clear();
+	model->lights.clear();
+	model->decals.clear();
+	model->meshes.clear();
+	model->materials.clear();
+	SAFE_DELETE(model);
+}
+bool EditorHost::IsClipboardEmpty()
+{
+	return clipboard.IsEmpty();
+}
+void EditorHost::Paste()
+{
+	history = AdvanceHistory();
+	*history << __editorVersion;
+	*history << HISTORYOP_PASTE;
+	PasteFromClipboard(tombstones[history->GetID()]);
+	EndHistory();
+}
+void EditorHost::PasteFromFile()
+{
+	clipboard_read = new wiArchive("temp/clipboard", true);
+	int version;
+	// version check is maybe not yet used, but is here intentionally for future bacwards-compatibility!
+	*clipboard_read >> version;
+	int tmp;
+	*clipboard_read >> tmp;
+	ClipboardItemType type = (ClipboardItemType)tmp;
+	switch (type)
+	{
+	case CLIPBOARD_MODEL:
+	{
+		Model* model = new Model;
+		model->Serialize(*clipboard_read);
+		wiRenderer::AddModel(model);
+		SceneIndex::GetInstance()->Add(model);
+	}
+	break;
+	case CLIPBOARD_EMPTY:
+		break;
+	default:
+		break;
+	}
+	SAFE_DELETE(clipboard_read);
+}
+void EditorHost::Duplicate()
+{
+	for (auto& x : selected)
+	{
+		if (x->object != nullptr)
+		{
+			Object* o = new Object(*x->object);
+			o->detach();
+			wiRenderer::Add(o);
+			SceneIndex::GetInstance()->Add(o);
+		}
+		if (x->light != nullptr)
+		{
+			Light* l = new Light(*x->light);
+			l->detach();
+			wiRenderer::Add(l);
+			SceneIndex::GetInstance()->Add(l);
+		}
+	}
+}
+void EditorHost::Undo()
+{
+	ConsumeHistoryOperation(true);
+}
+void EditorHost::Redo()
+{
+	ConsumeHistoryOperation(false);
+}
+void EditorHost::ToggleProfiler()
+{
+	EditorProfiler::GetInstance()->SetEnabled(!EditorProfiler::GetInstance()->IsEnabled());
+}
+void EditorHost::WriteProfile()
+{
+	if (EditorProfiler::GetInstance()->IsEnabled() && EditorProfiler::GetInstance()->WriteTrace("profile.json"))
+	{
+		wiBackLog::post("Profile written to profile.json");
+	}
+}
+void EditorHost::PutProbe()
+{
+	XMFLOAT3 position;
+	XMStoreFloat3(&position, wiRenderer::getCamera()->GetEye());
+	component->envProbeWnd->PutProbe(position);
+}
+
+
+// Every mesh of the scene, to tell which ones a load added
+vector<Mesh*> GetSceneMeshes()
+{
+	vector<Mesh*> meshes;
+	for (auto& x : wiRenderer::GetScene().models)
+	{
+		for (auto& y : x->meshes)
+		{
+			meshes.push_back(y.second);
+		}
+	}
+	return meshes;
+}
+
+// Last camera of idle mode
+struct IdleCamera
+{
+	XMFLOAT3 translation = XMFLOAT3(0, 0, 0);
+	XMFLOAT4 rotation = XMFLOAT4(0, 0, 0, 1);
+} idleCamera;
+// Armatures and emitters change every frame, the answer is cached until the scene changes
+bool IsSceneAnimating()
+{
+	static uint64_t version = ~0ull;
+	static bool animating = false;
+	if (version == SceneIndex::GetInstance()->GetVersion())
+	{
+		return animating;
+	}
+	version = SceneIndex::GetInstance()->GetVersion();
+	animating = false;
+	for (auto& x : wiRenderer::GetScene().models)
+	{
+		if (!x->armatures.empty())
+		{
+			animating = true;
+			break;
+		}
+		for (auto& y : x->objects)
+		{
+			if (!y->eParticleSystems.empty())
+			{
+				animating = true;
+				break;
+			}
+		}
+		if (animating)
+		{
+			break;
+		}
+	}
+	return animating;
+}
+
+// A probe of the scene that is not in probes
+EnvironmentProbe* FindNewProbe(const unordered_set<EnvironmentProbe*>& probes)
+{
+	for (auto& x : wiRenderer::GetScene().models)
+	{
+		for (auto& y : x->environmentProbes)
+		{
+			if (probes.find(y) == probes.end())
+			{
+				return y;
+			}
+		}
+	}
+	return nullptr;
+}
+// A probe from a stored cubemap, set up the way wiRenderer::PutEnvProbe sets up the probes it renders.
+//	Returns false if the file is not a cubemap of this resolution.
+bool RestoreProbe(const XMFLOAT3& position, int resolution, const string& fileName)
+{
+	Texture2D* cubemap = (Texture2D*)wiResourceManager::GetGlobal()->add(fileName);
+	if (cubemap == nullptr)
+	{
+		return false;
+	}
+	bool valid = cubemap->GetDesc().Width == (UINT)resolution && cubemap->GetDesc().ArraySize == 6;
+	if (valid)
+	{
+		EnvironmentProbe* probe = new EnvironmentProbe;
+		probe->Translate(position);
+		probe->cubeMap.InitializeCube(resolution, 1, true, FORMAT_R16G16B16A16_FLOAT, 0);
+		wiRenderer::GetDevice()->CopyTexture2D(probe->cubeMap.GetTexture(), cubemap, GRAPHICSTHREAD_IMMEDIATE);
+		Model* world = wiRenderer::GetScene().models.front();
+		probe->attachTo(world);
+		world->environmentProbes.push_back(probe);
+	}
+	// the copy is in the probe
+	wiResourceManager::GetGlobal()->del(fileName);
+	return valid;
+}
+
+void EditorComponent::RestoreBakes(const string& sceneFileName)
+{
+	if (packageLoader.IsActive())
+	{
+		pendingBakes = sceneFileName;
+		return;
+	}
+	pendingBakes.clear();
+
+	vector<BakeCache::ManifestEntry> entries;
+	if (!BakeCache::ReadManifest(sceneFileName + ".bakes", entries))
+	{
+		return;
+	}
+
+	for (auto& x : entries)
+	{
+		if (x.kind == BakeCache::KIND_PROBE)
+		{
+			envProbeWnd->bakeQueue.Push(x.position, x.resolution);
+			continue;
+		}
+		for (auto& y : wiRenderer::GetScene().models)
+		{
+			auto it = y->meshes.find(x.meshName);
+			if (it != y->meshes.end())
+			{
+				worldWnd->impostorBatch.Push(it->second);
+				break;
+			}
+		}
+	}
+}
+void EditorComponent::FinishStreaming()
+{
+	if (packageLoader.IsActive())
+	{
+		packageLoader.Drain(FLOAT32_MAX, UINT32_MAX);
+		worldWnd->UpdateFromRenderer();
+		TrackSceneTextures();
+	}
+}
+void EditorComponent::OptimizeNewMeshes(const vector<Mesh*>& existing)
+{
+	if (!main->optimizeOnImport)
+	{
+		return;
+	}
+	unordered_set<Mesh*> before(existing.begin(), existing.end());
+	vector<Mesh*> added;
+	for (auto& x : GetSceneMeshes())
+	{
+		if (before.find(x) == before.end())
+		{
+			added.push_back(x);
+		}
+	}
+	if (!added.empty())
+	{
+		meshWnd->OptimizeMeshes(added);
+	}
+}
+void EditorComponent::Initialize()
+{
+	setShadowsEnabled(true);
+	setReflectionsEnabled(true);
+	setSSAOEnabled(false);
+	setSSREnabled(false);
+	setMotionBlurEnabled(false);
+	setColorGradingEnabled(false);
+	setEyeAdaptionEnabled(false);
+	setFXAAEnabled(false);
+	setDepthOfFieldEnabled(false);
+	setLightShaftsEnabled(false);
+
+	SAFE_INIT(materialWnd);
+	SAFE_INIT(postprocessWnd);
+	SAFE_INIT(worldWnd);
+	SAFE_INIT(objectWnd);
+	SAFE_INIT(meshWnd);
+	SAFE_INIT(cameraWnd);
+	SAFE_INIT(rendererWnd);
+
+	__super::Initialize();
+}
+void EditorComponent::Load()
+{
+	__super::Load();
+
+	translator = new wiTranslator;
+	translator->enabled = false;
+	editorHost.component = this;
+
+	historyJournal.SetBudget(main->historyBudget);
+	historyJournal.SetSpillDirectory("temp/");
+	historyJournal.SetDiscardCallback(DiscardTombstone);
+	ResetHistory();
+
+	sceneWriter.autosaveInterval = main->autosaveInterval;
+	sceneWriter.autosaveFileName = "temp/autosave.wimf";
+	contentCache.SetManager(&Content);
+	contentCache.SetBudget(main->contentBudget);
+
+	// Scripts and recordings load and save synchronously, so that every run does the same work in the
+	//	same frames
+	auto loadScene = [=](const string& fileName) {
+		sceneWriter.Wait();
+		EndTranslate();
+		selected.Clear();
+		if (packageLoader.Start(fileName, __editorVersion))
+		{
+			packageLoader.Drain(FLOAT32_MAX, UINT32_MAX);
+		}
+		else
+		{
+			string dir, file;
+			wiHelper::SplitPath(fileName, dir, file);
+			vector<Mesh*> existing = GetSceneMeshes();
+			wiRenderer::LoadModel(dir, file.substr(0, file.find_last_of('.')));
+			OptimizeNewMeshes(existing);
+		}
+		worldWnd->UpdateFromRenderer();
+		TrackSceneTextures();
+		SceneIndex::GetInstance()->Rebuild(wiRenderer::GetScene().GetWorldNode());
+		picker.Invalidate();
+		ResetHistory();
+		RestoreBakes(fileName);
+	};
+	if (!main->inputScript.empty() && !scriptedInput.Load(main->inputScript))
+	{
+		wiBackLog::post(scriptedInput.GetError().c_str());
+	}
+	else if (!main->inputScript.empty())
+	{
+		scriptedInput.SetCommandCallback([=](const string& command, const string& argument) {
+			if (command == "load")
+			{
+				loadScene(argument);
+			}
+			else if (command == "save")
+			{
+				EndTranslate();
+				FinishStreaming();
+				sceneWriter.Wait();
+				sceneWriter.Save(argument);
+				sceneWriter.Wait();
+			}
+			else
+			{
+				wiBackLog::post(("Unknown input script command: " + command).c_str());
+			}
+		});
+		editorInput = &scriptedInput;
+	}
+	else if (!main->inputReplay.empty() && replayInput.Load(main->inputReplay))
+	{
+		editorInput = &replayInput;
+	}
+	else if (!main->inputRecording.empty() && recordingInput.Open(main->inputRecording))
+	{
+		editorInput = &recordingInput;
+	}
+	// The scene of a recording is loaded before its first frame, both when recording and replaying
+	if (!main->inputScene.empty())
+	{
+		string fileName = main->inputScene;
+		mainThreadQueue.Post([=] {
+			loadScene(fileName);
+		});
+	}
+	// Recorded, replayed and scripted sessions step once per frame: without frame skipping every frame
+	//	runs exactly one update, which plays exactly one recorded frame, however long the frames take
+	if (editorInput != &engineInput)
+	{
+		main->setFrameSkip(false);
+	}
+	// Benchmark runs are timed frame by frame, without waiting for the vertical blank
+	if (editorInput == &scriptedInput || editorInput == &replayInput)
+	{
+		wiRenderer::GetDevice()->SetVSyncEnabled(false);
+		frameTimings.Clear();
+	}
+
+	SceneIndex::GetInstance()->Rebuild(wiRenderer::GetScene().GetWorldNode());
+
+	materialWnd = new MaterialWindow(&GetGUI());
+	postprocessWnd = new PostprocessWindow(this);
+	worldWnd = new WorldWindow(&GetGUI());
+	objectWnd = new ObjectWindow(&GetGUI());
+	meshWnd = new MeshWindow(&GetGUI());
+	cameraWnd = new CameraWindow(&GetGUI());
+	rendererWnd = new RendererWindow(this);
+	envProbeWnd = new EnvProbeWindow(&GetGUI());
+	decalWnd = new DecalWindow(&GetGUI());
+	lightWnd = new LightWindow(&GetGUI());
+
+	envProbeWnd->bakeQueue.SetBakeFunction([=](const ProbeBakeQueue::Request& request) {
+		// A rebake puts a new probe in place of the old one, unless the old one was deleted since
+		if (request.replaces != nullptr)
+		{
+			EnvironmentProbe* probe = (EnvironmentProbe*)request.replaces;
+			Model* owner = nullptr;
+			for (auto& x : wiRenderer::GetScene().models)
+			{
+				if (find(x->environmentProbes.begin(), x->environmentProbes.end(), probe) != x->environmentProbes.end())
+				{
+					owner = x;
+					break;
+				}
+			}
+			if (owner == nullptr)
+			{
+				return false;
+			}
+			if (selected.Contains(probe->GetID()))
+			{
+				EndTranslate();
+				selected.Remove(probe->GetID());
+			}
+			hovered = wiRenderer::Picked();
+			owner->environmentProbes.erase(find(owner->environmentProbes.begin(), owner->environmentProbes.end(), probe));
+			SceneIndex::GetInstance()->Remove(probe);
+			BakeCache::GetInstance()->Forget(probe);
+			probe->detach();
+			SAFE_DELETE(probe);
+		}
+
+		// The new probe is the one that wasn't there before, its key is made from the scene it saw
+		unordered_set<EnvironmentProbe*> probes;
+		for (auto& x : wiRenderer::GetScene().models)
+		{
+			probes.insert(x->environmentProbes.begin(), x->environmentProbes.end());
+		}
+		uint64_t key = BakeCache::GetInstance()->GetProbeKey(request.position, request.resolution);
+		bakeStore.Restore(key, [&](const string& fileName) {
+			return RestoreProbe(request.position, request.resolution, fileName);
+		}, [&](const string& fileName) {
+			wiRenderer::PutEnvProbe(request.position, request.resolution);
+			EnvironmentProbe* probe = FindNewProbe(probes);
+			return probe != nullptr && SUCCEEDED(wiRenderer::GetDevice()->SaveTextureDDS(fileName, probe->cubeMap.GetTexture()));
+		});
+		EnvironmentProbe* probe = FindNewProbe(probes);
+		if (probe != nullptr)
+		{
+			BakeCache::GetInstance()->SetBaked(probe, key, request.resolution);
+		}
+		return true;
+	});
+
+	float screenW = (float)wiRenderer::GetDevice()->GetScreenWidth();
+	float screenH = (float)wiRenderer::GetDevice()->GetScreenHeight();
+
+	float step = 105, x = -step;
+
+	wiButton* rendererWnd_Toggle = new wiButton("Renderer");
+	rendererWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
+	rendererWnd_Toggle->SetSize(XMFLOAT2(100, 40));
+	rendererWnd_Toggle->SetFontScaling(0.3f);
+	rendererWnd_Toggle->OnClick([=](wiEventArgs args) {
+		rendererWnd->rendererWindow->SetVisible(!rendererWnd->rendererWindow->IsVisible());
+	});
+	GetGUI().AddWidget(rendererWnd_Toggle);
+
+	wiButton* worldWnd_Toggle = new wiButton("World");
+	worldWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
+	worldWnd_Toggle->SetSize(XMFLOAT2(100, 40));
+	worldWnd_Toggle->SetFontScaling(0.4f);
+	worldWnd_Toggle->OnClick([=](wiEventArgs args) {
+		worldWnd->worldWindow->SetVisible(!worldWnd->worldWindow->IsVisible());
+	});
+	GetGUI().AddWidget(worldWnd_Toggle);
+
+	wiButton* objectWnd_Toggle = new wiButton("Object");
+	objectWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
+	objectWnd_Toggle->SetSize(XMFLOAT2(100, 40));
+	objectWnd_Toggle->SetFontScaling(0.4f);
+	objectWnd_Toggle->OnClick([=](wiEventArgs args) {
+		objectWnd->objectWindow->SetVisible(!objectWnd->objectWindow->IsVisible());
+	});
+	GetGUI().AddWidget(objectWnd_Toggle);
+
+	wiButton* meshWnd_Toggle = new wiButton("Mesh");
+	meshWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
+	meshWnd_Toggle->SetSize(XMFLOAT2(100, 40));
+	meshWnd_Toggle->SetFontScaling(0.4f);
+	meshWnd_Toggle->OnClick([=](wiEventArgs args) {
+		meshWnd->meshWindow->SetVisible(!meshWnd->meshWindow->IsVisible());
+	});
+	GetGUI().AddWidget(meshWnd_Toggle);
+
+	wiButton* materialWnd_Toggle = new wiButton("Material");
+	materialWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
+	materialWnd_Toggle->SetSize(XMFLOAT2(100, 40));
+	materialWnd_Toggle->SetFontScaling(0.3f);
+	materialWnd_Toggle->OnClick([=](wiEventArgs args) {
+		materialWnd->materialWindow->SetVisible(!materialWnd->materialWindow->IsVisible());
+	});
+	GetGUI().AddWidget(materialWnd_Toggle);
+
+	wiButton* postprocessWnd_Toggle = new wiButton("PostProcess");
+	postprocessWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
+	postprocessWnd_Toggle->SetSize(XMFLOAT2(100, 40));
+	postprocessWnd_Toggle->SetFontScaling(0.22f);
+	postprocessWnd_Toggle->OnClick([=](wiEventArgs args) {
+		postprocessWnd->ppWindow->SetVisible(!postprocessWnd->ppWindow->IsVisible());
+	});
+	GetGUI().AddWidget(postprocessWnd_Toggle);
+
+	wiButton* cameraWnd_Toggle = new wiButton("Camera");
+	cameraWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
+	cameraWnd_Toggle->SetSize(XMFLOAT2(100, 40));
+	cameraWnd_Toggle->SetFontScaling(0.3f);
+	cameraWnd_Toggle->OnClick([=](wiEventArgs args) {
+		cameraWnd->cameraWindow->SetVisible(!cameraWnd->cameraWindow->IsVisible());
+	});
+	GetGUI().AddWidget(cameraWnd_Toggle);
+
+	wiButton* envProbeWnd_Toggle = new wiButton("EnvProbe");
+	envProbeWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
+	envProbeWnd_Toggle->SetSize(XMFLOAT2(100, 40));
+	envProbeWnd_Toggle->SetFontScaling(0.3f);
+	envProbeWnd_Toggle->OnClick([=](wiEventArgs args) {
+		envProbeWnd->envProbeWindow->SetVisible(!envProbeWnd->envProbeWindow->IsVisible());
+	});
+	GetGUI().AddWidget(envProbeWnd_Toggle);
+
+	wiButton* decalWnd_Toggle = new wiButton("Decal");
+	decalWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
+	decalWnd_Toggle->SetSize(XMFLOAT2(100, 40));
+	decalWnd_Toggle->SetFontScaling(0.3f);
+	decalWnd_Toggle->OnClick([=](wiEventArgs args) {
+		decalWnd->decalWindow->SetVisible(!decalWnd->decalWindow->IsVisible());
+	});
+	GetGUI().AddWidget(decalWnd_Toggle);
+
+	wiButton* lightWnd_Toggle = new wiButton("Light");
+	lightWnd_Toggle->SetPos(XMFLOAT2(x += step, screenH - 40));
+	lightWnd_Toggle->SetSize(XMFLOAT2(100, 40));
+	lightWnd_Toggle->SetFontScaling(0.3f);
+	lightWnd_Toggle->OnClick([=](wiEventArgs args) {
+		lightWnd->lightWindow->SetVisible(!lightWnd->lightWindow->IsVisible());
+	});
+	GetGUI().AddWidget(lightWnd_Toggle);
+
+
+	////////////////////////////////////////////////////////////////////////////////////
+
+
+
+	wiCheckBox* translatorCheckBox = new wiCheckBox("Translator: ");
+	translatorCheckBox->SetPos(XMFLOAT2(screenW - 495, 0));
+	translatorCheckBox->SetSize(XMFLOAT2(18, 18));
+	translatorCheckBox->OnClick([=](wiEventArgs args) {
+		if(!args.bValue)
+			EndTranslate();
+		translator->enabled = args.bValue;
+	});
+	GetGUI().AddWidget(translatorCheckBox);
+
+	wiCheckBox* isScalatorCheckBox = new wiCheckBox("S:");
+	isScalatorCheckBox->SetPos(XMFLOAT2(screenW - 575, 22));
+	isScalatorCheckBox->SetSize(XMFLOAT2(18, 18));
+	isScalatorCheckBox->OnClick([=](wiEventArgs args) {
+		translator->isScalator = args.bValue;
+	});
+	isScalatorCheckBox->SetCheck(translator->isScalator);
+	GetGUI().AddWidget(isScalatorCheckBox);
+
+	wiCheckBox* isRotatorCheckBox = new wiCheckBox("R:");
+	isRotatorCheckBox->SetPos(XMFLOAT2(screenW - 535, 22));
+	isRotatorCheckBox->SetSize(XMFLOAT2(18, 18));
+	isRotatorCheckBox->OnClick([=](wiEventArgs args) {
+		translator->isRotator = args.bValue;
+	});
 	isRotatorCheckBox->SetCheck(translator->isRotator);
 	GetGUI().AddWidget(isRotatorCheckBox);
 
@@ -407,33 +1240,19 @@ void EditorComponent::Load()
 			{
 				fileName += ".wimf";
 			}
-			wiArchive archive(fileName, false);
-			if (archive.IsOpen())
+			// A streaming scene would be saved half loaded, and the previous save or autosave must be
+			//	finished before a new snapshot is taken
+			FinishStreaming();
+			sceneWriter.Wait();
+			sceneWriter.Save(fileName);
+			BakeCache::GetInstance()->WriteManifest(fileName + ".bakes");
+			// Meshes could have been deleted since the last batch, only the ones still there are written
+			if (!worldWnd->impostorBatch.GetAtlasPages().empty())
 			{
-				Model* fullModel = new Model;
-				auto& children = wiRenderer::GetScene().GetWorldNode()->children;
-				for(auto& x : children)
-				{
-					Model* model = dynamic_cast<Model*>(x);
-					if (model != nullptr)
-					{
-						fullModel->Add(model);
-					}
-				}
-				fullModel->Serialize(archive);
-
-				fullModel->objects.clear();
-				fullModel->lights.clear();
-				fullModel->decals.clear();
-				fullModel->meshes.clear();
-				fullModel->materials.clear();
-				SAFE_DELETE(fullModel);
-				ResetHistory();
-			}
-			else
-			{
-				wiHelper::messageBox("Could not create " + fileName + "!");
+				worldWnd->impostorBatch.BuildAtlas();
 			}
+			worldWnd->impostorBatch.WriteAtlas(fileName + ".impostors");
+			ResetHistory();
 		}
 	});
 	GetGUI().AddWidget(saveButton);
@@ -478,15 +1297,43 @@ void EditorComponent::Load()
 					file = file.substr(0, file.length() - 4);
 				}
 
-				loader->addLoadingFunction([=] {
-					wiRenderer::LoadModel(dir, file);
-				});
-				loader->onFinished([=] {
-					main->activateComponent(this);
-					worldWnd->UpdateFromRenderer();
+				// The loading screen is set up on the main thread
+				mainThreadQueue.Post([=] {
+					// Packages are saved by the editor, only plain archives are imports
+					bool imported = !ScenePackage::IsPackage(fileName);
+					vector<Mesh*> existing = GetSceneMeshes();
+					loader->addLoadingFunction([=] {
+						// A package that is still streaming is completed first
+						packageLoader.Drain(FLOAT32_MAX, UINT32_MAX);
+
+						// Chunked packages are decoded on worker threads, the loading screen only waits for the
+						//	lights and decals and the first chunk, the rest is added after it. Everything else
+						//	is a plain model archive.
+						if (packageLoader.Start(fileName, __editorVersion))
+						{
+							packageLoader.Drain(0, 2);
+						}
+						else
+						{
+							wiRenderer::LoadModel(dir, file);
+						}
+					});
+					loader->onFinished([=] {
+						mainThreadQueue.Post([=] {
+							main->activateComponent(this);
+							worldWnd->UpdateFromRenderer();
+							TrackSceneTextures();
+							SceneIndex::GetInstance()->Rebuild(wiRenderer::GetScene().GetWorldNode());
+							if (imported)
+							{
+								OptimizeNewMeshes(existing);
+							}
+							RestoreBakes(fileName);
+						});
+					});
+					main->activateComponent(loader);
+					ResetHistory();
 				});
-				main->activateComponent(loader);
-				ResetHistory();
 			}
 		}).detach();
 	});
@@ -524,13 +1371,19 @@ void EditorComponent::Load()
 				ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
 				if (GetOpenFileNameA(&ofn) == TRUE) {
 					string fileName = ofn.lpstrFile;
-					wiRenderer::SetEnviromentMap((Texture2D*)Content.add(fileName));
+					mainThreadQueue.Post([=] {
+						contentCache.Release(skyTextureName);
+						skyTextureName = fileName;
+						wiRenderer::SetEnviromentMap((Texture2D*)contentCache.Acquire(fileName));
+					});
 				}
 			}).detach();
 		}
 		else
 		{
 			wiRenderer::SetEnviromentMap(nullptr);
+			contentCache.Release(skyTextureName);
+			skyTextureName.clear();
 		}
 
 	});
@@ -568,13 +1421,19 @@ void EditorComponent::Load()
 				ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
 				if (GetOpenFileNameA(&ofn) == TRUE) {
 					string fileName = ofn.lpstrFile;
-					wiRenderer::SetColorGrading((Texture2D*)Content.add(fileName));
+					mainThreadQueue.Post([=] {
+						contentCache.Release(colorGradingTextureName);
+						colorGradingTextureName = fileName;
+						wiRenderer::SetColorGrading((Texture2D*)contentCache.Acquire(fileName));
+					});
 				}
 			}).detach();
 		}
 		else
 		{
 			wiRenderer::SetColorGrading(nullptr);
+			contentCache.Release(colorGradingTextureName);
+			colorGradingTextureName.clear();
 		}
 
 	});
@@ -587,10 +1446,23 @@ void EditorComponent::Load()
 	clearButton->SetFontScaling(0.25f);
 	clearButton->SetColor(wiColor(190, 0, 0, 200), wiWidget::WIDGETSTATE::IDLE);
 	clearButton->SetColor(wiColor(255, 0, 0, 255), wiWidget::WIDGETSTATE::FOCUS);
-	clearButton->OnClick([](wiEventArgs args) {
-		selected.clear();
+	clearButton->OnClick([=](wiEventArgs args) {
+		sceneWriter.Wait();
+		packageLoader.Cancel();
+		pendingBakes.clear();
+		envProbeWnd->bakeQueue.Clear();
+		worldWnd->impostorBatch.Clear();
+		MeshLODs::GetInstance()->Clear();
+		BakeCache::GetInstance()->Clear();
 		EndTranslate();
+		ClearSelected();
+		ResetHistory();
+		ClearClipboard();
+		// Nothing may look the freed nodes up in between
+		SceneIndex::GetInstance()->Clear();
 		wiRenderer::CleanUpStaticTemp();
+		ReleaseSceneTextures();
+		SceneIndex::GetInstance()->Rebuild(wiRenderer::GetScene().GetWorldNode());
 	});
 	GetGUI().AddWidget(clearButton);
 
@@ -602,385 +1474,155 @@ void EditorComponent::Load()
 	exitButton->SetColor(wiColor(190, 0, 0, 200), wiWidget::WIDGETSTATE::IDLE);
 	exitButton->SetColor(wiColor(255, 0, 0, 255), wiWidget::WIDGETSTATE::FOCUS);
 	exitButton->OnClick([](wiEventArgs args) {
-		exit(0);
-	});
-	GetGUI().AddWidget(exitButton);
-
-
-
-	
-
-	pointLightTex = *(Texture2D*)Content.add("Resource/pointlight.dds");
-	spotLightTex = *(Texture2D*)Content.add("Resource/spotlight.dds");
-	dirLightTex = *(Texture2D*)Content.add("Resource/directional_light.dds");
-}
-void EditorComponent::Start()
-{
-	__super::Start();
-}
-void EditorComponent::Update()
-{
-	if (!wiBackLog::isActive())
-	{
-		static XMFLOAT4 originalMouse = XMFLOAT4(0, 0, 0, 0);
-		XMFLOAT4 currentMouse = wiInputManager::GetInstance()->getpointer();
-		float xDif = 0, yDif = 0;
-		if (wiInputManager::GetInstance()->down(VK_MBUTTON))
-		{
-			xDif = currentMouse.x - originalMouse.x;
-			yDif = currentMouse.y - originalMouse.y;
-			xDif = 0.1f*xDif*(1.0f / 60.0f);
-			yDif = 0.1f*yDif*(1.0f / 60.0f);
-			wiInputManager::GetInstance()->setpointer(originalMouse);
-		}
-		else
-		{
-			originalMouse = wiInputManager::GetInstance()->getpointer();
-		}
-
-		Camera* cam = wiRenderer::getCamera();
-
-		if (cameraWnd->fpscamera)
-		{
-			// FPS Camera
-			cam->detach();
-			if (!wiInputManager::GetInstance()->down(VK_CONTROL))
-			{
-				// Only move camera if control not pressed
-				float speed = (wiInputManager::GetInstance()->down(VK_SHIFT) ? 1.0f : 0.1f);
-				if (wiInputManager::GetInstance()->down('A')) cam->Move(XMVectorSet(-speed, 0, 0, 0));
-				if (wiInputManager::GetInstance()->down('D')) cam->Move(XMVectorSet(speed, 0, 0, 0));
-				if (wiInputManager::GetInstance()->down('W')) cam->Move(XMVectorSet(0, 0, speed, 0));
-				if (wiInputManager::GetInstance()->down('S')) cam->Move(XMVectorSet(0, 0, -speed, 0));
-				if (wiInputManager::GetInstance()->down('E')) cam->Move(XMVectorSet(0, speed, 0, 0));
-				if (wiInputManager::GetInstance()->down('Q')) cam->Move(XMVectorSet(0, -speed, 0, 0));
-			}
-			cam->RotateRollPitchYaw(XMFLOAT3(yDif, xDif, 0));
-		}
-		else
-		{
-			// Orbital Camera
-			if (cam->parent == nullptr)
-			{
-				cam->attachTo(cameraWnd->orbitalCamTarget);
-			}
-			if (wiInputManager::GetInstance()->down(VK_LSHIFT))
-			{
-				XMVECTOR V = XMVectorAdd(cam->GetRight() * xDif, cam->GetUp() * yDif) * 10;
-				XMFLOAT3 vec;
-				XMStoreFloat3(&vec, V);
-				cameraWnd->orbitalCamTarget->Translate(vec);
-			}
-			else if (wiInputManager::GetInstance()->down(VK_LCONTROL))
-			{
-				cam->Translate(XMFLOAT3(0, 0, yDif * 4));
-			}
-			else
-			{
-				cameraWnd->orbitalCamTarget->RotateRollPitchYaw(XMFLOAT3(yDif*2, xDif*2, 0));
-			}
-		}
-
-
-		// Select...
-		hovered = wiRenderer::Pick((long)currentMouse.x, (long)currentMouse.y, rendererWnd->GetPickType());
-		if (wiInputManager::GetInstance()->press(VK_RBUTTON))
-		{
-			history = new wiArchive(AdvanceHistory(), false);
-			*history << __editorVersion;
-			*history << (int)HISTORYOP_SELECTION;
-
-
-			wiRenderer::Picked* picked = new wiRenderer::Picked(hovered);
-
-			if (!selected.empty() && wiInputManager::GetInstance()->down(VK_LSHIFT))
-			{
-				list<wiRenderer::Picked*>::iterator it = selected.begin();
-				for (; it != selected.end(); ++it)
-				{
-					if ((*it) == picked)
-					{
-						break;
-					}
-				}
-				if (it==selected.end() && picked->transform != nullptr)
-				{
-					*history << (int)0; // add sel
-					*history << picked->transform->GetID();
-
-					selected.push_back(picked);
-					savedParents.insert(pair<Transform*, Transform*>(picked->transform, picked->transform->parent));
-				}
-				else
-				{
-					*history << (int)1; // remove from sel
-					*history << (*it)->transform->GetID();
-
-					EndTranslate();
-					selected.erase(it);
-					savedParents.erase((*it)->transform);
-				}
-			}
-			else
-			{
-				*history << (int)2; // clear sel, new sel
-
-				EndTranslate();
-				ClearSelected();
-				selected.push_back(picked);
-				if (picked->transform != nullptr)
-				{
-					savedParents.insert(pair<Transform*, Transform*>(picked->transform, picked->transform->parent));
-				}
-			}
-
-			SAFE_DELETE(history);
-
-			objectWnd->SetObject(picked->object);
-
-			if (picked->transform != nullptr)
-			{
-				EndTranslate();
-
-				if (picked->object != nullptr)
-				{
-					meshWnd->SetMesh(picked->object->mesh);
-					if (picked->subsetIndex < (int)picked->object->mesh->subsets.size())
-					{
-						Material* material = picked->object->mesh->subsets[picked->subsetIndex].material;
-
-						materialWnd->SetMaterial(material);
-					}
-					if (picked->object->isArmatureDeformed())
-					{
-						savedParents.erase(picked->object);
-						picked->transform = picked->object->mesh->armature;
-						savedParents.insert(pair<Transform*, Transform*>(picked->transform, picked->transform->parent));
-					}
-				}
-				else
-				{
-					meshWnd->SetMesh(nullptr);
-					materialWnd->SetMaterial(nullptr);
-				}
-
-				if (picked->light != nullptr)
-				{
-				}
-				lightWnd->SetLight(picked->light);
-				if (picked->decal != nullptr)
-				{
-				}
-				decalWnd->SetDecal(picked->decal);
-
-				BeginTranslate();
-
-			}
-			else
-			{
-				meshWnd->SetMesh(nullptr);
-				materialWnd->SetMaterial(nullptr);
-
-				EndTranslate();
-				ClearSelected();
-			}
-		}
-
-		// Delete
-		if (wiInputManager::GetInstance()->press(VK_DELETE))
-		{
-			history = new wiArchive(AdvanceHistory(), false);
-			*history << __editorVersion;
-			*history << HISTORYOP_DELETE;
-			*history << selected.size();
-			for (auto& x : selected)
-			{
-				if (x->object != nullptr)
-				{
-					*history << true;
-					x->object->Serialize(*history);
-					x->object->mesh->Serialize(*history);
-					*history << x->object->mesh->subsets.size();
-					for (auto& y : x->object->mesh->subsets)
-					{
-						y.material->Serialize(*history);
-					}
-
-					wiRenderer::Remove(x->object);
-					SAFE_DELETE(x->object);
-					x->transform = nullptr;
-				}
-				else
-				{
-					*history << false;
-				}
-
-				if (x->light != nullptr)
-				{
-					*history << true;
-					x->light->Serialize(*history);
-
-					wiRenderer::Remove(x->light);
-					SAFE_DELETE(x->light);
-					x->transform = nullptr;
-				}
-				else
-				{
-					*history << false;
-				}
-
-				if (x->decal != nullptr)
-				{
-					*history << true;
-					x->decal->Serialize(*history);
-
-					wiRenderer::Remove(x->decal);
-					SAFE_DELETE(x->decal);
-					x->transform = nullptr;
-				}
-				else
-				{
-					*history << false;
-				}
-
-				if (x->transform != nullptr)
-				{
-					*history << true;
-					*history << x->transform->GetID();
-
-					EnvironmentProbe* envProbe = dynamic_cast<EnvironmentProbe*>(x->transform);
-					if (envProbe != nullptr)
-					{
-						wiRenderer::Remove(envProbe);
-						SAFE_DELETE(envProbe);
-					}
-				}
-				else
-				{
-					*history << false;
-				}
-			}
-			SAFE_DELETE(history);
-			ClearSelected();
-		}
-		// Control operations...
-		if (wiInputManager::GetInstance()->down(VK_CONTROL))
-		{
-			// Copy
-			if (wiInputManager::GetInstance()->press('C'))
-			{
-				clipboard_write = new wiArchive("temp/clipboard", false);
-				*clipboard_write << __editorVersion;
-				*clipboard_write << CLIPBOARD_MODEL;
-				Model* model = new Model;
-				for (auto& x : selected)
-				{
-					model->Add(x->object);
-					model->Add(x->light);
-					model->Add(x->decal);
-				}
-				model->Serialize(*clipboard_write);
-				SAFE_DELETE(clipboard_write);
-
-				model->objects.clear();
-				model->lights.clear();
-				model->decals.clear();
-				model->meshes.clear();
-				model->materials.clear();
-				SAFE_DELETE(model);
-			}
-			// Paste
-			if (wiInputManager::GetInstance()->press('V'))
-			{
-				clipboard_read = new wiArchive("temp/clipboard", true);
-				int version;
-				// version check is maybe not yet used, but is here intentionally for future bacwards-compatibility!
-				*clipboard_read >> version;
-				int tmp;
-				*clipboard_read >> tmp;
-				ClipboardItemType type = (ClipboardItemType)tmp;
-				switch (type)
-				{
-				case CLIPBOARD_MODEL:
-				{
-					Model* model = new Model;
-					model->Serialize(*clipboard_read);
-					wiRenderer::AddModel(model);
-				}
-				break;
-				case CLIPBOARD_EMPTY:
-					break;
-				default:
-					break;
-				}
-				SAFE_DELETE(clipboard_read);
-			}
-			// Duplicate Instances
-			if (wiInputManager::GetInstance()->press('D'))
-			{
-				for (auto& x : selected)
-				{
-					if (x->object != nullptr)
-					{
-						Object* o = new Object(*x->object);
-						o->detach();
-						wiRenderer::Add(o);
-					}
-					if (x->light != nullptr)
-					{
-						Light* l = new Light(*x->light);
-						l->detach();
-						wiRenderer::Add(l);
-					}
-				}
-			}
-			// Undo
-			if (wiInputManager::GetInstance()->press('Z'))
-			{
-				ConsumeHistoryOperation(true);
-			}
-			// Redo
-			if (wiInputManager::GetInstance()->press('Y'))
-			{
-				ConsumeHistoryOperation(false);
-			}
+		sceneWriter.Wait();
+		exit(0);
+	});
+	GetGUI().AddWidget(exitButton);
+
+
+
+	
+
+	// The icons are used for the lifetime of the editor, they are never released
+	pointLightTex = *(Texture2D*)contentCache.Acquire("Resource/pointlight.dds");
+	spotLightTex = *(Texture2D*)contentCache.Acquire("Resource/spotlight.dds");
+	dirLightTex = *(Texture2D*)contentCache.Acquire("Resource/directional_light.dds");
+}
+void EditorComponent::Start()
+{
+	__super::Start();
+}
+void EditorComponent::Update()
+{
+	PROFILE_SCOPE("Editor update");
+
+	bool quiet = mainThreadQueue.Drain() == 0;
+
+	editorInput->Update();
+	if (editorInput == &scriptedInput || editorInput == &replayInput)
+	{
+		frameTimings.Frame();
+	}
+	if (editorInput->IsFinished() && !inputFinished)
+	{
+		inputFinished = true;
+		sceneWriter.Wait();
+
+		string summary = frameTimings.GetSummary();
+		wiBackLog::post(summary.c_str());
+		printf("%s\n", summary.c_str());
+		if (!frameTimings.WriteCSV(main->timingsFile))
+		{
+			printf("Could not write %s\n", main->timingsFile.c_str());
 		}
+		fflush(stdout);
+		PostQuitMessage(0);
+	}
+
+	{
+		PROFILE_SCOPE("Input");
+		editorCore.Update(*editorInput);
+	}
+
+	bool translatorDragEnded;
+	XMFLOAT4X4 translatorDragStart, translatorDragEnd;
+	{
+		PROFILE_SCOPE("Translator");
+		translatorDragEnded = editorInput->UpdateTranslator(translator, translatorDragStart, translatorDragEnd);
+	}
+
+	{
+		PROFILE_SCOPE("Probe baking");
+		envProbeWnd->Update(probeBakeBudget);
+	}
 
+	// The writer reads the meshes and materials while it runs: they stay in full detail, impostors
+	//	wait and the windows that edit them are locked until it is done
+	if (!sceneWriter.IsBusy())
+	{
+		PROFILE_SCOPE("Impostor baking");
+		worldWnd->Update(impostorBakeBudget);
+	}
+	if (!sceneWriter.IsBusy())
+	{
+		PROFILE_SCOPE("LOD selection");
+		Camera* camera = wiRenderer::getCamera();
+		MeshLODs::GetInstance()->Select(camera->translation, camera->fov, (float)wiRenderer::GetDevice()->GetScreenHeight(), lodErrorPixels);
+	}
+
+	// A streaming scene is not autosaved until all of it is there
+	sceneWriter.Update(!packageLoader.IsActive());
+	meshWnd->SetLocked(sceneWriter.IsBusy());
+	materialWnd->SetLocked(sceneWriter.IsBusy());
+
+	const ContentCache::Stats& contentStats = contentCache.GetStats();
+	if (contentStats.evictions != lastEvictionCount)
+	{
+		lastEvictionCount = contentStats.evictions;
+		stringstream ss("");
+		ss << "Content cache: " << contentStats.count << " resources, " << contentStats.resident / 1024 << " KB resident, "
+			<< contentStats.referenced / 1024 << " KB referenced, " << contentStats.hits << " hits, " << contentStats.misses
+			<< " misses, " << contentStats.evictions << " evictions";
+		wiBackLog::post(ss.str().c_str());
 	}
 
-	translator->Update();
+	if (packageLoader.IsActive() && packageLoader.Drain(streamingBudget))
+	{
+		worldWnd->UpdateFromRenderer();
+		TrackSceneTextures();
+	}
+	if (!pendingBakes.empty())
+	{
+		RestoreBakes(pendingBakes);
+	}
 
-	if (translator->IsDragEnded())
+	if (translatorDragEnded)
 	{
-		history = new wiArchive(AdvanceHistory(), false);
+		picker.MarkMoved();
+
+		history = AdvanceHistory();
 		*history << __editorVersion;
 		*history << HISTORYOP_TRANSLATOR;
-		*history << translator->GetDragStart();
-		*history << translator->GetDragEnd();
-		SAFE_DELETE(history);
+		*history << translatorDragStart;
+		*history << translatorDragEnd;
+		EndHistory();
+	}
+
+	// Input is not checked here, every window message wakes the main loop up
+	Camera* camera = wiRenderer::getCamera();
+	if (memcmp(&camera->translation, &idleCamera.translation, sizeof(XMFLOAT3)) != 0 ||
+		memcmp(&camera->rotation, &idleCamera.rotation, sizeof(XMFLOAT4)) != 0)
+	{
+		idleCamera.translation = camera->translation;
+		idleCamera.rotation = camera->rotation;
+		quiet = false;
 	}
+	if (packageLoader.IsActive() || sceneWriter.IsBusy() || !envProbeWnd->bakeQueue.IsEmpty() || !worldWnd->impostorBatch.IsEmpty() || EditorProfiler::GetInstance()->IsEnabled() || IsSceneAnimating())
+	{
+		quiet = false;
+	}
+	idleState.Update(quiet);
 
+	PROFILE_SCOPE("Engine update");
 	__super::Update();
 }
 void EditorComponent::Render()
 {
+	PROFILE_SCOPE("Editor render");
+
 	// hover box
 	{
 		if (hovered.object != nullptr)
 		{
-			XMFLOAT4X4 hoverBox;
-			XMStoreFloat4x4(&hoverBox, hovered.object->bounds.getAsBoxMatrix());
-			wiRenderer::AddRenderableBox(hoverBox, XMFLOAT4(0.5f, 0.5f, 0.5f, 0.5f));
+			debugDraw.AddBox(hovered.object->bounds, XMFLOAT4(0.5f, 0.5f, 0.5f, 0.5f));
 		}
 		if (hovered.light != nullptr)
 		{
-			XMFLOAT4X4 hoverBox;
-			XMStoreFloat4x4(&hoverBox, hovered.light->bounds.getAsBoxMatrix());
-			wiRenderer::AddRenderableBox(hoverBox, XMFLOAT4(0.5f, 0.5f, 0, 0.5f));
+			debugDraw.AddBox(hovered.light->bounds, XMFLOAT4(0.5f, 0.5f, 0, 0.5f));
 		}
 		if (hovered.decal != nullptr)
 		{
-			wiRenderer::AddRenderableBox(hovered.decal->world, XMFLOAT4(0.5f, 0, 0.5f, 0.5f));
+			debugDraw.AddBox(hovered.decal->world, XMFLOAT4(0.5f, 0, 0.5f, 0.5f));
 		}
 
 	}
@@ -992,85 +1634,119 @@ void EditorComponent::Render()
 			wiRenderer::AddRenderableTranslator(translator);
 		}
 
-		AABB selectedAABB = AABB(XMFLOAT3(FLOAT32_MAX, FLOAT32_MAX, FLOAT32_MAX),XMFLOAT3(-FLOAT32_MAX, -FLOAT32_MAX, -FLOAT32_MAX));
 		for (auto& picked : selected)
 		{
-			if (picked->object != nullptr)
-			{
-				selectedAABB = AABB::Merge(selectedAABB, picked->object->bounds);
-			}
-			if (picked->light != nullptr)
-			{
-				selectedAABB = AABB::Merge(selectedAABB, picked->light->bounds);
-			}
 			if (picked->decal != nullptr)
 			{
-				selectedAABB = AABB::Merge(selectedAABB, picked->decal->bounds);
-
-				XMFLOAT4X4 selectionBox;
-				selectionBox = picked->decal->world;
-				wiRenderer::AddRenderableBox(selectionBox, XMFLOAT4(1, 0, 1, 1));
+				debugDraw.AddBox(picked->decal->world, XMFLOAT4(1, 0, 1, 1));
 			}
 		}
 
-		XMFLOAT4X4 selectionBox;
-		XMStoreFloat4x4(&selectionBox, selectedAABB.getAsBoxMatrix());
-		wiRenderer::AddRenderableBox(selectionBox, XMFLOAT4(1, 1, 1, 1));
+		UpdateSelectionBounds();
+		debugDraw.AddBox(selectionBounds.aabb, XMFLOAT4(1, 1, 1, 1));
 	}
 
+	debugDraw.Flush();
+
+	PROFILE_SCOPE("Engine render");
 	__super::Render();
 }
 void EditorComponent::Compose()
 {
-	__super::Compose();
+	PROFILE_SCOPE("Editor compose");
+
+	{
+		PROFILE_SCOPE("Engine compose");
+		__super::Compose();
+	}
+
+	if (packageLoader.IsActive())
+	{
+		stringstream ss("");
+		ss << "Streaming scene... " << (int)(packageLoader.GetProgress() * 100) << "%";
+		wiFont(ss.str(), wiFontProps(10, wiRenderer::GetDevice()->GetScreenHeight() - 10.0f, 18, WIFALIGN_LEFT, WIFALIGN_BOTTOM)).Draw();
+	}
+
+	if (editorCore.IsMarqueeActive())
+	{
+		const XMFLOAT2& marquee_start = editorCore.GetMarqueeStart();
+		XMFLOAT4 currentMouse = editorInput->GetPointer();
+		wiImageEffects fx;
+		fx.pos = XMFLOAT3(min(marquee_start.x, currentMouse.x), min(marquee_start.y, currentMouse.y), 0);
+		fx.siz = XMFLOAT2(abs(currentMouse.x - marquee_start.x), abs(currentMouse.y - marquee_start.y));
+		fx.col = XMFLOAT4(1, 1, 1, 0.2f);
+		wiImage::Draw(wiTextureHelper::getInstance()->getWhite(), fx, GRAPHICSTHREAD_IMMEDIATE);
+	}
 
 	if (rendererWnd->GetPickType() & PICK_LIGHT)
 	{
+		Camera* cam = wiRenderer::getCamera();
+		Texture2D* textures[] = { &pointLightTex, &spotLightTex, &dirLightTex };
+
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, cam->GetViewProjection());
+		lightIcons.Begin(viewProjection, _countof(textures));
 		for (auto& x : wiRenderer::GetScene().models)
 		{
 			for (auto& y : x->lights)
 			{
-				float dist = wiMath::Distance(y->translation, wiRenderer::getCamera()->translation) * 0.1f;
-
-				wiImageEffects fx;
-				fx.pos = y->translation;
-				fx.siz = XMFLOAT2(dist, dist);
-				fx.typeFlag = ImageType::WORLD;
-				fx.pivot = XMFLOAT2(0.5f, 0.5f);
-				fx.col = XMFLOAT4(1, 1, 1, 0.5f);
-
-				if (hovered.light == y)
-				{
-					fx.col = XMFLOAT4(1, 1, 1, 1);
-				}
-				for (auto& picked : selected)
-				{
-					if (picked->light == y)
-					{
-						fx.col = XMFLOAT4(1, 1, 0, 1);
-						break;
-					}
-				}
-
+				uint32_t texture;
 				switch (y->type)
 				{
 				case Light::POINT:
-					wiImage::Draw(&pointLightTex, fx, GRAPHICSTHREAD_IMMEDIATE);
+					texture = 0;
 					break;
 				case Light::SPOT:
-					wiImage::Draw(&spotLightTex, fx, GRAPHICSTHREAD_IMMEDIATE);
+					texture = 1;
 					break;
 				case Light::DIRECTIONAL:
-					wiImage::Draw(&dirLightTex, fx, GRAPHICSTHREAD_IMMEDIATE);
+					texture = 2;
 					break;
+				default:
+					continue;
+				}
+
+				XMFLOAT4 color = XMFLOAT4(1, 1, 1, 0.5f);
+				if (hovered.light == y)
+				{
+					color = XMFLOAT4(1, 1, 1, 1);
+				}
+				if (selected.Contains(y->GetID()))
+				{
+					color = XMFLOAT4(1, 1, 0, 1);
 				}
+
+				float dist = wiMath::Distance(y->translation, cam->translation) * 0.1f;
+				lightIcons.Add(texture, y->translation, dist, color);
+			}
+		}
+		lightIcons.End();
+
+		// Icons come sorted by texture, so the texture only changes between batches. wiImage has no
+		//	instanced path, so it is still one draw per icon.
+		const vector<IconBatch::Instance>& instances = lightIcons.GetInstances();
+		for (auto& batch : lightIcons.GetBatches())
+		{
+			wiImageEffects fx;
+			fx.typeFlag = ImageType::WORLD;
+			fx.pivot = XMFLOAT2(0.5f, 0.5f);
+			for (uint32_t i = batch.first; i < batch.first + batch.count; ++i)
+			{
+				fx.pos = instances[i].position;
+				fx.siz = XMFLOAT2(instances[i].size, instances[i].size);
+				fx.col = instances[i].color;
+				wiImage::Draw(textures[batch.texture], fx, GRAPHICSTHREAD_IMMEDIATE);
 			}
 		}
 	}
 
+	EditorProfiler::GetInstance()->Draw();
 }
 void EditorComponent::Unload()
 {
+	sceneWriter.Wait();
+	packageLoader.Cancel();
+
 	// ...
 	SAFE_DELETE(materialWnd);
 	SAFE_DELETE(postprocessWnd);
@@ -1087,32 +1763,281 @@ void EditorComponent::Unload()
 }
 
 
+void CopyToClipboard()
+{
+	ClearClipboard();
+	for (auto& x : selected)
+	{
+		// Plain copies share the parent, children and particle systems of the original, detach() or
+		//	the destructor would unlink and free those, so the pointers are just dropped. The world
+		//	transform becomes the local one, like detach() would do.
+		if (x->object != nullptr)
+		{
+			Object* o = new Object(*x->object);
+			o->children.clear();
+			o->applyTransform();
+			o->parent = nullptr;
+			o->eParticleSystems.clear();
+			o->hParticleSystems.clear();
+			clipboard.objects.push_back(o);
+		}
+		if (x->light != nullptr)
+		{
+			Light* l = new Light(*x->light);
+			l->children.clear();
+			l->applyTransform();
+			l->parent = nullptr;
+			clipboard.lights.push_back(l);
+		}
+		if (x->decal != nullptr)
+		{
+			Decal* d = new Decal(*x->decal);
+			d->children.clear();
+			d->applyTransform();
+			d->parent = nullptr;
+			clipboard.decals.push_back(d);
+		}
+	}
+}
+void ClearClipboard()
+{
+	for (auto& x : clipboard.objects)
+	{
+		SAFE_DELETE(x);
+	}
+	for (auto& x : clipboard.lights)
+	{
+		SAFE_DELETE(x);
+	}
+	for (auto& x : clipboard.decals)
+	{
+		SAFE_DELETE(x);
+	}
+	clipboard.objects.clear();
+	clipboard.lights.clear();
+	clipboard.decals.clear();
+}
+void PasteFromClipboard(DeleteTombstone& pasted)
+{
+	for (auto& x : clipboard.objects)
+	{
+		Object* o = new Object(*x);
+		wiRenderer::Add(o);
+		SceneIndex::GetInstance()->Add(o);
+		pasted.objects.push_back(o);
+	}
+	for (auto& x : clipboard.lights)
+	{
+		Light* l = new Light(*x);
+		wiRenderer::Add(l);
+		SceneIndex::GetInstance()->Add(l);
+		pasted.lights.push_back(l);
+	}
+	for (auto& x : clipboard.decals)
+	{
+		Decal* d = new Decal(*x);
+		wiRenderer::Add(d);
+		SceneIndex::GetInstance()->Add(d);
+		pasted.decals.push_back(d);
+	}
+	pasted.buried = false;
+}
+
 void ResetHistory()
 {
-	historyCount = 0;
-	historyPos = -1; 
+	historyJournal.Reset();
 	CreateDirectory(L"temp", NULL);
 }
-string AdvanceHistory()
+HistoryJournal::Record* AdvanceHistory()
 {
-	historyPos++;
-	historyCount = historyPos + 1; 
-	stringstream ss("");
-	ss << "temp/history" << historyPos;
-	return ss.str();
+	return &historyJournal.Begin();
 }
-void ConsumeHistoryOperation(bool undo)
+void EndHistory()
+{
+	PROFILE_SCOPE("History");
+	if (!historyJournal.End())
+	{
+		wiBackLog::post("The last operation is too large for the undo history, it can not be undone!");
+	}
+	history = nullptr;
+}
+void UpdateSelectionBounds()
 {
-	if ((undo && historyPos >= 0) || (!undo && historyPos < historyCount - 1))
+	bool selectionChanged = selectionBounds.version != selected.GetVersion();
+	bool translatorMoved = memcmp(&selectionBounds.translatorWorld, &translator->world, sizeof(XMFLOAT4X4)) != 0;
+	if (selectionChanged || translatorMoved)
+	{
+		selectionBounds.version = selected.GetVersion();
+		selectionBounds.translatorWorld = translator->world;
+		selectionBounds.Invalidate();
+	}
+	if (selectionBounds.dirtyFrames <= 0)
+	{
+		return;
+	}
+
+	// Dragging costs a box transform per frame, the bounds are merged again once the translator stops
+	if (!selectionChanged && translatorMoved && translator_active && selectionBounds.merged)
 	{
-		if (!undo)
+		XMMATRIX delta = XMMatrixInverse(nullptr, XMLoadFloat4x4(&selectionBounds.mergedTranslatorWorld)) * XMLoadFloat4x4(&translator->world);
+		selectionBounds.aabb = selectionBounds.mergedAabb.get(delta);
+		return;
+	}
+	selectionBounds.dirtyFrames--;
+
+	AABB aabb = AABB(XMFLOAT3(FLOAT32_MAX, FLOAT32_MAX, FLOAT32_MAX), XMFLOAT3(-FLOAT32_MAX, -FLOAT32_MAX, -FLOAT32_MAX));
+	for (auto& picked : selected)
+	{
+		if (picked->object != nullptr)
+		{
+			aabb = AABB::Merge(aabb, picked->object->bounds);
+		}
+		if (picked->light != nullptr)
+		{
+			aabb = AABB::Merge(aabb, picked->light->bounds);
+		}
+		if (picked->decal != nullptr)
 		{
-			historyPos++;
+			aabb = AABB::Merge(aabb, picked->decal->bounds);
 		}
+	}
+	selectionBounds.aabb = aabb;
+	selectionBounds.mergedAabb = aabb;
+	selectionBounds.mergedTranslatorWorld = translator->world;
+	// Nothing with bounds (only probes) would leave an inverted box that can't be transformed
+	selectionBounds.merged = aabb.getMin().x <= aabb.getMax().x;
+}
+void MarqueeSelect(const XMFLOAT2& start, const XMFLOAT2& end, int pickType, bool additive)
+{
+	vector<wiRenderer::Picked> picks;
+	picker.Select((long)start.x, (long)start.y, (long)end.x, (long)end.y, pickType, picks);
 
-		stringstream ss("");
-		ss << "temp/history" << historyPos;
-		history = new wiArchive(ss.str(), true);
+	EndTranslate();
+
+	// The whole drag is one history entry, that stores the selection from before and after it
+	history = AdvanceHistory();
+	*history << __editorVersion;
+	*history << (int)HISTORYOP_SELECTION;
+	*history << (int)3;
+	*history << selected.size();
+	for (auto& x : selected)
+	{
+		*history << x->transform->GetID();
+	}
+
+	if (!additive)
+	{
+		ClearSelected();
+	}
+	selected.Reserve(selected.size() + picks.size());
+	for (auto& x : picks)
+	{
+		wiRenderer::Picked* picked = new wiRenderer::Picked(x);
+		if (picked->object != nullptr && picked->object->isArmatureDeformed())
+		{
+			picked->transform = picked->object->mesh->armature;
+		}
+		if (!selected.Add(picked))
+		{
+			SAFE_DELETE(picked);
+		}
+	}
+
+	*history << selected.size();
+	for (auto& x : selected)
+	{
+		*history << x->transform->GetID();
+	}
+	EndHistory();
+
+	if (!selected.empty())
+	{
+		BeginTranslate();
+	}
+}
+void BuryTombstone(DeleteTombstone& tombstone)
+{
+	for (auto& x : tombstone.objects)
+	{
+		SceneIndex::GetInstance()->Remove(x);
+		wiRenderer::Remove(x);
+	}
+	for (auto& x : tombstone.lights)
+	{
+		SceneIndex::GetInstance()->Remove(x);
+		wiRenderer::Remove(x);
+	}
+	for (auto& x : tombstone.decals)
+	{
+		SceneIndex::GetInstance()->Remove(x);
+		wiRenderer::Remove(x);
+	}
+	tombstone.buried = true;
+}
+void RestoreTombstone(DeleteTombstone& tombstone)
+{
+	for (auto& x : tombstone.objects)
+	{
+		wiRenderer::Add(x);
+		SceneIndex::GetInstance()->Add(x);
+	}
+	for (auto& x : tombstone.lights)
+	{
+		wiRenderer::Add(x);
+		SceneIndex::GetInstance()->Add(x);
+	}
+	for (auto& x : tombstone.decals)
+	{
+		wiRenderer::Add(x);
+		SceneIndex::GetInstance()->Add(x);
+	}
+	tombstone.buried = false;
+}
+void DiscardTombstone(uint64_t historyID)
+{
+	auto it = tombstones.find(historyID);
+	if (it == tombstones.end())
+	{
+		return;
+	}
+
+	// Only a buried tombstone owns its entities, restored ones are owned by the scene again. Probes are
+	//	never buried, they are deleted right away, so only the bake keys are left to forget here.
+	DeleteTombstone& tombstone = it->second;
+	if (tombstone.buried)
+	{
+		for (auto& x : tombstone.objects)
+		{
+			BakeCache::GetInstance()->Forget(x);
+			SAFE_DELETE(x);
+		}
+		for (auto& x : tombstone.lights)
+		{
+			BakeCache::GetInstance()->Forget(x);
+			SAFE_DELETE(x);
+		}
+		for (auto& x : tombstone.decals)
+		{
+			BakeCache::GetInstance()->Forget(x);
+			SAFE_DELETE(x);
+		}
+	}
+	tombstones.erase(it);
+}
+void ConsumeHistoryOperation(bool undo)
+{
+	PROFILE_SCOPE("History");
+	picker.MarkMoved();
+	selectionBounds.Invalidate();
+
+	bool available = undo ? historyJournal.CanUndo() : historyJournal.CanRedo();
+	history = undo ? historyJournal.Undo() : historyJournal.Redo();
+	if (history == nullptr && available)
+	{
+		wiBackLog::post("A history record could not be read back from the disk, it was dropped!");
+	}
+	if (history != nullptr)
+	{
 		int version;
 		*history >> version;
 		int temp;
@@ -1128,41 +2053,65 @@ void ConsumeHistoryOperation(bool undo)
 				switch (selOpType)
 				{
 					case 0: // add sel
+					case 1: // remove from sel
 					{
 						unsigned long long selID;
 						*history >> selID;
-						if (undo)
+
+						EndTranslate();
+						if (undo == (selOpType == 0))
 						{
-							for (auto& x : selected)
-							{
-								if (x->transform->GetID() == selID)
-								{
-									selected.remove(x);
-									break;
-								}
-							}
+							selected.Remove(selID);
 						}
 						else
 						{
-							wiRenderer::Picked* p = new wiRenderer::Picked;
-							p->transform = wiRenderer::GetScene().GetWorldNode()->find(selID);
-							if (p->transform != nullptr)
+							wiRenderer::Picked* p = PickedFromTransform(SceneIndex::GetInstance()->Find(selID));
+							if (!selected.Add(p))
 							{
-								selected.push_back(p);
+								SAFE_DELETE(p);
 							}
 						}
-					}
-					break;
-				case 1: // remove from sel
-					{
-						unsigned long long selID;
-						*history >> selID;
+						if (!selected.empty())
+						{
+							BeginTranslate();
+						}
 					}
 					break;
 				case 2: // clear sel, new sel
+					break;
+				case 3: // marquee, previous and new selection
 					{
-						unsigned long long selID;
-						*history >> selID;
+						vector<uint64_t> before, after;
+						size_t count;
+						*history >> count;
+						before.resize(count);
+						for (auto& x : before)
+						{
+							*history >> x;
+						}
+						*history >> count;
+						after.resize(count);
+						for (auto& x : after)
+						{
+							*history >> x;
+						}
+
+						EndTranslate();
+						ClearSelected();
+						const vector<uint64_t>& ids = undo ? before : after;
+						selected.Reserve(ids.size());
+						for (auto& x : ids)
+						{
+							wiRenderer::Picked* p = PickedFromTransform(SceneIndex::GetInstance()->Find(x));
+							if (!selected.Add(p))
+							{
+								SAFE_DELETE(p);
+							}
+						}
+						if (!selected.empty())
+						{
+							BeginTranslate();
+						}
 					}
 					break;
 				default:
@@ -1188,88 +2137,46 @@ void ConsumeHistoryOperation(bool undo)
 			break;
 		case HISTORYOP_DELETE:
 			{
-				Model* model = nullptr;
-				if (undo)
-				{
-					model = new Model;
-				}
-
-				size_t count;
-				*history >> count;
-				for (size_t i = 0; i < count; ++i)
+				auto it = tombstones.find(history->GetID());
+				if (it != tombstones.end())
 				{
-					bool tmp;
-
-					// object
-					*history >> tmp;
-					if (tmp)
+					if (undo)
 					{
-						if (undo)
-						{
-							Object* object = new Object;
-							object->Serialize(*history);
-							object->mesh = new Mesh;
-							object->mesh->Serialize(*history);
-							size_t subsetCount;
-							*history >> subsetCount;
-							for (size_t i = 0; i < subsetCount; ++i)
-							{
-								object->mesh->subsets[i].material = new Material;
-								object->mesh->subsets[i].material->Serialize(*history);
-							}
-							object->mesh->CreateVertexArrays();
-							object->mesh->CreateBuffers(object);
-							model->Add(object);
-						}
+						RestoreTombstone(it->second);
 					}
-
-					// light
-					*history >> tmp;
-					if (tmp)
+					else
 					{
-						Light* light = new Light;
-						light->Serialize(*history);
-						model->Add(light);
+						EndTranslate();
+						ClearSelected();
+						BuryTombstone(it->second);
 					}
-
-					// decal
-					*history >> tmp;
-					if (tmp)
+				}
+			}
+			break;
+		case HISTORYOP_PASTE:
+			{
+				auto it = tombstones.find(history->GetID());
+				if (it != tombstones.end())
+				{
+					if (undo)
 					{
-						Decal* decal = new Decal;
-						decal->Serialize(*history);
-						model->Add(decal);
+						EndTranslate();
+						ClearSelected();
+						BuryTombstone(it->second);
 					}
-
-					// other
-					*history >> tmp;
-					unsigned long long id;
-					*history >> id;
-					if (tmp)
+					else
 					{
-
+						RestoreTombstone(it->second);
 					}
 				}
-
-				if (undo)
-				{
-					wiRenderer::AddModel(model);
-				}
 			}
 			break;
-		case HISTORYOP_PASTE:
-			break;
 		case HISTORYOP_NONE:
 			break;
 		default:
 			break;
 		}
 
-		if (undo)
-		{
-			historyPos--;
-		}
-
-		SAFE_DELETE(history);
+		history = nullptr;
 	}
 }
@@ -18,6 +18,7 @@ private:
 	wiSprite sprite;
 public:
 	void Load() override;
+	void Update() override;
 	void Compose() override;
 	void Unload() override;
 };
@@ -52,6 +53,15 @@ public:
 	void Render() override;
 	void Compose() override;
 	void Unload() override;
+
+	// Queues the probes and impostors again that were listed when the scene was saved, once the scene
+	//	has finished streaming in. They are baked a few per frame like any other bake.
+	void RestoreBakes(const std::string& sceneFileName);
+	// Adds the rest of a package that is still streaming in, blocks until it is all there
+	void FinishStreaming();
+	// Import stage of plain model archives: vertex cache and overdraw order for the meshes that are not
+	//	in existing
+	void OptimizeNewMeshes(const std::vector<Mesh*>& existing);
 };
 
 class Editor : public MainComponent
@@ -63,6 +73,37 @@ public:
 	EditorComponent*		renderComponent;
 	EditorLoadingScreen*	loader;
 
+	// Byte budget of the in-memory undo journal
+	size_t					historyBudget;
+	// Seconds between background autosaves, zero disables it
+	float					autosaveInterval;
+	// Byte budget of the editor's own textures, unused ones are evicted above it
+	size_t					contentBudget;
+	// Input script that drives the editor instead of the devices, empty for interactive use
+	std::string				inputScript;
+	// The devices are recorded into inputRecording, or inputReplay is played back instead of them
+	std::string				inputRecording;
+	std::string				inputReplay;
+	// Loaded before the first frame of a recording or replay
+	std::string				inputScene;
+	// Per frame timings of script and replay runs
+	std::string				timingsFile;
+	// Stops running frames while nothing changes
+	bool					idleMode;
+	// Optimizes the meshes of imported model archives
+	bool					optimizeOnImport;
+
 	void Initialize();
+
+	// Nothing changed for a few frames and nothing runs in the background, the main loop can wait for
+	//	the next message instead of running a frame
+	bool IsIdle() const;
+	// Something happened (a window message), frames are needed again
+	void Wake();
+	// The main loop waited for messages, the next frame doesn't catch up with the time it waited
+	void Waited();
+	// One frame of the main loop. With frame skipping run() updates zero or more times per rendered
+	//	frame, so the profiler's frame starts here and not in the update.
+	void RunFrame();
 };
 
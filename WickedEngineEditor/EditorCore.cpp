@@ -0,0 +1,153 @@
+#include "EditorCore.h"
+
+#include <cmath>
+
+using namespace std;
+using namespace DirectX;
+
+
+EditorCore::EditorCore(Host* host) :host(host), originalPointer(0, 0, 0, 0), marqueeActive(false), marqueeStart(0, 0)
+{
+}
+
+void EditorCore::Update(EditorInput& input)
+{
+	if (input.IsBacklogActive())
+	{
+		return;
+	}
+
+	// F2 toggles the profiler overlay, F3 exports the frames in its window
+	if (input.Press(EDITORKEY_F2))
+	{
+		host->ToggleProfiler();
+	}
+	if (input.Press(EDITORKEY_F3))
+	{
+		host->WriteProfile();
+	}
+	// F10 puts an environment probe at the camera
+	if (input.Press(EDITORKEY_F10))
+	{
+		host->PutProbe();
+	}
+
+	XMFLOAT4 currentPointer = input.GetPointer();
+	float xDif = 0, yDif = 0;
+	if (input.Down(EDITORKEY_MBUTTON))
+	{
+		xDif = currentPointer.x - originalPointer.x;
+		yDif = currentPointer.y - originalPointer.y;
+		xDif = 0.1f*xDif*(1.0f / 60.0f);
+		yDif = 0.1f*yDif*(1.0f / 60.0f);
+		input.SetPointer(originalPointer);
+	}
+	else
+	{
+		originalPointer = input.GetPointer();
+	}
+
+	CameraControl camera;
+	camera.move = XMFLOAT3(0, 0, 0);
+	camera.rotation = XMFLOAT2(0, 0);
+	camera.pan = XMFLOAT2(0, 0);
+	camera.zoom = 0;
+	if (host->IsFPSCamera())
+	{
+		// Only move camera if control not pressed
+		if (!input.Down(EDITORKEY_CONTROL))
+		{
+			float speed = (input.Down(EDITORKEY_SHIFT) ? 1.0f : 0.1f);
+			if (input.Down('A')) camera.move.x -= speed;
+			if (input.Down('D')) camera.move.x += speed;
+			if (input.Down('W')) camera.move.z += speed;
+			if (input.Down('S')) camera.move.z -= speed;
+			if (input.Down('E')) camera.move.y += speed;
+			if (input.Down('Q')) camera.move.y -= speed;
+		}
+		camera.rotation = XMFLOAT2(yDif, xDif);
+	}
+	else
+	{
+		if (input.Down(EDITORKEY_LSHIFT))
+		{
+			camera.pan = XMFLOAT2(xDif * 10, yDif * 10);
+		}
+		else if (input.Down(EDITORKEY_LCONTROL))
+		{
+			camera.zoom = yDif * 4;
+		}
+		else
+		{
+			camera.rotation = XMFLOAT2(yDif * 2, xDif * 2);
+		}
+	}
+	host->UpdateCamera(camera);
+
+	host->Hover(XMFLOAT2(currentPointer.x, currentPointer.y));
+
+	// Right click selects what is under the cursor, right drag selects everything inside the rectangle
+	if (input.Press(EDITORKEY_RBUTTON))
+	{
+		marqueeActive = true;
+		marqueeStart = XMFLOAT2(currentPointer.x, currentPointer.y);
+	}
+	if (marqueeActive && !input.Down(EDITORKEY_RBUTTON))
+	{
+		marqueeActive = false;
+		XMFLOAT2 marqueeEnd = XMFLOAT2(currentPointer.x, currentPointer.y);
+		if (abs(marqueeEnd.x - marqueeStart.x) > marqueeThreshold || abs(marqueeEnd.y - marqueeStart.y) > marqueeThreshold)
+		{
+			host->MarqueeSelect(marqueeStart, marqueeEnd, input.Down(EDITORKEY_LSHIFT));
+		}
+		else
+		{
+			host->Select(input.Down(EDITORKEY_LSHIFT));
+		}
+	}
+
+	if (input.Press(EDITORKEY_DELETE))
+	{
+		host->Delete();
+	}
+	// Control operations...
+	if (input.Down(EDITORKEY_CONTROL))
+	{
+		if (input.Press('C'))
+		{
+			if (input.Down(EDITORKEY_SHIFT))
+			{
+				host->CopyToFile();
+			}
+			else
+			{
+				host->Copy();
+			}
+		}
+		// Shift+V, or nothing copied in this process: the file of an other editor process is pasted
+		if (input.Press('V'))
+		{
+			if (!input.Down(EDITORKEY_SHIFT) && !host->IsClipboardEmpty())
+			{
+				host->Paste();
+			}
+			else
+			{
+				host->PasteFromFile();
+			}
+		}
+		// Duplicate Instances
+		if (input.Press('D'))
+		{
+			host->Duplicate();
+		}
+		if (input.Press('Z'))
+		{
+			host->Undo();
+		}
+		if (input.Press('Y'))
+		{
+			host->Redo();
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "EditorInput.h"
+
+// The part of the editor's update that only reads the input: the camera controls, hovering, right clicks
+//	and marquee drags, and the shortcuts. It doesn't know the scene, the window or the graphics device,
+//	the Host does what the input asks for: the editor component on the engine, or the console runner
+//	(EditorRunner.cpp) on a scene that only exists as a log. No engine or Windows header is used here,
+//	so it builds into WickedEngineEditorCore on any platform.
+class EditorCore
+{
+public:
+	struct CameraControl
+	{
+		DirectX::XMFLOAT3 move;		// FPS camera, in camera space
+		DirectX::XMFLOAT2 rotation;	// pitch and yaw, of the FPS camera or of the orbital camera's target
+		DirectX::XMFLOAT2 pan;		// orbital target, along the right and up of the camera
+		float zoom;					// orbital camera, towards its target
+	};
+
+	class Host
+	{
+	public:
+		virtual ~Host() {}
+
+		virtual bool IsFPSCamera() = 0;
+		// Called every frame, the control is zero when nothing moves
+		virtual void UpdateCamera(const CameraControl& control) = 0;
+		// Picks what is under the pointer, every frame
+		virtual void Hover(const DirectX::XMFLOAT2& pointer) = 0;
+		// Right click: the hovered transform becomes the selection, or is added to or removed from it
+		virtual void Select(bool additive) = 0;
+		virtual void MarqueeSelect(const DirectX::XMFLOAT2& start, const DirectX::XMFLOAT2& end, bool additive) = 0;
+		virtual void Delete() = 0;
+		virtual void Copy() = 0;
+		// Through a file, for an other editor process
+		virtual void CopyToFile() = 0;
+		virtual bool IsClipboardEmpty() = 0;
+		virtual void Paste() = 0;
+		virtual void PasteFromFile() = 0;
+		virtual void Duplicate() = 0;
+		virtual void Undo() = 0;
+		virtual void Redo() = 0;
+		virtual void ToggleProfiler() = 0;
+		virtual void WriteProfile() = 0;
+		// Environment probe at the camera
+		virtual void PutProbe() = 0;
+	};
+
+private:
+	Host* host;
+	// Where the middle button went down, the pointer is held there while the camera turns
+	DirectX::XMFLOAT4 originalPointer;
+	bool marqueeActive;
+	DirectX::XMFLOAT2 marqueeStart;
+
+public:
+	// Smaller drags than this are still clicks, in pixels
+	static constexpr float marqueeThreshold = 4;
+
+	EditorCore(Host* host);
+
+	// One frame of input, nothing happens while the backlog is open
+	void Update(EditorInput& input);
+
+	bool IsMarqueeActive() const { return marqueeActive; }
+	const DirectX::XMFLOAT2& GetMarqueeStart() const { return marqueeStart; }
+};
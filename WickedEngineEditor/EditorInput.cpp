@@ -0,0 +1,196 @@
+#include "EditorInput.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+using namespace DirectX;
+
+
+ScriptedInput::ScriptedInput() :next(0), waitFrames(0), frame(0), pointer(0, 0, 0, 0)
+{
+}
+
+int ScriptedInput::ParseKey(const string& name)
+{
+	if (name.length() == 1)
+	{
+		return toupper((unsigned char)name[0]);
+	}
+
+	static const struct { const char* name; int key; } keys[] = {
+		{ "LBUTTON", EDITORKEY_LBUTTON },
+		{ "RBUTTON", EDITORKEY_RBUTTON },
+		{ "MBUTTON", EDITORKEY_MBUTTON },
+		{ "SHIFT", EDITORKEY_SHIFT },
+		{ "LSHIFT", EDITORKEY_LSHIFT },
+		{ "CONTROL", EDITORKEY_CONTROL },
+		{ "LCONTROL", EDITORKEY_LCONTROL },
+		{ "DELETE", EDITORKEY_DELETE },
+		{ "ESCAPE", EDITORKEY_ESCAPE },
+		{ "SPACE", EDITORKEY_SPACE },
+		{ "RETURN", EDITORKEY_RETURN },
+		{ "F2", EDITORKEY_F2 },
+		{ "F3", EDITORKEY_F3 },
+		{ "F10", EDITORKEY_F10 },
+	};
+	string upper = name;
+	transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+	for (auto& x : keys)
+	{
+		if (upper == x.name)
+		{
+			return x.key;
+		}
+	}
+	return -1;
+}
+
+bool ScriptedInput::Load(const string& fileName)
+{
+	lines.clear();
+	next = 0;
+	waitFrames = 0;
+	frame = 0;
+	down.clear();
+	previous.clear();
+	released.clear();
+	error.clear();
+
+	ifstream file(fileName);
+	if (!file.is_open())
+	{
+		error = "Could not open input script " + fileName;
+		return false;
+	}
+
+	string text;
+	int number = 0;
+	while (getline(file, text))
+	{
+		number++;
+		size_t comment = text.find('#');
+		if (comment != string::npos)
+		{
+			text = text.substr(0, comment);
+		}
+		stringstream ss(text);
+		Line line;
+		line.key = -1;
+		line.pointer = XMFLOAT4(0, 0, 0, 0);
+		if (!(ss >> line.command))
+		{
+			continue;
+		}
+
+		bool valid = true;
+		if (line.command == "wait")
+		{
+			valid = (ss >> line.key) && line.key >= 0;
+		}
+		else if (line.command == "down" || line.command == "up" || line.command == "tap")
+		{
+			string key;
+			valid = (ss >> key) && (line.key = ParseKey(key)) >= 0;
+		}
+		else if (line.command == "move")
+		{
+			valid = (bool)(ss >> line.pointer.x >> line.pointer.y);
+		}
+		else
+		{
+			getline(ss >> ws, line.argument);
+		}
+		if (!valid)
+		{
+			stringstream ss("");
+			ss << fileName << "(" << number << "): invalid input script line";
+			error = ss.str();
+			lines.clear();
+			return false;
+		}
+		lines.push_back(line);
+	}
+	return true;
+}
+
+void ScriptedInput::Update()
+{
+	frame++;
+	previous = down;
+	// tapped keys are held for exactly one frame
+	for (auto& x : released)
+	{
+		down.erase(x);
+	}
+	released.clear();
+
+	if (waitFrames > 0)
+	{
+		waitFrames--;
+		return;
+	}
+
+	// Everything up to the next wait happens in this frame
+	while (next < lines.size())
+	{
+		const Line& line = lines[next++];
+		if (line.command == "wait")
+		{
+			waitFrames = (uint32_t)line.key;
+			if (waitFrames > 0)
+			{
+				waitFrames--;
+				break;
+			}
+		}
+		else if (line.command == "down")
+		{
+			down.insert(line.key);
+		}
+		else if (line.command == "up")
+		{
+			down.erase(line.key);
+		}
+		else if (line.command == "tap")
+		{
+			down.insert(line.key);
+			released.insert(line.key);
+		}
+		else if (line.command == "move")
+		{
+			pointer = line.pointer;
+		}
+		else if (commandCallback != nullptr)
+		{
+			commandCallback(line.command, line.argument);
+		}
+	}
+}
+bool ScriptedInput::Down(int button)
+{
+	return down.count(button) > 0;
+}
+bool ScriptedInput::Press(int button)
+{
+	return down.count(button) > 0 && previous.count(button) == 0;
+}
+XMFLOAT4 ScriptedInput::GetPointer()
+{
+	return pointer;
+}
+void ScriptedInput::SetPointer(const XMFLOAT4& value)
+{
+	pointer = value;
+}
+bool ScriptedInput::IsFinished() const
+{
+	return next >= lines.size() && waitFrames == 0;
+}
+bool ScriptedInput::UpdateTranslator(wiTranslator* translator, XMFLOAT4X4& dragStart, XMFLOAT4X4& dragEnd)
+{
+	// the live devices would make the run differ from one machine to the other
+	return false;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <functional>
+#include <cstdint>
+
+class wiTranslator;
+
+// Codes of the keys and buttons the editor reads, the virtual key codes of Windows on every platform
+enum EditorKey
+{
+	EDITORKEY_LBUTTON = 0x01,
+	EDITORKEY_RBUTTON = 0x02,
+	EDITORKEY_MBUTTON = 0x04,
+	EDITORKEY_RETURN = 0x0D,
+	EDITORKEY_SHIFT = 0x10,
+	EDITORKEY_CONTROL = 0x11,
+	EDITORKEY_ESCAPE = 0x1B,
+	EDITORKEY_SPACE = 0x20,
+	EDITORKEY_DELETE = 0x2E,
+	EDITORKEY_F2 = 0x71,
+	EDITORKEY_F3 = 0x72,
+	EDITORKEY_F10 = 0x79,
+	EDITORKEY_LSHIFT = 0xA0,
+	EDITORKEY_LCONTROL = 0xA2,
+};
+
+// The input that the editor's own logic reads (camera, picking, shortcuts, the translator)
+//	EditorCore goes through this instead of wiInputManager, so that a recorded or scripted session can
+//	drive it. This header and ScriptedInput are part of the editor core, they don't use the engine, the
+//	input sources that do are in EngineInput.h. The translator reads wiInputManager on its own, so it is
+//	updated through UpdateTranslator(): a recording stores what it did and a replay poses it the same
+//	way. The GUI widgets still read wiInputManager, a replay doesn't click them.
+class EditorInput
+{
+public:
+	virtual ~EditorInput() {}
+
+	// Called once at the beginning of every frame
+	virtual void Update() {}
+	virtual bool Down(int button) = 0;
+	// The button went down in this frame
+	virtual bool Press(int button) = 0;
+	virtual DirectX::XMFLOAT4 GetPointer() = 0;
+	virtual void SetPointer(const DirectX::XMFLOAT4& value) = 0;
+	// While the backlog is open, the editor ignores the input
+	virtual bool IsBacklogActive() { return false; }
+	// The session has nothing more to play
+	virtual bool IsFinished() const { return false; }
+	// Called once per frame instead of wiTranslator::Update(). Returns true if a drag ended in this
+	//	frame, with the start and end of the drag.
+	virtual bool UpdateTranslator(wiTranslator* translator, DirectX::XMFLOAT4X4& dragStart, DirectX::XMFLOAT4X4& dragEnd) = 0;
+};
+
+// Plays a text script, one command per line, # starts a comment:
+//	wait <frames>		advances the given number of frames
+//	down <key>			holds a key or mouse button until the matching up
+//	up <key>
+//	tap <key>			down for one frame
+//	move <x> <y>		sets the pointer
+//	<anything else>		is given to the command callback (for example: load <file>, save <file>)
+//	Keys are single characters (A, 1) or names: LBUTTON, RBUTTON, MBUTTON, SHIFT, LSHIFT, CONTROL,
+//	LCONTROL, DELETE, ESCAPE, SPACE, RETURN, F2, F3, F10. Scripts don't drag the translator.
+class ScriptedInput : public EditorInput
+{
+public:
+	typedef std::function<void(const std::string& command, const std::string& argument)> CommandCallback;
+
+private:
+	struct Line
+	{
+		std::string command;
+		std::string argument;
+		int key;
+		DirectX::XMFLOAT4 pointer;
+	};
+
+	std::vector<Line> lines;
+	size_t next;
+	uint32_t waitFrames;
+	uint64_t frame;
+	std::unordered_set<int> down, previous, released;
+	DirectX::XMFLOAT4 pointer;
+	CommandCallback commandCallback;
+	std::string error;
+
+	static int ParseKey(const std::string& name);
+
+public:
+	ScriptedInput();
+
+	// Returns false if the file can't be opened or has an invalid line, GetError() tells which
+	bool Load(const std::string& fileName);
+	const std::string& GetError() const { return error; }
+	void SetCommandCallback(const CommandCallback& value) { commandCallback = value; }
+
+	void Update() override;
+	bool Down(int button) override;
+	bool Press(int button) override;
+	DirectX::XMFLOAT4 GetPointer() override;
+	void SetPointer(const DirectX::XMFLOAT4& value) override;
+	bool IsFinished() const override;
+	bool UpdateTranslator(wiTranslator* translator, DirectX::XMFLOAT4X4& dragStart, DirectX::XMFLOAT4X4& dragEnd) override;
+
+	uint64_t GetFrame() const { return frame; }
+};
+
@@ -0,0 +1,300 @@
+#include "stdafx.h"
+#include "EditorPicker.h"
+#include "SceneIndex.h"
+#include "MeshLODs.h"
+
+#include <cfloat>
+#include <cstring>
+
+using namespace std;
+
+
+EditorPicker::EditorPicker() :sceneVersion(0), moved(false), cached(false), cursorX(0), cursorY(0), pickType(PICK_VOID)
+{
+}
+
+void EditorPicker::Invalidate()
+{
+	bvh.Clear();
+	items.clear();
+	boxes.clear();
+	moved = false;
+	cached = false;
+}
+
+wiRenderer::Picked EditorPicker::Pick(long x, long y, int type)
+{
+	Camera* cam = wiRenderer::getCamera();
+
+	// Drops the cached result if anything moved
+	Update();
+
+	if (cached && x == cursorX && y == cursorY && type == pickType &&
+		cam->translation.x == cameraPosition.x && cam->translation.y == cameraPosition.y && cam->translation.z == cameraPosition.z &&
+		cam->rotation.x == cameraRotation.x && cam->rotation.y == cameraRotation.y && cam->rotation.z == cameraRotation.z && cam->rotation.w == cameraRotation.w)
+	{
+		return result;
+	}
+
+	cached = true;
+	cursorX = x;
+	cursorY = y;
+	pickType = type;
+	cameraPosition = cam->translation;
+	cameraRotation = cam->rotation;
+	result = wiRenderer::Picked();
+
+	RAY ray = wiRenderer::getPickRay(x, y);
+	bvh.Raycast(ray.origin, ray.direction, hits);
+
+	// Hits are sorted by where the ray enters the boxes, so once the closest exact distance is nearer
+	//	than the next box, nothing behind it can win. A box hit alone is never a hit for an object, only
+	//	deformed objects (whose triangles are not where the mesh has them) are taken by their box.
+	float closest = FLT_MAX;
+	for (auto& hit : hits)
+	{
+		if (hit.distance >= closest)
+		{
+			break;
+		}
+
+		const Item& item = items[hit.item];
+		float distance = hit.distance;
+		int subsetIndex = 0;
+
+		if (!Accepts(item, type))
+		{
+			continue;
+		}
+		if (item.object != nullptr && !item.object->isArmatureDeformed())
+		{
+			if (!RefineObject(item, ray, distance, subsetIndex))
+			{
+				continue;
+			}
+		}
+
+		if (distance < closest)
+		{
+			closest = distance;
+			result = wiRenderer::Picked();
+			result.transform = item.transform;
+			result.object = item.object;
+			result.light = item.light;
+			result.decal = item.decal;
+			result.subsetIndex = subsetIndex;
+			result.distance = distance;
+			XMStoreFloat3(&result.position, XMLoadFloat3(&ray.origin) + XMLoadFloat3(&ray.direction) * distance);
+		}
+	}
+
+	return result;
+}
+void EditorPicker::Select(long x0, long y0, long x1, long y1, int type, vector<wiRenderer::Picked>& picks)
+{
+	picks.clear();
+	Update();
+
+	// The side planes of the sub-frustum go through the pick rays of neighbouring corners, this works
+	//	for both perspective and orthographic projections
+	RAY corners[] = {
+		wiRenderer::getPickRay(min(x0, x1), min(y0, y1)),
+		wiRenderer::getPickRay(max(x0, x1), min(y0, y1)),
+		wiRenderer::getPickRay(max(x0, x1), max(y0, y1)),
+		wiRenderer::getPickRay(min(x0, x1), max(y0, y1)),
+	};
+	RAY center = wiRenderer::getPickRay((x0 + x1) / 2, (y0 + y1) / 2);
+	XMVECTOR inside = XMLoadFloat3(&center.origin) + XMLoadFloat3(&center.direction);
+
+	XMFLOAT4 planes[5];
+	for (int i = 0; i < 4; ++i)
+	{
+		const RAY& a = corners[i];
+		const RAY& b = corners[(i + 1) % 4];
+		XMVECTOR A = XMLoadFloat3(&a.origin);
+		XMVECTOR N = XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&a.direction), XMLoadFloat3(&b.origin) + XMLoadFloat3(&b.direction) - A));
+		XMVECTOR plane = XMPlaneFromPointNormal(A, N);
+		if (XMVectorGetX(XMPlaneDotCoord(plane, inside)) < 0)
+		{
+			plane = -plane;
+		}
+		XMStoreFloat4(&planes[i], plane);
+	}
+	// Nothing behind the camera
+	XMStoreFloat4(&planes[4], XMPlaneFromPointNormal(XMLoadFloat3(&center.origin), XMVector3Normalize(XMLoadFloat3(&center.direction))));
+
+	vector<uint32_t> found;
+	bvh.Query(planes, _countof(planes), found);
+	picks.reserve(found.size());
+	for (auto& x : found)
+	{
+		const Item& item = items[x];
+		if (!Accepts(item, type))
+		{
+			continue;
+		}
+		wiRenderer::Picked picked;
+		picked.transform = item.transform;
+		picked.object = item.object;
+		picked.light = item.light;
+		picked.decal = item.decal;
+		picked.subsetIndex = 0;
+		picks.push_back(picked);
+	}
+}
+
+
+void EditorPicker::Update()
+{
+	uint64_t version = SceneIndex::GetInstance()->GetVersion();
+	if (version != sceneVersion)
+	{
+		sceneVersion = version;
+		Invalidate();
+	}
+
+	if (items.empty() || moved)
+	{
+		Gather();
+		if (!moved || !bvh.Refit(boxes))
+		{
+			bvh.Build(boxes);
+		}
+		moved = false;
+		cached = false;
+		return;
+	}
+
+	// Physics, animation and the property windows move entities without telling the picker
+	previousBoxes.swap(boxes);
+	Gather();
+	if (boxes.size() != previousBoxes.size() || memcmp(boxes.data(), previousBoxes.data(), boxes.size() * sizeof(PickingBVH::Box)) != 0)
+	{
+		if (!bvh.Refit(boxes))
+		{
+			bvh.Build(boxes);
+		}
+		cached = false;
+	}
+}
+bool EditorPicker::Accepts(const Item& item, int type) const
+{
+	if (item.object != nullptr)
+	{
+		return (type & item.object->GetRenderTypes()) != 0;
+	}
+	if (item.light != nullptr)
+	{
+		return (type & PICK_LIGHT) != 0;
+	}
+	if (item.decal != nullptr)
+	{
+		return (type & PICK_DECAL) != 0;
+	}
+	return (type & PICK_ENVPROBE) != 0;
+}
+void EditorPicker::Gather()
+{
+	items.clear();
+	boxes.clear();
+
+	auto addBox = [&](const Item& item, const XMFLOAT3& min, const XMFLOAT3& max) {
+		PickingBVH::Box box;
+		box.min = min;
+		box.max = max;
+		items.push_back(item);
+		boxes.push_back(box);
+	};
+
+	for (auto& model : wiRenderer::GetScene().models)
+	{
+		for (auto& x : model->objects)
+		{
+			if (x->mesh == nullptr)
+			{
+				continue;
+			}
+			Item item = { x, x, nullptr, nullptr };
+			addBox(item, x->bounds.getMin(), x->bounds.getMax());
+		}
+		for (auto& x : model->lights)
+		{
+			Item item = { x, nullptr, x, nullptr };
+			addBox(item, x->bounds.getMin(), x->bounds.getMax());
+		}
+		for (auto& x : model->decals)
+		{
+			// The decal volume is the unit cube transformed by its world matrix
+			XMMATRIX W = XMLoadFloat4x4(&x->world);
+			XMVECTOR bmin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR bmax = XMVectorReplicate(-FLT_MAX);
+			for (int i = 0; i < 8; ++i)
+			{
+				XMVECTOR corner = XMVector3Transform(XMVectorSet(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 1), W);
+				bmin = XMVectorMin(bmin, corner);
+				bmax = XMVectorMax(bmax, corner);
+			}
+			XMFLOAT3 min, max;
+			XMStoreFloat3(&min, bmin);
+			XMStoreFloat3(&max, bmax);
+			Item item = { x, nullptr, nullptr, x };
+			addBox(item, min, max);
+		}
+		for (auto& x : model->environmentProbes)
+		{
+			// Probes are drawn as small spheres around their position
+			XMFLOAT3 min, max;
+			XMStoreFloat3(&min, XMLoadFloat3(&x->translation) - XMVectorReplicate(1));
+			XMStoreFloat3(&max, XMLoadFloat3(&x->translation) + XMVectorReplicate(1));
+			Item item = { x, nullptr, nullptr, nullptr };
+			addBox(item, min, max);
+		}
+	}
+}
+bool EditorPicker::RefineObject(const Item& item, const RAY& ray, float& distance, int& subsetIndex) const
+{
+	// The test runs in object space, so the vertices don't have to be transformed
+	XMMATRIX W = XMLoadFloat4x4(&item.object->world);
+	XMMATRIX invW = XMMatrixInverse(nullptr, W);
+	XMVECTOR O = XMVector3TransformCoord(XMLoadFloat3(&ray.origin), invW);
+	XMVECTOR D = XMVector3TransformNormal(XMLoadFloat3(&ray.direction), invW);
+
+	const Mesh* mesh = item.object->mesh;
+	// Against the full detail, whichever LOD level is shown
+	const MeshLODs::Chain* chain = MeshLODs::GetInstance()->Get(mesh);
+	const MeshSimplifier::SubsetIndices* fullDetail = nullptr;
+	if (chain != nullptr && !chain->levels.empty() && chain->levels[0].subsetIndices.size() == mesh->subsets.size())
+	{
+		fullDetail = &chain->levels[0].subsetIndices;
+	}
+	float localClosest = FLT_MAX;
+	bool found = false;
+	for (size_t s = 0; s < mesh->subsets.size(); ++s)
+	{
+		const uint32_t* indices = fullDetail != nullptr ? (*fullDetail)[s].data() : mesh->subsets[s].subsetIndices.data();
+		size_t indexCount = fullDetail != nullptr ? (*fullDetail)[s].size() : mesh->subsets[s].subsetIndices.size();
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			XMVECTOR v0 = XMLoadFloat4(&mesh->vertices[indices[i + 0]].pos);
+			XMVECTOR v1 = XMLoadFloat4(&mesh->vertices[indices[i + 1]].pos);
+			XMVECTOR v2 = XMLoadFloat4(&mesh->vertices[indices[i + 2]].pos);
+			float t;
+			if (PickingBVH::IntersectTriangle(O, D, v0, v1, v2, t) && t < localClosest)
+			{
+				localClosest = t;
+				subsetIndex = (int)s;
+				found = true;
+			}
+		}
+	}
+
+	if (!found)
+	{
+		return false;
+	}
+
+	// Back to world space for comparing against the other hits
+	XMVECTOR P = XMVector3TransformCoord(O + D * localClosest, W);
+	distance = XMVectorGetX(XMVector3Length(P - XMLoadFloat3(&ray.origin)));
+	return true;
+}
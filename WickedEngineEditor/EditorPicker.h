@@ -0,0 +1,58 @@
+#pragma once
+#include "WickedEngine.h"
+#include "PickingBVH.h"
+
+#include <vector>
+
+// Hover and click picking for the editor on the CPU
+//	Objects, lights, decals and environment probes are put into a PickingBVH by their bounds, object
+//	box hits are refined against the mesh triangles, nearest first. The bounds are compared on every
+//	query, so entities moved by physics, animation or the property windows refit the hierarchy. The
+//	result is cached, so the scene is only queried again when the cursor, the camera or the pickable
+//	entities change.
+class EditorPicker
+{
+private:
+	struct Item
+	{
+		Transform* transform;
+		Object* object;
+		Light* light;
+		Decal* decal;
+	};
+
+	PickingBVH bvh;
+	std::vector<Item> items;
+	std::vector<PickingBVH::Box> boxes;
+	std::vector<PickingBVH::Box> previousBoxes;
+	std::vector<PickingBVH::Hit> hits;
+
+	uint64_t sceneVersion;
+	bool moved;
+
+	// cache key of the last query
+	bool cached;
+	long cursorX, cursorY;
+	int pickType;
+	XMFLOAT3 cameraPosition;
+	XMFLOAT4 cameraRotation;
+	wiRenderer::Picked result;
+
+	void Gather();
+	void Update();
+	bool Accepts(const Item& item, int pickType) const;
+	bool RefineObject(const Item& item, const RAY& ray, float& distance, int& subsetIndex) const;
+
+public:
+	EditorPicker();
+
+	// Entities were moved (translator, undo/redo), the hierarchy is refitted on the next query
+	void MarkMoved() { moved = true; cached = false; }
+	// Drop everything, the hierarchy is rebuilt on the next query
+	void Invalidate();
+
+	wiRenderer::Picked Pick(long cursorX, long cursorY, int pickType);
+	// Everything inside or intersecting the screen rectangle
+	void Select(long x0, long y0, long x1, long y1, int pickType, std::vector<wiRenderer::Picked>& picks);
+};
+
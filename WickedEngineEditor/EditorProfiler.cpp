@@ -0,0 +1,226 @@
+#include "stdafx.h"
+#include "EditorProfiler.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace wiGraphicsTypes;
+
+EditorProfiler* EditorProfiler::instance = nullptr;
+
+EditorProfiler* EditorProfiler::GetInstance()
+{
+	if (instance == nullptr)
+	{
+		instance = new EditorProfiler;
+	}
+	return instance;
+}
+
+EditorProfiler::EditorProfiler()
+{
+	origin = chrono::steady_clock::now();
+}
+
+double EditorProfiler::Now() const
+{
+	return chrono::duration<double, micro>(chrono::steady_clock::now() - origin).count();
+}
+
+void EditorProfiler::SetEnabled(bool value)
+{
+	enabled = value;
+	// A frame that was only partially measured would show up as a spike
+	current.clear();
+	stack.clear();
+	frameBegin = -1;
+}
+
+void EditorProfiler::BeginFrame()
+{
+	if (!enabled)
+	{
+		return;
+	}
+
+	double now = Now();
+	if (frameBegin >= 0)
+	{
+		// Scopes that were left open (an early return in the frame) end with it
+		for (auto& x : stack)
+		{
+			current[x].end = now;
+		}
+		stack.clear();
+
+		float milliseconds = (float)((now - frameBegin) / 1000.0);
+		float median = GetPercentile(50);
+		if (frameTimes.size() >= 30 && milliseconds > median * spikeFactor)
+		{
+			Spike spike;
+			spike.frame = frame;
+			spike.milliseconds = milliseconds;
+			spike.slowestScope = nullptr;
+			double slowest = 0;
+			for (auto& x : current)
+			{
+				if (x.depth == 0 && x.end - x.begin > slowest)
+				{
+					slowest = x.end - x.begin;
+					spike.slowestScope = x.name;
+				}
+			}
+			spikes.push_back(spike);
+			if (spikes.size() > maxSpikes)
+			{
+				spikes.pop_front();
+			}
+		}
+
+		frameTimes.push_back(milliseconds);
+		frames.push_back(move(current));
+		if (frameTimes.size() > historyFrames)
+		{
+			frameTimes.pop_front();
+			frames.pop_front();
+		}
+		current.clear();
+	}
+	frameBegin = now;
+	frame++;
+}
+
+uint32_t EditorProfiler::BeginScope(const char* name)
+{
+	Scope scope;
+	scope.name = name;
+	scope.depth = (uint32_t)stack.size();
+	scope.begin = Now();
+	scope.end = scope.begin;
+	uint32_t index = (uint32_t)current.size();
+	current.push_back(scope);
+	stack.push_back(index);
+	return index;
+}
+void EditorProfiler::EndScope(uint32_t index)
+{
+	// The profiler could have been toggled inside the scope
+	if (index >= current.size() || stack.empty() || stack.back() != index)
+	{
+		return;
+	}
+	current[index].end = Now();
+	stack.pop_back();
+}
+
+float EditorProfiler::GetPercentile(float percentile) const
+{
+	if (frameTimes.empty())
+	{
+		return 0;
+	}
+	vector<float> sorted(frameTimes.begin(), frameTimes.end());
+	size_t rank = (size_t)ceil(percentile / 100.0f * sorted.size());
+	size_t index = min(sorted.size() - 1, rank > 0 ? rank - 1 : 0);
+	nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+	return sorted[index];
+}
+
+void EditorProfiler::Draw() const
+{
+	if (!enabled)
+	{
+		return;
+	}
+
+	const float barWidth = 2;
+	const float height = 100;
+	const float scale = height / 33.3f; // 30 FPS reaches the top
+	float left = wiRenderer::GetDevice()->GetScreenWidth() - barWidth * historyFrames - 10;
+	float bottom = wiRenderer::GetDevice()->GetScreenHeight() - 10.0f;
+
+	wiImageEffects fx;
+	fx.pos = XMFLOAT3(left, bottom - height, 0);
+	fx.siz = XMFLOAT2(barWidth * historyFrames, height);
+	fx.col = XMFLOAT4(0, 0, 0, 0.5f);
+	wiImage::Draw(wiTextureHelper::getInstance()->getWhite(), fx, GRAPHICSTHREAD_IMMEDIATE);
+
+	for (size_t i = 0; i < frameTimes.size(); ++i)
+	{
+		float milliseconds = frameTimes[i];
+		float barHeight = min(height, milliseconds * scale);
+		fx.pos = XMFLOAT3(left + i * barWidth, bottom - barHeight, 0);
+		fx.siz = XMFLOAT2(barWidth, barHeight);
+		if (milliseconds <= 16.7f)
+		{
+			fx.col = XMFLOAT4(0, 1, 0, 0.8f);
+		}
+		else if (milliseconds <= 33.3f)
+		{
+			fx.col = XMFLOAT4(1, 1, 0, 0.8f);
+		}
+		else
+		{
+			fx.col = XMFLOAT4(1, 0, 0, 0.8f);
+		}
+		wiImage::Draw(wiTextureHelper::getInstance()->getWhite(), fx, GRAPHICSTHREAD_IMMEDIATE);
+	}
+
+	stringstream ss("");
+	ss << fixed << setprecision(2);
+	ss << "p50 " << GetPercentile(50) << " ms  p95 " << GetPercentile(95) << " ms  p99 " << GetPercentile(99) << " ms" << endl;
+	if (!frames.empty())
+	{
+		for (auto& x : frames.back())
+		{
+			ss << string(x.depth * 2, ' ') << x.name << " " << (x.end - x.begin) / 1000.0 << " ms" << endl;
+		}
+	}
+	if (!spikes.empty())
+	{
+		ss << "Spikes:" << endl;
+		for (auto& x : spikes)
+		{
+			ss << "  frame " << x.frame << " " << x.milliseconds << " ms";
+			if (x.slowestScope != nullptr)
+			{
+				ss << " (" << x.slowestScope << ")";
+			}
+			ss << endl;
+		}
+	}
+	wiFont(ss.str(), wiFontProps((int)left, (int)(bottom - height - 4), 14, WIFALIGN_LEFT, WIFALIGN_BOTTOM)).Draw();
+}
+
+bool EditorProfiler::WriteTrace(const string& fileName) const
+{
+	ofstream file(fileName, ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	// Complete events ("ph":"X") with microsecond timestamps, all on the main thread
+	file << fixed << setprecision(3);
+	file << "{\"traceEvents\":[";
+	bool first = true;
+	for (auto& x : frames)
+	{
+		for (auto& y : x)
+		{
+			if (!first)
+			{
+				file << ",";
+			}
+			first = false;
+			file << "\n{\"name\":\"" << y.name << "\",\"cat\":\"editor\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << y.begin
+				<< ",\"dur\":" << (y.end - y.begin) << "}";
+		}
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return file.good();
+}
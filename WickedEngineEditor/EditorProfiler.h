@@ -0,0 +1,95 @@
+#pragma once
+#include "WickedEngine.h"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+// Hierarchical CPU timers of the editor's frame
+//	Scopes are opened with PROFILE_SCOPE("name"), the names must be string literals. While the profiler
+//	is disabled a scope costs one branch. It keeps a rolling window of frame times for the histogram,
+//	a log of the frames that took much longer than usual and the scopes of the last frames for export.
+class EditorProfiler
+{
+public:
+	struct Scope
+	{
+		const char* name;
+		uint32_t depth;
+		double begin, end;	// microseconds since the profiler was created
+	};
+	struct Spike
+	{
+		uint64_t frame;
+		float milliseconds;
+		const char* slowestScope;
+	};
+
+	// Frames in the histogram and in the exported trace
+	static const size_t historyFrames = 240;
+	static const size_t maxSpikes = 8;
+	// A frame is a spike above this many times the median
+	float spikeFactor = 2.0f;
+
+private:
+	static EditorProfiler* instance;
+
+	bool enabled = false;
+	std::chrono::steady_clock::time_point origin;
+	uint64_t frame = 0;
+	double frameBegin = -1;
+	std::vector<Scope> current;
+	std::vector<uint32_t> stack;
+	std::deque<std::vector<Scope>> frames;	// finished frames, the newest at the back
+	std::deque<float> frameTimes;			// milliseconds
+	std::deque<Spike> spikes;
+
+	double Now() const;
+
+public:
+	EditorProfiler();
+	static EditorProfiler* GetInstance();
+
+	void SetEnabled(bool value);
+	bool IsEnabled() const { return enabled; }
+
+	// Closes the previous frame, called once at the start of every rendered frame (Editor::RunFrame)
+	void BeginFrame();
+	uint32_t BeginScope(const char* name);
+	void EndScope(uint32_t index);
+
+	// percentile in 0..100 over the rolling window
+	float GetPercentile(float percentile) const;
+	const std::deque<Spike>& GetSpikes() const { return spikes; }
+
+	// Histogram, percentiles, spike log and the scopes of the last frame
+	void Draw() const;
+	// Chrome trace (chrome://tracing) of the frames in the window
+	bool WriteTrace(const std::string& fileName) const;
+};
+
+class ProfileScope
+{
+private:
+	uint32_t index;
+public:
+	ProfileScope(const char* name)
+	{
+		EditorProfiler* profiler = EditorProfiler::GetInstance();
+		index = profiler->IsEnabled() ? profiler->BeginScope(name) : ~0u;
+	}
+	~ProfileScope()
+	{
+		if (index != ~0u)
+		{
+			EditorProfiler::GetInstance()->EndScope(index);
+		}
+	}
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
@@ -0,0 +1,274 @@
+#include "stdafx.h"
+#include "EngineInput.h"
+
+#include <fstream>
+#include <cstring>
+
+using namespace std;
+
+
+bool EngineInput::Down(int button)
+{
+	return wiInputManager::GetInstance()->down(button);
+}
+bool EngineInput::Press(int button)
+{
+	return wiInputManager::GetInstance()->press(button);
+}
+XMFLOAT4 EngineInput::GetPointer()
+{
+	return wiInputManager::GetInstance()->getpointer();
+}
+void EngineInput::SetPointer(const XMFLOAT4& value)
+{
+	wiInputManager::GetInstance()->setpointer(value);
+}
+bool EngineInput::IsBacklogActive()
+{
+	return wiBackLog::isActive();
+}
+bool EngineInput::UpdateTranslator(wiTranslator* translator, XMFLOAT4X4& dragStart, XMFLOAT4X4& dragEnd)
+{
+	translator->Update();
+	if (!translator->IsDragEnded())
+	{
+		return false;
+	}
+	dragStart = translator->GetDragStart();
+	dragEnd = translator->GetDragEnd();
+	return true;
+}
+
+
+RecordingInput::RecordingInput() :frameCount(0)
+{
+}
+
+bool RecordingInput::Open(const string& fileName)
+{
+	Close();
+	file.open(fileName, ios::binary | ios::trunc);
+	if (!file.is_open())
+	{
+		wiBackLog::post(("Could not create input recording " + fileName).c_str());
+		return false;
+	}
+	InputRecording::Header header;
+	header.magic = InputRecording::MAGIC;
+	header.version = InputRecording::VERSION;
+	file.write((const char*)&header, sizeof(header));
+	frameCount = 0;
+	// not a valid matrix, so the pose of the first frame is always stored
+	memset(&translatorWorld, 0xFF, sizeof(translatorWorld));
+	return true;
+}
+void RecordingInput::Close()
+{
+	if (file.is_open())
+	{
+		file.close();
+	}
+}
+
+void RecordingInput::Update()
+{
+	if (!file.is_open())
+	{
+		return;
+	}
+
+	XMFLOAT4 pointer = GetPointer();
+	uint8_t flags = 0;
+	if (wiBackLog::isActive())
+	{
+		flags |= InputRecording::FRAME_BACKLOG_ACTIVE;
+	}
+	uint8_t keys[256];
+	uint32_t keyCount = 0;
+	for (int i = 1; i < 256 && keyCount < 255; ++i)
+	{
+		if (Down(i))
+		{
+			keys[keyCount++] = (uint8_t)i;
+		}
+	}
+	uint8_t count = (uint8_t)keyCount;
+
+	file.write((const char*)&pointer.x, sizeof(float));
+	file.write((const char*)&pointer.y, sizeof(float));
+	file.write((const char*)&flags, sizeof(flags));
+	file.write((const char*)&count, sizeof(count));
+	file.write((const char*)keys, keyCount);
+	frameCount++;
+}
+bool RecordingInput::UpdateTranslator(wiTranslator* translator, XMFLOAT4X4& dragStart, XMFLOAT4X4& dragEnd)
+{
+	bool dragEnded = EngineInput::UpdateTranslator(translator, dragStart, dragEnd);
+	if (!file.is_open())
+	{
+		return dragEnded;
+	}
+
+	// The translator moves the selection only when its pose changes, so only the changes are stored
+	uint8_t flags = 0;
+	bool moved = memcmp(&translatorWorld, &translator->world, sizeof(XMFLOAT4X4)) != 0;
+	if (moved)
+	{
+		flags |= InputRecording::TRANSLATOR_MOVED;
+		translatorWorld = translator->world;
+	}
+	if (dragEnded)
+	{
+		flags |= InputRecording::TRANSLATOR_DRAG_ENDED;
+	}
+	file.write((const char*)&flags, sizeof(flags));
+	if (moved)
+	{
+		file.write((const char*)&translatorWorld, sizeof(XMFLOAT4X4));
+	}
+	if (dragEnded)
+	{
+		file.write((const char*)&dragStart, sizeof(XMFLOAT4X4));
+		file.write((const char*)&dragEnd, sizeof(XMFLOAT4X4));
+	}
+	return dragEnded;
+}
+
+
+ReplayInput::ReplayInput() :current(0), advanced(false), pointer(0, 0, 0, 0)
+{
+	memset(down, 0, sizeof(down));
+	memset(previous, 0, sizeof(previous));
+}
+
+bool ReplayInput::Load(const string& fileName)
+{
+	frames.clear();
+	keys.clear();
+	matrices.clear();
+	current = 0;
+	advanced = false;
+	memset(down, 0, sizeof(down));
+	memset(previous, 0, sizeof(previous));
+
+	ifstream file(fileName, ios::binary);
+	InputRecording::Header header;
+	if (!file.is_open() || !file.read((char*)&header, sizeof(header)) ||
+		header.magic != InputRecording::MAGIC || header.version > InputRecording::VERSION)
+	{
+		wiBackLog::post(("Not a valid input recording: " + fileName).c_str());
+		return false;
+	}
+
+	while (true)
+	{
+		Frame frame;
+		frame.pointer = XMFLOAT4(0, 0, 0, 0);
+		uint8_t count;
+		if (!file.read((char*)&frame.pointer.x, sizeof(float)) ||
+			!file.read((char*)&frame.pointer.y, sizeof(float)) ||
+			!file.read((char*)&frame.flags, sizeof(frame.flags)) ||
+			!file.read((char*)&count, sizeof(count)))
+		{
+			break;
+		}
+		frame.firstKey = (uint32_t)keys.size();
+		frame.keyCount = count;
+		keys.resize(keys.size() + count);
+		if (count > 0 && !file.read((char*)&keys[frame.firstKey], count))
+		{
+			// a frame cut in half (the editor was killed while recording) is dropped
+			keys.resize(frame.firstKey);
+			break;
+		}
+
+		frame.translatorFlags = 0;
+		frame.firstMatrix = (uint32_t)matrices.size();
+		if (header.version >= 2)
+		{
+			if (!file.read((char*)&frame.translatorFlags, sizeof(frame.translatorFlags)))
+			{
+				keys.resize(frame.firstKey);
+				break;
+			}
+			uint32_t matrixCount = 0;
+			matrixCount += (frame.translatorFlags & InputRecording::TRANSLATOR_MOVED) ? 1 : 0;
+			matrixCount += (frame.translatorFlags & InputRecording::TRANSLATOR_DRAG_ENDED) ? 2 : 0;
+			matrices.resize(matrices.size() + matrixCount);
+			if (matrixCount > 0 && !file.read((char*)&matrices[frame.firstMatrix], sizeof(XMFLOAT4X4) * matrixCount))
+			{
+				keys.resize(frame.firstKey);
+				matrices.resize(frame.firstMatrix);
+				break;
+			}
+		}
+		frames.push_back(frame);
+	}
+	return true;
+}
+
+void ReplayInput::Update()
+{
+	memcpy(previous, down, sizeof(down));
+	memset(down, 0, sizeof(down));
+	advanced = current < frames.size();
+	if (!advanced)
+	{
+		return;
+	}
+
+	const Frame& frame = frames[current++];
+	pointer = frame.pointer;
+	for (uint32_t i = 0; i < frame.keyCount; ++i)
+	{
+		down[keys[frame.firstKey + i]] = true;
+	}
+}
+bool ReplayInput::Down(int button)
+{
+	return button >= 0 && button < 256 && down[button];
+}
+bool ReplayInput::Press(int button)
+{
+	return button >= 0 && button < 256 && down[button] && !previous[button];
+}
+XMFLOAT4 ReplayInput::GetPointer()
+{
+	return pointer;
+}
+void ReplayInput::SetPointer(const XMFLOAT4& value)
+{
+	// the recording already contains where the pointer went after this
+	pointer = value;
+}
+bool ReplayInput::IsBacklogActive()
+{
+	return current > 0 && current <= frames.size() && (frames[current - 1].flags & InputRecording::FRAME_BACKLOG_ACTIVE) != 0;
+}
+bool ReplayInput::IsFinished() const
+{
+	return current >= frames.size();
+}
+bool ReplayInput::UpdateTranslator(wiTranslator* translator, XMFLOAT4X4& dragStart, XMFLOAT4X4& dragEnd)
+{
+	// The live devices are not read, the translator is posed the way it was recorded, and the selection
+	//	that is attached to it follows
+	if (!advanced)
+	{
+		return false;
+	}
+	const Frame& frame = frames[current - 1];
+	uint32_t matrix = frame.firstMatrix;
+	if (frame.translatorFlags & InputRecording::TRANSLATOR_MOVED)
+	{
+		translator->Clear();
+		translator->transform(XMLoadFloat4x4(&matrices[matrix++]));
+	}
+	if (frame.translatorFlags & InputRecording::TRANSLATOR_DRAG_ENDED)
+	{
+		dragStart = matrices[matrix];
+		dragEnd = matrices[matrix + 1];
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "WickedEngine.h"
+#include "EditorInput.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+// The input sources that read the engine's devices, and their recordings
+
+// The live devices
+class EngineInput : public EditorInput
+{
+public:
+	bool Down(int button) override;
+	bool Press(int button) override;
+	XMFLOAT4 GetPointer() override;
+	void SetPointer(const XMFLOAT4& value) override;
+	bool IsBacklogActive() override;
+	bool UpdateTranslator(wiTranslator* translator, XMFLOAT4X4& dragStart, XMFLOAT4X4& dragEnd) override;
+};
+
+// Recorded input file:
+//	[Header] then one frame after the other until the end of the file:
+//	[float pointerX, pointerY] [uint8_t flags] [uint8_t keyCount] [uint8_t keys * keyCount]
+//	[uint8_t translatorFlags] [XMFLOAT4X4 world, if it moved] [XMFLOAT4X4 dragStart, dragEnd, if a drag ended]
+//	Only the keys that are down are stored, so an idle frame is eleven bytes. Version 1 files have no
+//	translator part.
+namespace InputRecording
+{
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+	};
+	static const uint32_t MAGIC = 0x52494957; // "WIIR"
+	static const uint32_t VERSION = 2;
+
+	enum FrameFlags
+	{
+		FRAME_BACKLOG_ACTIVE = 1 << 0,
+	};
+	enum TranslatorFlags
+	{
+		TRANSLATOR_MOVED = 1 << 0,
+		TRANSLATOR_DRAG_ENDED = 1 << 1,
+	};
+}
+
+// The live devices, and every frame of them is written to a file
+class RecordingInput : public EngineInput
+{
+private:
+	std::ofstream file;
+	uint64_t frameCount;
+	XMFLOAT4X4 translatorWorld;
+public:
+	RecordingInput();
+
+	bool Open(const std::string& fileName);
+	void Close();
+
+	void Update() override;
+	bool UpdateTranslator(wiTranslator* translator, XMFLOAT4X4& dragStart, XMFLOAT4X4& dragEnd) override;
+
+	uint64_t GetFrameCount() const { return frameCount; }
+};
+
+// Plays back a recorded file frame by frame
+class ReplayInput : public EditorInput
+{
+private:
+	struct Frame
+	{
+		XMFLOAT4 pointer;
+		uint8_t flags;
+		uint8_t translatorFlags;
+		uint32_t firstKey, keyCount; // in keys
+		uint32_t firstMatrix;		// in matrices: world, then dragStart and dragEnd, as the flags say
+	};
+	std::vector<Frame> frames;
+	std::vector<uint8_t> keys;
+	std::vector<XMFLOAT4X4> matrices;
+	size_t current;
+	bool advanced;	// Update() played a frame, the last one is not played again after the end
+	bool down[256], previous[256];
+	XMFLOAT4 pointer;
+public:
+	ReplayInput();
+
+	// Reads the whole file, returns false if it is not a valid recording
+	bool Load(const std::string& fileName);
+
+	void Update() override;
+	bool Down(int button) override;
+	bool Press(int button) override;
+	XMFLOAT4 GetPointer() override;
+	void SetPointer(const XMFLOAT4& value) override;
+	bool IsBacklogActive() override;
+	bool IsFinished() const override;
+	bool UpdateTranslator(wiTranslator* translator, XMFLOAT4X4& dragStart, XMFLOAT4X4& dragEnd) override;
+};
@@ -1,5 +1,9 @@
 #include "stdafx.h"
 #include "EnvProbeWindow.h"
+#include "SceneIndex.h"
+#include "BakeCache.h"
+
+#include <sstream>
 
 int resolution = 256;
 
@@ -26,13 +30,38 @@ EnvProbeWindow::EnvProbeWindow(wiGUI* gui) : GUI(gui)
 
 	generateButton = new wiButton("Put");
 	generateButton->SetPos(XMFLOAT2(x, y += step));
-	generateButton->OnClick([](wiEventArgs args) {
+	generateButton->OnClick([=](wiEventArgs args) {
 		XMFLOAT3 pos;
 		XMStoreFloat3(&pos, XMVectorAdd(wiRenderer::getCamera()->GetEye(), wiRenderer::getCamera()->GetAt()*4));
-		wiRenderer::PutEnvProbe(pos, resolution);
+		PutProbe(pos);
 	});
 	envProbeWindow->AddWidget(generateButton);
 
+	refreshButton = new wiButton("Refresh Stale");
+	refreshButton->SetPos(XMFLOAT2(x, y += step));
+	refreshButton->OnClick([=](wiEventArgs args) {
+		// Only the probes whose scene changed since they were baked
+		BakeCache* cache = BakeCache::GetInstance();
+		for (auto& x : wiRenderer::GetScene().models)
+		{
+			for (auto& probe : x->environmentProbes)
+			{
+				int probeResolution = cache->IsBaked(probe) ? cache->GetResolution(probe) : resolution;
+				if (!cache->IsUpToDate(probe, cache->GetProbeKey(probe->translation, probeResolution)))
+				{
+					bakeQueue.PushStale(probe->translation, probeResolution, probe);
+				}
+			}
+		}
+	});
+	envProbeWindow->AddWidget(refreshButton);
+
+	progressLabel = new wiLabel("ProbeBakeProgress");
+	progressLabel->SetPos(XMFLOAT2(x, y += step));
+	progressLabel->SetSize(XMFLOAT2(300, 20));
+	progressLabel->SetText("");
+	envProbeWindow->AddWidget(progressLabel);
+
 
 
 
@@ -46,4 +75,35 @@ EnvProbeWindow::~EnvProbeWindow()
 	SAFE_DELETE(envProbeWindow);
 	SAFE_DELETE(resolutionSlider);
 	SAFE_DELETE(generateButton);
+	SAFE_DELETE(refreshButton);
+	SAFE_DELETE(progressLabel);
+}
+
+void EnvProbeWindow::PutProbe(const XMFLOAT3& position)
+{
+	bakeQueue.Push(position, resolution);
+}
+
+void EnvProbeWindow::Update(float budget)
+{
+	if (bakeQueue.IsEmpty())
+	{
+		return;
+	}
+
+	if (bakeQueue.Update(budget) > 0)
+	{
+		SceneIndex::GetInstance()->Rebuild(wiRenderer::GetScene().GetWorldNode());
+	}
+
+	if (bakeQueue.IsEmpty())
+	{
+		progressLabel->SetText("");
+	}
+	else
+	{
+		stringstream ss("");
+		ss << "Baking probes: " << bakeQueue.GetCompletedCount() << " / " << bakeQueue.GetTotalCount();
+		progressLabel->SetText(ss.str());
+	}
 }
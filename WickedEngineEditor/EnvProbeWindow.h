@@ -1,4 +1,5 @@
 #pragma once
+#include "ProbeBakeQueue.h"
 
 struct Material;
 class wiGUI;
@@ -19,5 +20,15 @@ public:
 
 	wiSlider*	resolutionSlider;
 	wiButton*	generateButton;
+	wiButton*	refreshButton;
+	wiLabel*	progressLabel;
+
+	// Probes are baked a few per frame through this
+	ProbeBakeQueue bakeQueue;
+
+	// Puts a probe in the bake queue with the resolution of the slider
+	void PutProbe(const XMFLOAT3& position);
+	// Bakes what fits in the budget (seconds) and shows the progress, called every frame
+	void Update(float budget);
 };
 
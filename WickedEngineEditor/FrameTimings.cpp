@@ -0,0 +1,76 @@
+#include "FrameTimings.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+FrameTimings::FrameTimings() :started(false)
+{
+}
+
+void FrameTimings::Frame()
+{
+	auto now = chrono::steady_clock::now();
+	if (started)
+	{
+		frameTimes.push_back(chrono::duration<float, milli>(now - last).count());
+	}
+	last = now;
+	started = true;
+}
+void FrameTimings::Clear()
+{
+	frameTimes.clear();
+	started = false;
+}
+
+float FrameTimings::GetPercentile(float percentile) const
+{
+	if (frameTimes.empty())
+	{
+		return 0;
+	}
+	vector<float> sorted = frameTimes;
+	size_t rank = (size_t)ceil(percentile / 100.0f * sorted.size());
+	size_t index = min(sorted.size() - 1, rank > 0 ? rank - 1 : 0);
+	nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+	return sorted[index];
+}
+
+string FrameTimings::GetSummary() const
+{
+	float sum = 0, maximum = 0;
+	for (auto& x : frameTimes)
+	{
+		sum += x;
+		maximum = max(maximum, x);
+	}
+	float mean = frameTimes.empty() ? 0 : sum / frameTimes.size();
+
+	stringstream ss("");
+	ss << fixed << setprecision(2);
+	ss << "frames " << frameTimes.size() << ", mean " << mean << " ms, p50 " << GetPercentile(50) << " ms, p95 " << GetPercentile(95)
+		<< " ms, p99 " << GetPercentile(99) << " ms, max " << maximum << " ms";
+	return ss.str();
+}
+
+bool FrameTimings::WriteCSV(const string& fileName) const
+{
+	ofstream file(fileName, ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	file << "frame,milliseconds\n";
+	file << fixed << setprecision(3);
+	for (size_t i = 0; i < frameTimes.size(); ++i)
+	{
+		file << i << "," << frameTimes[i] << "\n";
+	}
+	return file.good();
+}
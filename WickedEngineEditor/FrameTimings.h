@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+
+// Wall clock time of every frame of a benchmark run (a replayed recording or an input script)
+class FrameTimings
+{
+private:
+	std::vector<float> frameTimes; // milliseconds
+	std::chrono::steady_clock::time_point last;
+	bool started;
+public:
+	FrameTimings();
+
+	// Called once per frame, the time since the previous call is the frame time
+	void Frame();
+	void Clear();
+
+	size_t GetCount() const { return frameTimes.size(); }
+	// percentile in 0..100, nearest rank
+	float GetPercentile(float percentile) const;
+	// "frames 1234, mean 16.1 ms, p50 15.9 ms, p95 17.2 ms, p99 21.0 ms, max 40.3 ms"
+	std::string GetSummary() const;
+
+	// One line per frame: frame,milliseconds
+	bool WriteCSV(const std::string& fileName) const;
+};
+
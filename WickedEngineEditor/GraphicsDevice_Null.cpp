@@ -0,0 +1,54 @@
+#include "stdafx.h"
+#include "GraphicsDevice_Null.h"
+
+using namespace wiGraphicsTypes;
+
+
+GraphicsDevice_Null::GraphicsDevice_Null()
+{
+	SCREENWIDTH = 1;
+	SCREENHEIGHT = 1;
+	for (auto& x : counters)
+	{
+		x = 0;
+	}
+}
+
+GraphicsDevice_Null* GraphicsDevice_Null::Install()
+{
+	GraphicsDevice_Null* device = new GraphicsDevice_Null;
+	wiRenderer::graphicsDevice = device;
+	return device;
+}
+
+HRESULT GraphicsDevice_Null::CreateBuffer(const GPUBufferDesc *pDesc, const SubresourceData* pInitialData, GPUBuffer *ppBuffer)
+{
+	Count(COUNTER_CREATE);
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateTexture1D(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture1D **ppTexture1D)
+{
+	Count(COUNTER_CREATE);
+	*ppTexture1D = new Texture1D;
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateTexture2D(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture2D **ppTexture2D)
+{
+	Count(COUNTER_CREATE);
+	*ppTexture2D = new Texture2D;
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateTexture3D(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture3D **ppTexture3D)
+{
+	Count(COUNTER_CREATE);
+	*ppTexture3D = new Texture3D;
+	return S_OK;
+}
+
+HRESULT GraphicsDevice_Null::CreateTextureFromFile(const std::string& fileName, Texture2D **ppTexture, bool mipMaps, GRAPHICSTHREAD threadID)
+{
+	// The file is not read, the texture only stands for it
+	Count(COUNTER_TEXTUREFILE);
+	*ppTexture = new Texture2D;
+	return S_OK;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include "WickedEngine.h"
+
+#include <atomic>
+
+// Graphics device that executes nothing, for the tools that use the engine without a window
+//	Resources are created empty: a texture loaded from a file is a Texture2D without a description, so
+//	materials deserialize and keep their texture names, but nothing can be drawn or read back. Install()
+//	puts it in place of the renderer's device, before anything creates a resource. The calls are counted
+//	by kind, the resources are loaded on worker threads.
+class GraphicsDevice_Null : public wiGraphicsTypes::GraphicsDevice
+{
+public:
+	enum Counter
+	{
+		COUNTER_CREATE,
+		COUNTER_TEXTUREFILE,
+		COUNTER_BIND,
+		COUNTER_DRAW,
+		COUNTER_DISPATCH,
+		COUNTER_COPY,
+		COUNTER_UPDATE,
+		COUNTER_COUNT,
+	};
+
+private:
+	std::atomic<uint32_t> counters[COUNTER_COUNT];
+
+	void Count(Counter counter) { counters[counter]++; }
+
+public:
+	GraphicsDevice_Null();
+
+	static GraphicsDevice_Null* Install();
+
+	uint32_t GetCount(Counter counter) const { return counters[counter]; }
+
+	HRESULT CreateBuffer(const wiGraphicsTypes::GPUBufferDesc *pDesc, const wiGraphicsTypes::SubresourceData* pInitialData, wiGraphicsTypes::GPUBuffer *ppBuffer) override;
+	HRESULT CreateTexture1D(const wiGraphicsTypes::TextureDesc* pDesc, const wiGraphicsTypes::SubresourceData *pInitialData, wiGraphicsTypes::Texture1D **ppTexture1D) override;
+	HRESULT CreateTexture2D(const wiGraphicsTypes::TextureDesc* pDesc, const wiGraphicsTypes::SubresourceData *pInitialData, wiGraphicsTypes::Texture2D **ppTexture2D) override;
+	HRESULT CreateTexture3D(const wiGraphicsTypes::TextureDesc* pDesc, const wiGraphicsTypes::SubresourceData *pInitialData, wiGraphicsTypes::Texture3D **ppTexture3D) override;
+	HRESULT CreateInputLayout(const wiGraphicsTypes::VertexLayoutDesc *pInputElementDescs, UINT NumElements, const void *pShaderBytecodeWithInputSignature, SIZE_T BytecodeLength, wiGraphicsTypes::VertexLayout *pInputLayout) override { Count(COUNTER_CREATE); return S_OK; }
+	HRESULT CreateVertexShader(const void *pShaderBytecode, SIZE_T BytecodeLength, wiGraphicsTypes::VertexShader *pVertexShader) override { Count(COUNTER_CREATE); return S_OK; }
+	HRESULT CreatePixelShader(const void *pShaderBytecode, SIZE_T BytecodeLength, wiGraphicsTypes::PixelShader *pPixelShader) override { Count(COUNTER_CREATE); return S_OK; }
+	HRESULT CreateGeometryShader(const void *pShaderBytecode, SIZE_T BytecodeLength, wiGraphicsTypes::GeometryShader *pGeometryShader) override { Count(COUNTER_CREATE); return S_OK; }
+	HRESULT CreateHullShader(const void *pShaderBytecode, SIZE_T BytecodeLength, wiGraphicsTypes::HullShader *pHullShader) override { Count(COUNTER_CREATE); return S_OK; }
+	HRESULT CreateDomainShader(const void *pShaderBytecode, SIZE_T BytecodeLength, wiGraphicsTypes::DomainShader *pDomainShader) override { Count(COUNTER_CREATE); return S_OK; }
+	HRESULT CreateComputeShader(const void *pShaderBytecode, SIZE_T BytecodeLength, wiGraphicsTypes::ComputeShader *pComputeShader) override { Count(COUNTER_CREATE); return S_OK; }
+	HRESULT CreateBlendState(const wiGraphicsTypes::BlendStateDesc *pBlendStateDesc, wiGraphicsTypes::BlendState *pBlendState) override { Count(COUNTER_CREATE); return S_OK; }
+	HRESULT CreateDepthStencilState(const wiGraphicsTypes::DepthStencilStateDesc *pDepthStencilStateDesc, wiGraphicsTypes::DepthStencilState *pDepthStencilState) override { Count(COUNTER_CREATE); return S_OK; }
+	HRESULT CreateRasterizerState(const wiGraphicsTypes::RasterizerStateDesc *pRasterizerStateDesc, wiGraphicsTypes::RasterizerState *pRasterizerState) override { Count(COUNTER_CREATE); return S_OK; }
+	HRESULT CreateSamplerState(const wiGraphicsTypes::SamplerDesc *pSamplerDesc, wiGraphicsTypes::Sampler *pSamplerState) override { Count(COUNTER_CREATE); return S_OK; }
+	HRESULT CreateQuery(const wiGraphicsTypes::GPUQueryDesc *pDesc, wiGraphicsTypes::GPUQuery *pQuery) override { Count(COUNTER_CREATE); return S_OK; }
+
+	void PresentBegin() override {}
+	void PresentEnd() override {}
+	void ExecuteDeferredContexts() override {}
+	void FinishCommandList(GRAPHICSTHREAD thread) override {}
+
+	void SetScreenWidth(int value) override { SCREENWIDTH = value; }
+	void SetScreenHeight(int value) override { SCREENHEIGHT = value; }
+	wiGraphicsTypes::Texture2D GetBackBuffer() override { return wiGraphicsTypes::Texture2D(); }
+
+	void BindViewports(UINT NumViewports, const wiGraphicsTypes::ViewPort *pViewports, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindRenderTargetsUAVs(UINT NumViews, wiGraphicsTypes::Texture* const *ppRenderTargets, wiGraphicsTypes::Texture2D* depthStencilTexture, wiGraphicsTypes::GPUUnorderedResource* const *ppUAVs, int slotUAV, int countUAV, GRAPHICSTHREAD threadID, int arrayIndex = -1) override { Count(COUNTER_BIND); }
+	void BindRenderTargets(UINT NumViews, wiGraphicsTypes::Texture* const *ppRenderTargets, wiGraphicsTypes::Texture2D* depthStencilTexture, GRAPHICSTHREAD threadID, int arrayIndex = -1) override { Count(COUNTER_BIND); }
+	void ClearRenderTarget(wiGraphicsTypes::Texture* pTexture, const FLOAT ColorRGBA[4], GRAPHICSTHREAD threadID, int arrayIndex = -1) override {}
+	void ClearDepthStencil(wiGraphicsTypes::Texture2D* pTexture, UINT ClearFlags, FLOAT Depth, UINT8 Stencil, GRAPHICSTHREAD threadID, int arrayIndex = -1) override {}
+	void BindResourcePS(const wiGraphicsTypes::GPUResource* resource, int slot, GRAPHICSTHREAD threadID, int arrayIndex = -1) override { Count(COUNTER_BIND); }
+	void BindResourceVS(const wiGraphicsTypes::GPUResource* resource, int slot, GRAPHICSTHREAD threadID, int arrayIndex = -1) override { Count(COUNTER_BIND); }
+	void BindResourceGS(const wiGraphicsTypes::GPUResource* resource, int slot, GRAPHICSTHREAD threadID, int arrayIndex = -1) override { Count(COUNTER_BIND); }
+	void BindResourceDS(const wiGraphicsTypes::GPUResource* resource, int slot, GRAPHICSTHREAD threadID, int arrayIndex = -1) override { Count(COUNTER_BIND); }
+	void BindResourceHS(const wiGraphicsTypes::GPUResource* resource, int slot, GRAPHICSTHREAD threadID, int arrayIndex = -1) override { Count(COUNTER_BIND); }
+	void BindResourceCS(const wiGraphicsTypes::GPUResource* resource, int slot, GRAPHICSTHREAD threadID, int arrayIndex = -1) override { Count(COUNTER_BIND); }
+	void BindResourcesPS(const wiGraphicsTypes::GPUResource *const* resources, int slot, int count, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindResourcesVS(const wiGraphicsTypes::GPUResource *const* resources, int slot, int count, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindResourcesGS(const wiGraphicsTypes::GPUResource *const* resources, int slot, int count, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindResourcesDS(const wiGraphicsTypes::GPUResource *const* resources, int slot, int count, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindResourcesHS(const wiGraphicsTypes::GPUResource *const* resources, int slot, int count, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindResourcesCS(const wiGraphicsTypes::GPUResource *const* resources, int slot, int count, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindUnorderedAccessResourceCS(const wiGraphicsTypes::GPUUnorderedResource* buffer, int slot, GRAPHICSTHREAD threadID, int arrayIndex = -1) override { Count(COUNTER_BIND); }
+	void BindUnorderedAccessResourcesCS(const wiGraphicsTypes::GPUUnorderedResource *const* buffers, int slot, int count, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void UnBindResources(int slot, int num, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void UnBindUnorderedAccessResources(int slot, int num, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindSamplerPS(const wiGraphicsTypes::Sampler* sampler, int slot, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindSamplerVS(const wiGraphicsTypes::Sampler* sampler, int slot, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindSamplerGS(const wiGraphicsTypes::Sampler* sampler, int slot, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindSamplerHS(const wiGraphicsTypes::Sampler* sampler, int slot, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindSamplerDS(const wiGraphicsTypes::Sampler* sampler, int slot, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindSamplerCS(const wiGraphicsTypes::Sampler* sampler, int slot, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindConstantBufferPS(const wiGraphicsTypes::GPUBuffer* buffer, int slot, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindConstantBufferVS(const wiGraphicsTypes::GPUBuffer* buffer, int slot, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindConstantBufferGS(const wiGraphicsTypes::GPUBuffer* buffer, int slot, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindConstantBufferDS(const wiGraphicsTypes::GPUBuffer* buffer, int slot, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindConstantBufferHS(const wiGraphicsTypes::GPUBuffer* buffer, int slot, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindConstantBufferCS(const wiGraphicsTypes::GPUBuffer* buffer, int slot, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindVertexBuffers(const wiGraphicsTypes::GPUBuffer* const *vertexBuffers, int slot, int count, const UINT* strides, const UINT* offsets, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindIndexBuffer(const wiGraphicsTypes::GPUBuffer* indexBuffer, const wiGraphicsTypes::INDEXBUFFER_FORMAT format, UINT offset, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindPrimitiveTopology(wiGraphicsTypes::PRIMITIVETOPOLOGY type, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindVertexLayout(const wiGraphicsTypes::VertexLayout* layout, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindBlendState(const wiGraphicsTypes::BlendState* state, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindBlendStateEx(const wiGraphicsTypes::BlendState* state, const XMFLOAT4& blendFactor, UINT sampleMask, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindDepthStencilState(const wiGraphicsTypes::DepthStencilState* state, UINT stencilRef, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindRasterizerState(const wiGraphicsTypes::RasterizerState* state, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindPS(const wiGraphicsTypes::PixelShader* shader, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindVS(const wiGraphicsTypes::VertexShader* shader, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindGS(const wiGraphicsTypes::GeometryShader* shader, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindHS(const wiGraphicsTypes::HullShader* shader, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindDS(const wiGraphicsTypes::DomainShader* shader, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void BindCS(const wiGraphicsTypes::ComputeShader* shader, GRAPHICSTHREAD threadID) override { Count(COUNTER_BIND); }
+	void Draw(int vertexCount, UINT startVertexLocation, GRAPHICSTHREAD threadID) override { Count(COUNTER_DRAW); }
+	void DrawIndexed(int indexCount, UINT startIndexLocation, UINT baseVertexLocation, GRAPHICSTHREAD threadID) override { Count(COUNTER_DRAW); }
+	void DrawInstanced(int vertexCount, int instanceCount, UINT startVertexLocation, UINT startInstanceLocation, GRAPHICSTHREAD threadID) override { Count(COUNTER_DRAW); }
+	void DrawIndexedInstanced(int indexCount, int instanceCount, UINT startIndexLocation, UINT baseVertexLocation, UINT startInstanceLocation, GRAPHICSTHREAD threadID) override { Count(COUNTER_DRAW); }
+	void DrawInstancedIndirect(const wiGraphicsTypes::GPUBuffer* args, UINT args_offset, GRAPHICSTHREAD threadID) override { Count(COUNTER_DRAW); }
+	void DrawIndexedInstancedIndirect(const wiGraphicsTypes::GPUBuffer* args, UINT args_offset, GRAPHICSTHREAD threadID) override { Count(COUNTER_DRAW); }
+	void Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ, GRAPHICSTHREAD threadID) override { Count(COUNTER_DISPATCH); }
+	void DispatchIndirect(const wiGraphicsTypes::GPUBuffer* args, UINT args_offset, GRAPHICSTHREAD threadID) override { Count(COUNTER_DISPATCH); }
+	void GenerateMips(wiGraphicsTypes::Texture* texture, GRAPHICSTHREAD threadID) override { Count(COUNTER_COPY); }
+	void CopyTexture2D(wiGraphicsTypes::Texture2D* pDst, const wiGraphicsTypes::Texture2D* pSrc, GRAPHICSTHREAD threadID) override { Count(COUNTER_COPY); }
+	void CopyTexture2D_Region(wiGraphicsTypes::Texture2D* pDst, UINT dstMip, UINT dstX, UINT dstY, const wiGraphicsTypes::Texture2D* pSrc, UINT srcMip, GRAPHICSTHREAD threadID) override { Count(COUNTER_COPY); }
+	void MSAAResolve(wiGraphicsTypes::Texture2D* pDst, const wiGraphicsTypes::Texture2D* pSrc, GRAPHICSTHREAD threadID) override { Count(COUNTER_COPY); }
+	void UpdateBuffer(wiGraphicsTypes::GPUBuffer* buffer, const void* data, GRAPHICSTHREAD threadID, int dataSize = -1) override { Count(COUNTER_UPDATE); }
+	bool DownloadBuffer(wiGraphicsTypes::GPUBuffer* bufferToDownload, wiGraphicsTypes::GPUBuffer* bufferDest, void* dataDest, GRAPHICSTHREAD threadID) override { return false; }
+	void SetScissorRects(UINT numRects, const wiGraphicsTypes::Rect* rects, GRAPHICSTHREAD threadID) override {}
+	void QueryBegin(wiGraphicsTypes::GPUQuery *query, GRAPHICSTHREAD threadID) override {}
+	void QueryEnd(wiGraphicsTypes::GPUQuery *query, GRAPHICSTHREAD threadID) override {}
+	bool QueryRead(wiGraphicsTypes::GPUQuery *query, GRAPHICSTHREAD threadID) override { return true; }
+
+	HRESULT CreateTextureFromFile(const std::string& fileName, wiGraphicsTypes::Texture2D **ppTexture, bool mipMaps, GRAPHICSTHREAD threadID) override;
+	HRESULT SaveTexturePNG(const std::string& fileName, wiGraphicsTypes::Texture2D *pTexture, GRAPHICSTHREAD threadID) override { return E_FAIL; }
+	HRESULT SaveTextureDDS(const std::string& fileName, wiGraphicsTypes::Texture *pTexture, GRAPHICSTHREAD threadID) override { return E_FAIL; }
+
+	void EventBegin(const std::wstring& name, GRAPHICSTHREAD threadID) override {}
+	void EventEnd(GRAPHICSTHREAD threadID) override {}
+	void SetMarker(const std::wstring& name, GRAPHICSTHREAD threadID) override {}
+};
@@ -0,0 +1,346 @@
+#include "HistoryJournal.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+using namespace std;
+
+
+HistoryJournal::HistoryJournal(size_t budget) :budget(budget), maxSpilledRecords(0), spillCounter(0), nextID(1), position(-1), recording(false)
+{
+}
+HistoryJournal::~HistoryJournal()
+{
+	// The owner of the callback might be gone already
+	onDiscard = nullptr;
+	Reset();
+}
+
+void HistoryJournal::SetBudget(size_t value)
+{
+	assert(!recording && "Can not resize the history arena while recording!");
+
+	budget = value;
+	if (GetStats().arenaUsed > budget)
+	{
+		// Evicting can drop the oldest records, a redo branch would then be replayed with a gap in it
+		while ((int)entries.size() - 1 > position)
+		{
+			DropNewest();
+		}
+	}
+	while (GetStats().arenaUsed > budget)
+	{
+		EvictOldest();
+	}
+
+	// Compact the remaining records into the new arena
+	vector<uint8_t> old;
+	old.swap(arena);
+	arena.resize(budget);
+	size_t offset = 0;
+	for (size_t i = FirstInMemory(); i < entries.size(); ++i)
+	{
+		Entry& entry = entries[i];
+		memcpy(arena.data() + offset, old.data() + entry.offset, entry.size);
+		entry.offset = offset;
+		offset += entry.size;
+	}
+}
+void HistoryJournal::SetSpillDirectory(const string& directory, size_t maxSpilled)
+{
+	spillDirectory = directory;
+	maxSpilledRecords = maxSpilled;
+}
+
+void HistoryJournal::Reset()
+{
+	for (auto& x : entries)
+	{
+		Discard(x);
+	}
+	entries.clear();
+	staging.clear();
+	position = -1;
+	recording = false;
+}
+
+HistoryJournal::Record& HistoryJournal::Begin()
+{
+	assert(!recording && "Previous history record was not ended!");
+
+	// A new operation invalidates everything that could have been redone
+	while ((int)entries.size() - 1 > position)
+	{
+		DropNewest();
+	}
+
+	recording = true;
+	staging.clear();
+	cursor = Record();
+	cursor.writeBuffer = &staging;
+	cursor.id = nextID;
+	return cursor;
+}
+bool HistoryJournal::End()
+{
+	assert(recording && "History record was not started!");
+	recording = false;
+	cursor = Record();
+
+	Entry entry;
+	entry.id = nextID++;
+	entry.offset = 0;
+	entry.size = staging.size();
+	entry.spilled = false;
+
+	if (arena.size() != budget)
+	{
+		arena.resize(budget);
+	}
+
+	if (!Allocate(entry.size, entry.offset))
+	{
+		// Doesn't fit into the arena at all, it can only live on the disk. Everything before it
+		//	must go there too, so that spilled records stay the oldest ones.
+		while (FirstInMemory() < entries.size())
+		{
+			EvictOldest();
+		}
+		if (!Spill(entry, staging.data()))
+		{
+			Discard(entry);
+			return false;
+		}
+	}
+	else
+	{
+		memcpy(arena.data() + entry.offset, staging.data(), entry.size);
+	}
+
+	entries.push_back(entry);
+	position = (int)entries.size() - 1;
+	// An oversized record goes straight to the disk, that counts against the spilled set too
+	while (FirstInMemory() > maxSpilledRecords)
+	{
+		DropOldest();
+	}
+	return true;
+}
+
+HistoryJournal::Record* HistoryJournal::Undo()
+{
+	if (!CanUndo())
+	{
+		return nullptr;
+	}
+	if (!OpenEntry((size_t)position))
+	{
+		// The record is lost and nothing older can be undone without it
+		while (position >= 0)
+		{
+			DropOldest();
+		}
+		return nullptr;
+	}
+	position--;
+	return &cursor;
+}
+HistoryJournal::Record* HistoryJournal::Redo()
+{
+	if (!CanRedo())
+	{
+		return nullptr;
+	}
+	if (!OpenEntry((size_t)position + 1))
+	{
+		// The record is lost and nothing newer can be redone without it
+		while ((int)entries.size() - 1 > position)
+		{
+			DropNewest();
+		}
+		return nullptr;
+	}
+	position++;
+	return &cursor;
+}
+
+HistoryJournal::Stats HistoryJournal::GetStats() const
+{
+	Stats stats;
+	stats.recordCount = entries.size();
+	stats.spilledCount = FirstInMemory();
+	stats.arenaUsed = 0;
+	stats.arenaBudget = budget;
+	for (size_t i = stats.spilledCount; i < entries.size(); ++i)
+	{
+		stats.arenaUsed += entries[i].size;
+	}
+	return stats;
+}
+
+
+size_t HistoryJournal::FirstInMemory() const
+{
+	// spilled records are always the oldest ones
+	size_t i = 0;
+	while (i < entries.size() && entries[i].spilled)
+	{
+		++i;
+	}
+	return i;
+}
+bool HistoryJournal::Allocate(size_t size, size_t& offset)
+{
+	if (size > budget)
+	{
+		return false;
+	}
+
+	while (true)
+	{
+		size_t first = FirstInMemory();
+		if (first >= entries.size())
+		{
+			offset = 0;
+			return true;
+		}
+
+		const Entry& head = entries[first];
+		const Entry& last = entries.back();
+		size_t tail = last.offset + last.size;
+
+		if (last.offset >= head.offset)
+		{
+			// [....head####tail....]
+			if (budget - tail >= size)
+			{
+				offset = tail;
+				return true;
+			}
+			if (head.offset >= size)
+			{
+				offset = 0;
+				return true;
+			}
+		}
+		else
+		{
+			// [####tail....head####]
+			if (head.offset - tail >= size)
+			{
+				offset = tail;
+				return true;
+			}
+		}
+
+		EvictOldest();
+	}
+}
+void HistoryJournal::EvictOldest()
+{
+	size_t first = FirstInMemory();
+	if (first >= entries.size())
+	{
+		return;
+	}
+
+	if (Spill(entries[first], arena.data() + entries[first].offset))
+	{
+		// Keep the spilled set bounded, the oldest spilled records are dropped
+		while (FirstInMemory() > maxSpilledRecords)
+		{
+			DropOldest();
+		}
+		return;
+	}
+
+	// Spilling is disabled or failed, so the record is lost for good together with everything
+	//	older than it, because undo can not skip over a missing record
+	for (size_t i = 0; i <= first; ++i)
+	{
+		DropOldest();
+	}
+}
+void HistoryJournal::DropOldest()
+{
+	Discard(entries.front());
+	entries.pop_front();
+	if (position >= 0)
+	{
+		position--;
+	}
+}
+void HistoryJournal::DropNewest()
+{
+	Discard(entries.back());
+	entries.pop_back();
+}
+void HistoryJournal::Discard(Entry& entry)
+{
+	if (entry.spilled && !entry.spillFile.empty())
+	{
+		remove(entry.spillFile.c_str());
+		entry.spillFile.clear();
+	}
+	if (onDiscard)
+	{
+		onDiscard(entry.id);
+	}
+}
+bool HistoryJournal::Spill(Entry& entry, const uint8_t* data)
+{
+	if (spillDirectory.empty() || maxSpilledRecords == 0)
+	{
+		return false;
+	}
+
+	stringstream ss("");
+	ss << spillDirectory << "history" << spillCounter++;
+
+	ofstream file(ss.str(), ios::binary | ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	file.write((const char*)data, (streamsize)entry.size);
+	file.close();
+	if (file.fail())
+	{
+		remove(ss.str().c_str());
+		return false;
+	}
+
+	entry.spilled = true;
+	entry.spillFile = ss.str();
+	return true;
+}
+bool HistoryJournal::OpenEntry(size_t index)
+{
+	const Entry& entry = entries[index];
+
+	cursor = Record();
+	if (entry.spilled)
+	{
+		spillReadBuffer.resize(entry.size);
+		ifstream file(entry.spillFile, ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		file.read((char*)spillReadBuffer.data(), (streamsize)entry.size);
+		if (file.gcount() != (streamsize)entry.size)
+		{
+			return false;
+		}
+		cursor.readData = spillReadBuffer.data();
+	}
+	else
+	{
+		cursor.readData = arena.data() + entry.offset;
+	}
+	cursor.readSize = entry.size;
+	cursor.id = entry.id;
+	return true;
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cassert>
+#include <type_traits>
+#include <functional>
+
+// Undo/redo journal for the editor
+//	Records are kept in one contiguous ring arena with a fixed byte budget. When the budget runs out,
+//	the oldest records are spilled to disk (if a spill directory is set), otherwise they are dropped.
+//	It has no dependency on the engine, so it can be driven without a graphics device.
+class HistoryJournal
+{
+public:
+	// Cursor over a single history record, the stream operators mirror wiArchive
+	class Record
+	{
+		friend class HistoryJournal;
+	private:
+		std::vector<uint8_t>* writeBuffer;
+		const uint8_t* readData;
+		size_t readSize;
+		size_t pos;
+		uint64_t id;
+
+		void Write(const void* data, size_t size)
+		{
+			assert(writeBuffer != nullptr && "Record is in read mode!");
+			writeBuffer->insert(writeBuffer->end(), (const uint8_t*)data, (const uint8_t*)data + size);
+		}
+		void Read(void* data, size_t size)
+		{
+			assert(readData != nullptr && "Record is in write mode!");
+			assert(pos + size <= readSize && "Read past the end of the history record!");
+			memcpy(data, readData + pos, size);
+			pos += size;
+		}
+	public:
+		Record() :writeBuffer(nullptr), readData(nullptr), readSize(0), pos(0), id(0) {}
+
+		// Unique for the lifetime of the journal, external state can be attached to a record with it
+		uint64_t GetID() const { return id; }
+		bool IsReadMode() const { return readData != nullptr; }
+		bool IsEnd() const { return pos >= readSize; }
+
+		template<typename T>
+		Record& operator<<(const T& data)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be written into a history record!");
+			Write(&data, sizeof(T));
+			return *this;
+		}
+		template<typename T>
+		Record& operator>>(T& data)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be read from a history record!");
+			Read(&data, sizeof(T));
+			return *this;
+		}
+		Record& operator<<(const std::string& data)
+		{
+			(*this) << data.length();
+			Write(data.c_str(), data.length());
+			return *this;
+		}
+		Record& operator>>(std::string& data)
+		{
+			size_t length;
+			(*this) >> length;
+			data.resize(length);
+			if (length > 0)
+			{
+				Read(&data[0], length);
+			}
+			return *this;
+		}
+	};
+
+	struct Stats
+	{
+		size_t recordCount;
+		size_t spilledCount;
+		size_t arenaUsed;
+		size_t arenaBudget;
+	};
+
+private:
+	struct Entry
+	{
+		uint64_t id;
+		size_t offset;
+		size_t size;
+		bool spilled;
+		std::string spillFile;
+	};
+
+	std::vector<uint8_t> arena;
+	std::vector<uint8_t> staging;
+	std::vector<uint8_t> spillReadBuffer;
+	std::deque<Entry> entries;
+	size_t budget;
+	size_t maxSpilledRecords;
+	size_t spillCounter;
+	uint64_t nextID;
+	int position;
+	bool recording;
+	std::string spillDirectory;
+	Record cursor;
+	std::function<void(uint64_t)> onDiscard;
+
+	size_t FirstInMemory() const;
+	bool Allocate(size_t size, size_t& offset);
+	void EvictOldest();
+	void DropOldest();
+	void DropNewest();
+	void Discard(Entry& entry);
+	bool Spill(Entry& entry, const uint8_t* data);
+	// Points the cursor at the record, false if a spilled record can't be read back
+	bool OpenEntry(size_t index);
+
+public:
+	HistoryJournal(size_t budget = 16 * 1024 * 1024);
+	~HistoryJournal();
+
+	// Byte budget of the in-memory arena, shrinking it evicts the oldest records (and drops the redo
+	//	branch first, if anything has to be evicted)
+	void SetBudget(size_t budget);
+	// Where evicted records go, empty string disables spilling (evicted records are dropped)
+	void SetSpillDirectory(const std::string& directory, size_t maxSpilledRecords = 256);
+
+	// Called with the record ID when a record is dropped for good
+	void SetDiscardCallback(const std::function<void(uint64_t)>& callback) { onDiscard = callback; }
+
+	// Drop every record
+	void Reset();
+	// Start a new record after the current position, this discards the redo branch
+	Record& Begin();
+	// Store the record started with Begin() into the arena
+	//	Returns false if it fits neither the arena nor the spill directory, then it is dropped (the redo
+	//	branch is gone already) and the caller should tell the user that the operation can't be undone
+	bool End();
+
+	bool CanUndo() const { return position >= 0; }
+	bool CanRedo() const { return position < (int)entries.size() - 1; }
+	// Returns the record to revert and steps back, or nullptr if there is nothing to undo. A spilled
+	//	record that can't be read back is dropped with everything older, then nullptr is returned too.
+	Record* Undo();
+	// Steps forward and returns the record to reapply, or nullptr if there is nothing to redo. A spilled
+	//	record that can't be read back is dropped with everything newer.
+	Record* Redo();
+
+	Stats GetStats() const;
+};
+
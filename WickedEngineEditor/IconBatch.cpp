@@ -0,0 +1,93 @@
+#include "stdafx.h"
+#include "IconBatch.h"
+
+using namespace std;
+using namespace DirectX;
+
+
+IconBatch::IconBatch() :textureCount(0), culledCount(0)
+{
+}
+
+void IconBatch::ExtractFrustum(const XMFLOAT4X4& M, XMFLOAT4 planes[6])
+{
+	// Row vectors are multiplied from the left, so the planes are combinations of the matrix columns
+	XMVECTOR c0 = XMVectorSet(M._11, M._21, M._31, M._41);
+	XMVECTOR c1 = XMVectorSet(M._12, M._22, M._32, M._42);
+	XMVECTOR c2 = XMVectorSet(M._13, M._23, M._33, M._43);
+	XMVECTOR c3 = XMVectorSet(M._14, M._24, M._34, M._44);
+
+	XMStoreFloat4(&planes[0], XMPlaneNormalize(c3 + c0)); // left
+	XMStoreFloat4(&planes[1], XMPlaneNormalize(c3 - c0)); // right
+	XMStoreFloat4(&planes[2], XMPlaneNormalize(c3 + c1)); // bottom
+	XMStoreFloat4(&planes[3], XMPlaneNormalize(c3 - c1)); // top
+	XMStoreFloat4(&planes[4], XMPlaneNormalize(c2));      // near
+	XMStoreFloat4(&planes[5], XMPlaneNormalize(c3 - c2)); // far
+}
+
+void IconBatch::Begin(const XMFLOAT4X4& viewProjection, uint32_t textures)
+{
+	ExtractFrustum(viewProjection, planes);
+	textureCount = textures;
+	culledCount = 0;
+	pending.clear();
+	pendingTextures.clear();
+	instances.clear();
+	batches.clear();
+}
+void IconBatch::Add(uint32_t texture, const XMFLOAT3& position, float size, const XMFLOAT4& color)
+{
+	if (texture >= textureCount)
+	{
+		return;
+	}
+
+	XMVECTOR P = XMLoadFloat3(&position);
+	float radius = size * 0.5f;
+	for (int i = 0; i < 6; ++i)
+	{
+		if (XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&planes[i]), P)) < -radius)
+		{
+			culledCount++;
+			return;
+		}
+	}
+
+	Instance instance;
+	instance.position = position;
+	instance.size = size;
+	instance.color = color;
+	pending.push_back(instance);
+	pendingTextures.push_back(texture);
+}
+void IconBatch::End()
+{
+	// Counting sort by texture, the order inside a texture is kept
+	vector<uint32_t> offsets(textureCount + 1, 0);
+	for (auto& x : pendingTextures)
+	{
+		offsets[x + 1]++;
+	}
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		if (offsets[i + 1] > offsets[i])
+		{
+			Batch batch;
+			batch.texture = i;
+			batch.first = offsets[i];
+			batch.count = offsets[i + 1] - offsets[i];
+			batches.push_back(batch);
+		}
+	}
+
+	instances.resize(pending.size());
+	for (size_t i = 0; i < pending.size(); ++i)
+	{
+		instances[offsets[pendingTextures[i]]++] = pending[i];
+	}
+}
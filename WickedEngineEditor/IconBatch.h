@@ -0,0 +1,54 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include <vector>
+#include <cstdint>
+
+// Collects world space editor icons (light icons for example) for one frame
+//	Icons outside the camera frustum are culled and the rest are grouped by texture, so the renderer
+//	can submit them texture by texture. The editor still draws every icon with its own wiImage::Draw,
+//	the batches only keep the texture from changing between them. It doesn't touch the graphics
+//	device, so it works without one.
+class IconBatch
+{
+public:
+	struct Instance
+	{
+		DirectX::XMFLOAT3 position;
+		float size;
+		DirectX::XMFLOAT4 color;
+	};
+	struct Batch
+	{
+		uint32_t texture;	// index of the texture, as given to Add()
+		uint32_t first;		// first instance
+		uint32_t count;
+	};
+
+private:
+	DirectX::XMFLOAT4 planes[6];
+	std::vector<Instance> pending;
+	std::vector<uint32_t> pendingTextures;
+	std::vector<Instance> instances;
+	std::vector<Batch> batches;
+	uint32_t textureCount;
+	uint32_t culledCount;
+
+public:
+	IconBatch();
+
+	// Extracts the frustum planes of a view-projection matrix, with the normals pointing inwards
+	static void ExtractFrustum(const DirectX::XMFLOAT4X4& viewProjection, DirectX::XMFLOAT4 planes[6]);
+
+	// Start a new frame, the icons will be culled against the view-projection
+	void Begin(const DirectX::XMFLOAT4X4& viewProjection, uint32_t textureCount);
+	// The icon is treated as a sphere of half its size for culling
+	void Add(uint32_t texture, const DirectX::XMFLOAT3& position, float size, const DirectX::XMFLOAT4& color);
+	// Sorts the icons by texture and builds the batches
+	void End();
+
+	const std::vector<Instance>& GetInstances() const { return instances; }
+	const std::vector<Batch>& GetBatches() const { return batches; }
+	uint32_t GetCulledCount() const { return culledCount; }
+};
+
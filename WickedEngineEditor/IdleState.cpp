@@ -0,0 +1,25 @@
+#include "IdleState.h"
+
+
+IdleState::IdleState() :quietFrames(0), waited(false)
+{
+}
+
+void IdleState::Update(bool quiet)
+{
+	quietFrames = quiet ? quietFrames + 1 : 0;
+}
+void IdleState::Wake()
+{
+	quietFrames = 0;
+}
+void IdleState::Waited()
+{
+	waited = true;
+}
+bool IdleState::ConsumeWait()
+{
+	bool value = waited;
+	waited = false;
+	return value;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+
+// When the main loop can stop running frames: after a few frames in a row in which nothing changed.
+//	Frame skipping catches up with the time since the previous frame, so the first frame after the
+//	loop waited for messages must not run with it, or the wait comes back as a burst of updates.
+class IdleState
+{
+private:
+	uint32_t quietFrames;
+	bool waited;
+public:
+	static const uint32_t idleAfterFrames = 8;
+
+	IdleState();
+
+	// End of an update, quiet if nothing changed in it
+	void Update(bool quiet);
+	// Something happened (a message, a loading screen), frames are needed again
+	void Wake();
+	// The main loop waited for messages instead of running a frame
+	void Waited();
+	// True once after a wait: the next frame runs one update without catching up
+	bool ConsumeWait();
+
+	bool IsIdle() const { return quietFrames >= idleAfterFrames; }
+};
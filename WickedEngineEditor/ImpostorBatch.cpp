@@ -0,0 +1,267 @@
+#include "stdafx.h"
+#include "ImpostorBatch.h"
+#include "BakeCache.h"
+#include "MeshLODs.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+using namespace std;
+using namespace wiGraphicsTypes;
+
+
+size_t ImpostorBatch::Start(const Settings& settings)
+{
+	struct Usage
+	{
+		uint32_t instances = 0;
+		float radius = 0;
+		bool deformed = false;
+	};
+	unordered_map<Mesh*, Usage> meshes;
+	for (auto& x : wiRenderer::GetScene().models)
+	{
+		for (auto& y : x->objects)
+		{
+			if (y->mesh == nullptr)
+			{
+				continue;
+			}
+			Usage& usage = meshes[y->mesh];
+			usage.instances++;
+			XMFLOAT3 boundsMin = y->bounds.getMin();
+			XMFLOAT3 boundsMax = y->bounds.getMax();
+			float diagonal = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&boundsMax), XMLoadFloat3(&boundsMin))));
+			usage.radius = max(usage.radius, 0.5f * diagonal);
+			// A still image of an animated mesh would be wrong
+			usage.deformed = usage.deformed || y->isArmatureDeformed();
+		}
+	}
+
+	Camera* camera = wiRenderer::getCamera();
+	float screenHeight = (float)wiRenderer::GetDevice()->GetScreenHeight();
+	size_t selected = 0;
+	for (auto& x : meshes)
+	{
+		Mesh* mesh = x.first;
+		const Usage& usage = x.second;
+		if (usage.deformed)
+		{
+			continue;
+		}
+		size_t triangles = 0;
+		for (auto& subset : mesh->subsets)
+		{
+			triangles += subset.subsetIndices.size() / 3;
+		}
+		if (triangles < settings.minTriangles && usage.instances < settings.minInstances)
+		{
+			continue;
+		}
+
+		selected++;
+		mesh->impostorDistance = ComputeImpostorDistance(usage.radius, camera->fov, screenHeight, settings.errorPixels);
+		Push(mesh);
+	}
+	return selected;
+}
+
+void ImpostorBatch::Push(Mesh* mesh)
+{
+	BakeCache* cache = BakeCache::GetInstance();
+	if (!cache->IsUpToDate(mesh, cache->GetImpostorKey(mesh)) && find(queue.begin(), queue.end(), mesh) == queue.end())
+	{
+		queue.push_back(mesh);
+		total++;
+	}
+}
+
+uint32_t ImpostorBatch::Update(float budget)
+{
+	auto start = chrono::steady_clock::now();
+	uint32_t made = 0;
+	while (!queue.empty())
+	{
+		float spent = chrono::duration<float>(chrono::steady_clock::now() - start).count();
+		if (made > 0 && spent + secondsPerImpostor > budget)
+		{
+			break;
+		}
+
+		Mesh* mesh = queue.front();
+		queue.pop_front();
+		completed++;
+
+		// The mesh could have left the scene since it was queued, it is only dereferenced once found
+		bool found = false;
+		for (auto& x : wiRenderer::GetScene().models)
+		{
+			for (auto& y : x->meshes)
+			{
+				if (y.second == mesh)
+				{
+					found = true;
+					break;
+				}
+			}
+			if (found)
+			{
+				break;
+			}
+		}
+		if (!found)
+		{
+			continue;
+		}
+
+		auto impostorStart = chrono::steady_clock::now();
+		MeshLODs::GetInstance()->RestoreFullDetail(mesh);
+		wiRenderer::CreateImpostor(mesh);
+		BakeCache::GetInstance()->SetBaked(mesh, BakeCache::GetInstance()->GetImpostorKey(mesh));
+		made++;
+		atlasStale = true;
+
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - impostorStart).count();
+		secondsPerImpostor = secondsPerImpostor == 0 ? seconds : secondsPerImpostor * 0.75 + seconds * 0.25;
+	}
+
+	if (queue.empty())
+	{
+		completed = 0;
+		total = 0;
+		if (atlasStale)
+		{
+			BuildAtlas();
+		}
+	}
+	return made;
+}
+
+void ImpostorBatch::Clear()
+{
+	queue.clear();
+	completed = 0;
+	total = 0;
+	ReleaseAtlas();
+}
+
+void ImpostorBatch::ReleaseAtlas()
+{
+	for (auto& x : atlasPages)
+	{
+		SAFE_DELETE(x);
+	}
+	atlasPages.clear();
+	atlas.clear();
+	atlasStale = false;
+}
+bool ImpostorBatch::BuildAtlas()
+{
+	ReleaseAtlas();
+
+	vector<Mesh*> meshes;
+	vector<pair<uint32_t, uint32_t>> sizes;
+	for (auto& x : wiRenderer::GetScene().models)
+	{
+		for (auto& y : x->meshes)
+		{
+			Mesh* mesh = y.second;
+			if (mesh->hasImpostor())
+			{
+				const TextureDesc& desc = mesh->impostorTarget.GetTexture()->GetDesc();
+				meshes.push_back(mesh);
+				sizes.push_back(make_pair((uint32_t)desc.Width, (uint32_t)desc.Height));
+			}
+		}
+	}
+	if (meshes.empty())
+	{
+		return false;
+	}
+	vector<AtlasPacker::Rect> rects;
+	if (!packer.Pack(sizes, rects))
+	{
+		wiBackLog::post("An impostor is bigger than an atlas page, the impostor atlas was not built!");
+		return false;
+	}
+
+	// The pages take the format of the impostors, they are all made by the same pass
+	TextureDesc desc = meshes[0]->impostorTarget.GetTexture()->GetDesc();
+	desc.Width = packer.GetPageSize();
+	desc.Height = packer.GetPageSize();
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Usage = USAGE_DEFAULT;
+	desc.BindFlags = BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
+	for (uint32_t i = 0; i < packer.GetPageCount(); ++i)
+	{
+		Texture2D* page = nullptr;
+		wiRenderer::GetDevice()->CreateTexture2D(&desc, nullptr, &page);
+		atlasPages.push_back(page);
+	}
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		const AtlasPacker::Rect& rect = rects[i];
+		wiRenderer::GetDevice()->CopyTexture2D_Region(atlasPages[rect.page], 0, rect.x, rect.y, meshes[i]->impostorTarget.GetTexture(), 0, GRAPHICSTHREAD_IMMEDIATE);
+		AtlasEntry entry;
+		entry.meshName = meshes[i]->name;
+		entry.page = rect.page;
+		entry.uv = packer.GetUV(rect);
+		atlas[meshes[i]] = entry;
+	}
+	return true;
+}
+const ImpostorBatch::AtlasEntry* ImpostorBatch::GetAtlasEntry(const Mesh* mesh) const
+{
+	auto it = atlas.find(mesh);
+	return it != atlas.end() ? &it->second : nullptr;
+}
+bool ImpostorBatch::WriteAtlas(const string& fileName) const
+{
+	if (atlas.empty())
+	{
+		remove(fileName.c_str());
+		return true;
+	}
+
+	for (size_t i = 0; i < atlasPages.size(); ++i)
+	{
+		stringstream ss("");
+		ss << fileName << "." << i << ".dds";
+		if (FAILED(wiRenderer::GetDevice()->SaveTextureDDS(ss.str(), atlasPages[i])))
+		{
+			return false;
+		}
+	}
+	// By name, so that the same scene is always written the same way
+	vector<const AtlasEntry*> entries;
+	for (auto& x : atlas)
+	{
+		entries.push_back(&x.second);
+	}
+	sort(entries.begin(), entries.end(), [](const AtlasEntry* a, const AtlasEntry* b) { return a->meshName < b->meshName; });
+	ofstream file(fileName, ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	for (auto& x : entries)
+	{
+		file << x->page << " " << x->uv.x << " " << x->uv.y << " " << x->uv.z << " " << x->uv.w << " " << x->meshName << endl;
+	}
+	return file.good();
+}
+
+float ImpostorBatch::ComputeImpostorDistance(float radius, float fov, float screenHeight, float errorPixels)
+{
+	// A length L at distance d covers L * screenHeight / (2 * d * tan(fov / 2)) pixels
+	float pixelsPerUnitAtOne = screenHeight / (2 * tanf(fov * 0.5f));
+	return radius * pixelsPerUnitAtOne / max(errorPixels, 0.01f);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "WickedEngine.h"
+#include "AtlasPacker.h"
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+// Impostors for every mesh of the scene that is worth one, made a few per frame
+//	A mesh qualifies with enough triangles or enough instances. Its impostor distance is where the
+//	impostor's error gets smaller than the error target on the screen: an impostor flattens the mesh, so
+//	its error is at most the bounding radius of the largest instance.
+//	When a batch is done, the impostors of the scene are copied into shared atlas pages, every mesh gets a
+//	UV rectangle on one of them. The pages and the rectangles are written next to the scene for the game.
+//	The editor's own view still draws the per mesh textures, the engine's impostor pass samples those.
+class ImpostorBatch
+{
+public:
+	struct Settings
+	{
+		uint32_t minTriangles = 5000;
+		uint32_t minInstances = 32;
+		float errorPixels = 2;		// allowed error on the screen
+	};
+
+	struct AtlasEntry
+	{
+		std::string meshName;	// the mesh is not dereferenced after the atlas was built
+		uint32_t page;
+		XMFLOAT4 uv;			// offset and scale on the page
+	};
+
+private:
+	std::deque<Mesh*> queue;
+	uint32_t completed = 0, total = 0;
+	double secondsPerImpostor = 0;
+	// an impostor was made since the atlas was built
+	bool atlasStale = false;
+	AtlasPacker packer;
+	std::vector<wiGraphicsTypes::Texture2D*> atlasPages;
+	std::unordered_map<const Mesh*, AtlasEntry> atlas;
+
+	void ReleaseAtlas();
+
+public:
+	// Selects the meshes, sets their impostor distances and queues the impostors that are stale.
+	//	Returns the number of meshes selected.
+	size_t Start(const Settings& settings);
+	// Queues the impostor of one mesh, if it is stale and not queued yet
+	void Push(Mesh* mesh);
+	// Makes impostors while the estimated time fits the budget (seconds), at least one per call. The
+	//	atlas is rebuilt when the queue runs empty.
+	uint32_t Update(float budget);
+	// Drops the queue and the atlas
+	void Clear();
+
+	// Packs the impostor of every mesh of the scene that has one, returns false if there was none
+	bool BuildAtlas();
+	const std::vector<wiGraphicsTypes::Texture2D*>& GetAtlasPages() const { return atlasPages; }
+	// nullptr if the mesh is not in the atlas
+	const AtlasEntry* GetAtlasEntry(const Mesh* mesh) const;
+	// The pages as <fileName>.<page>.dds, and one line per mesh into fileName: page u v width height name.
+	//	Without an atlas a stale fileName is deleted.
+	bool WriteAtlas(const std::string& fileName) const;
+
+	bool IsEmpty() const { return queue.empty(); }
+	uint32_t GetCompletedCount() const { return completed; }
+	uint32_t GetTotalCount() const { return total; }
+
+	// World space radius that may be off by errorPixels on a screen of the given height
+	static float ComputeImpostorDistance(float radius, float fov, float screenHeight, float errorPixels);
+};
+
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "LightWindow.h"
+#include "SceneIndex.h"
 
 
 LightWindow::LightWindow(wiGUI* gui) : GUI(gui)
@@ -86,6 +87,8 @@ LightWindow::LightWindow(wiGUI* gui) : GUI(gui)
 		light->type = Light::SPOT;
 		model->lights.push_back(light);
 		wiRenderer::AddModel(model);
+		SceneIndex::GetInstance()->Add(model);
+		SceneIndex::GetInstance()->Add(light);
 	});
 	lightWindow->AddWidget(addLightButton);
 
@@ -0,0 +1,274 @@
+#include "stdafx.h"
+#include "LoadingPipeline.h"
+#include "SceneIndex.h"
+#include "MeshLODs.h"
+
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <unordered_set>
+
+using namespace std;
+
+
+PackageLoader::PackageLoader() :readCount(0), decodedCount(0), createdCount(0), decodersRunning(0), totalCount(0), active(false)
+{
+}
+PackageLoader::~PackageLoader()
+{
+	Cancel();
+}
+
+bool PackageLoader::Start(const string& fileName, int editorVersion)
+{
+	Cancel();
+	if (!reader.Open(fileName, editorVersion))
+	{
+		return false;
+	}
+
+	// Lights and decals come first, they are cheap and make the scene recognizable early
+	vector<uint32_t> order;
+	for (uint32_t i = 0; i < reader.GetChunkCount(); ++i)
+	{
+		if (reader.GetChunk(i).type == ScenePackage::CHUNK_ENTITIES)
+		{
+			order.push_back(i);
+		}
+	}
+	for (uint32_t i = 0; i < reader.GetChunkCount(); ++i)
+	{
+		if (reader.GetChunk(i).type == ScenePackage::CHUNK_MODEL)
+		{
+			order.push_back(i);
+		}
+	}
+
+	// The LOD chains are small, they are read right away and wait for their meshes
+	for (uint32_t i = 0; i < reader.GetChunkCount(); ++i)
+	{
+		vector<uint8_t> data;
+		if (reader.GetChunk(i).type == ScenePackage::CHUNK_LODS && reader.ReadChunk(i, data))
+		{
+			MeshLODs::GetInstance()->SetPending(data.data(), data.size());
+		}
+	}
+
+	uint32_t cores = thread::hardware_concurrency();
+	uint32_t decoders = cores > 1 ? cores - 1 : 1;
+	readQueue.Reset(decoders * 2);
+	decodedQueue.Reset(decoders * 2);
+	readCount.store(0);
+	decodedCount.store(0);
+	decodersRunning.store(decoders);
+	createdCount.store(0);
+	totalCount.store((uint32_t)order.size());
+	pending.assign(order.size(), Job());
+	active.store(true);
+
+	readThread = thread(&PackageLoader::ReadStage, this, order);
+	for (uint32_t i = 0; i < decoders; ++i)
+	{
+		decodeThreads.push_back(thread(&PackageLoader::DecodeStage, this));
+	}
+	return true;
+}
+
+bool PackageLoader::Drain(float budget, uint32_t minimum)
+{
+	if (!active)
+	{
+		return true;
+	}
+
+	auto start = chrono::steady_clock::now();
+	uint32_t added = 0;
+	while (createdCount < totalCount)
+	{
+		Job& next = pending[createdCount];
+		if (!next.decoded)
+		{
+			Job job;
+			if (added < minimum)
+			{
+				if (!decodedQueue.Pop(job))
+				{
+					break;
+				}
+			}
+			else if (!decodedQueue.TryPop(job))
+			{
+				break;
+			}
+			job.decoded = true;
+			pending[job.position] = job;
+			continue;
+		}
+		if (added >= minimum && chrono::duration<float>(chrono::steady_clock::now() - start).count() >= budget)
+		{
+			break;
+		}
+
+		// Resource creation stays on the calling thread
+		Model* model = next.model;
+		next.model = nullptr;
+		createdCount++;
+		added++;
+		if (model != nullptr)
+		{
+			wiRenderer::AddModel(model);
+			SceneIndex::GetInstance()->Add(model);
+			MeshLODs::GetInstance()->Adopt(model);
+		}
+	}
+
+	if (createdCount >= totalCount)
+	{
+		Cancel();
+		return true;
+	}
+	return false;
+}
+
+void PackageLoader::Cancel()
+{
+	// The chunks that were read but not decoded are dropped before a decoder gets to them, the decoders
+	//	only finish the chunk they are working on
+	for (auto& x : readQueue.Abort())
+	{
+		remove(x.tempFileName.c_str());
+	}
+	vector<Model*> models;
+	for (auto& x : decodedQueue.Abort())
+	{
+		models.push_back(x.model);
+	}
+	if (readThread.joinable())
+	{
+		readThread.join();
+	}
+	for (auto& x : decodeThreads)
+	{
+		x.join();
+	}
+	decodeThreads.clear();
+
+	// Whatever was not added yet
+	for (auto& x : pending)
+	{
+		models.push_back(x.model);
+	}
+	pending.clear();
+	models.insert(models.end(), dropped.begin(), dropped.end());
+	dropped.clear();
+	ReleaseModels(models);
+
+	reader.Close();
+	active.store(false);
+}
+
+float PackageLoader::GetProgress() const
+{
+	uint32_t total = totalCount.load();
+	if (total == 0)
+	{
+		return active.load() ? 0.0f : 1.0f;
+	}
+	return (float)(readCount.load() + decodedCount.load() + createdCount.load()) / (float)(total * 3);
+}
+
+
+void PackageLoader::ReleaseModels(vector<Model*>& models)
+{
+	unordered_set<string> textures;
+	for (auto& x : models)
+	{
+		if (x == nullptr)
+		{
+			continue;
+		}
+		for (auto& y : x->materials)
+		{
+			Material* material = y.second;
+			const string* names[] = { &material->textureName, &material->normalMapName, &material->surfaceMapName, &material->displacementMapName };
+			for (auto& name : names)
+			{
+				if (!name->empty())
+				{
+					textures.insert(*name);
+				}
+			}
+		}
+		SAFE_DELETE(x);
+	}
+	models.clear();
+	if (textures.empty())
+	{
+		return;
+	}
+
+	// A texture that is shared with a chunk that was already added stays
+	for (auto& x : wiRenderer::GetScene().models)
+	{
+		for (auto& y : x->materials)
+		{
+			Material* material = y.second;
+			textures.erase(material->textureName);
+			textures.erase(material->normalMapName);
+			textures.erase(material->surfaceMapName);
+			textures.erase(material->displacementMapName);
+		}
+	}
+	for (auto& x : textures)
+	{
+		wiResourceManager::GetGlobal()->del(x);
+	}
+}
+
+void PackageLoader::ReadStage(vector<uint32_t> order)
+{
+	for (uint32_t i = 0; i < (uint32_t)order.size(); ++i)
+	{
+		uint32_t x = order[i];
+		Job job;
+		job.chunk = x;
+		job.position = i;
+		job.tempFileName = reader.GetTempFileName(x);
+		if (!reader.ExtractChunk(x, job.tempFileName))
+		{
+			// still goes through the pipeline, so that the counts add up
+			job.tempFileName.clear();
+		}
+		readCount++;
+		if (!readQueue.Push(job))
+		{
+			remove(job.tempFileName.c_str());
+			return;
+		}
+	}
+	readQueue.Close();
+}
+void PackageLoader::DecodeStage()
+{
+	Job job;
+	while (readQueue.Pop(job))
+	{
+		if (!job.tempFileName.empty())
+		{
+			job.model = ScenePackage::Reader::DecodeChunk(job.tempFileName);
+		}
+		decodedCount++;
+		if (!decodedQueue.Push(job))
+		{
+			// cancelled, the textures are released on the cancelling thread
+			lock_guard<mutex> guard(droppedLock);
+			dropped.push_back(job.model);
+			break;
+		}
+	}
+	// The last decoder lets the consumer know that nothing else is coming
+	if (--decodersRunning == 0)
+	{
+		decodedQueue.Close();
+	}
+}
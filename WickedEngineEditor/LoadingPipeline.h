@@ -0,0 +1,150 @@
+#pragma once
+#include "ScenePackage.h"
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Blocking queue with a fixed capacity between two pipeline stages
+//	A full queue blocks the producer, so a fast stage can't run ahead of a slow one without bound.
+template<typename T>
+class BoundedQueue
+{
+private:
+	std::deque<T> items;
+	std::mutex lock;
+	std::condition_variable notEmpty, notFull;
+	size_t capacity;
+	bool closed;
+public:
+	BoundedQueue(size_t capacity = 8) :capacity(capacity), closed(false) {}
+
+	void Reset(size_t value)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		items.clear();
+		capacity = value;
+		closed = false;
+	}
+	// Returns false if the queue was closed
+	bool Push(const T& item)
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		notFull.wait(guard, [&] { return closed || items.size() < capacity; });
+		if (closed)
+		{
+			return false;
+		}
+		items.push_back(item);
+		notEmpty.notify_one();
+		return true;
+	}
+	// Blocks until there is an item, returns false when the queue is closed and empty
+	bool Pop(T& item)
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		notEmpty.wait(guard, [&] { return closed || !items.empty(); });
+		if (items.empty())
+		{
+			return false;
+		}
+		item = items.front();
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+	bool TryPop(T& item)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (items.empty())
+		{
+			return false;
+		}
+		item = items.front();
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+	// Wakes up everyone, the remaining items can still be popped
+	void Close()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		closed = true;
+		notEmpty.notify_all();
+		notFull.notify_all();
+	}
+	// Closes the queue and takes the remaining items out, so that no consumer starts on them
+	std::deque<T> Abort()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		closed = true;
+		std::deque<T> dropped;
+		dropped.swap(items);
+		notEmpty.notify_all();
+		notFull.notify_all();
+		return dropped;
+	}
+};
+
+// Loads a scene package in stages: read (chunk out of the mapping) -> decode (deserialize the model,
+//	textures are loaded here) -> create (add the model to the scene). Reading runs on one thread, decoding
+//	on a worker pool, and creation is done by whoever owns the scene, through Drain().
+//	The textures are created on the decoders the same way wiRenderer::LoadModel creates them on the
+//	loading screen thread: the resource manager is locked and the engine locks the device around the
+//	immediate context work (mip generation), so only adding the models to the scene needs the main thread.
+class PackageLoader
+{
+private:
+	struct Job
+	{
+		uint32_t chunk;
+		uint32_t position;	// in the loading order
+		std::string tempFileName;
+		Model* model;
+		bool decoded;
+
+		Job() :chunk(0), position(0), model(nullptr), decoded(false) {}
+	};
+
+	ScenePackage::Reader reader;
+	BoundedQueue<Job> readQueue;
+	BoundedQueue<Job> decodedQueue;
+	// Decoders finish out of order, decoded models wait here until every chunk before them was added
+	std::vector<Job> pending;
+	// Models that a decoder finished after the loader was cancelled
+	std::vector<Model*> dropped;
+	std::mutex droppedLock;
+	std::thread readThread;
+	std::vector<std::thread> decodeThreads;
+	std::atomic<uint32_t> readCount, decodedCount, createdCount, decodersRunning;
+	std::atomic<uint32_t> totalCount;
+	std::atomic<bool> active;
+
+	void ReadStage(std::vector<uint32_t> order);
+	void DecodeStage();
+	// Deletes models that never made it into the scene, with the textures that only they use
+	static void ReleaseModels(std::vector<Model*>& models);
+
+public:
+	PackageLoader();
+	~PackageLoader();
+
+	// Starts the read and decode stages, returns false if the file is not a package
+	bool Start(const std::string& fileName, int editorVersion);
+	// Adds decoded models to the scene until the budget (seconds) is spent, in the loading order: the
+	//	entities chunk first, then the model chunks by index. It blocks until at least minimum models were
+	//	added (or there are no more). Returns true when everything was added.
+	bool Drain(float budget, uint32_t minimum = 0);
+	// Stops the workers and drops what was not added yet: chunks waiting to be decoded are not decoded,
+	//	and the textures of the decoded ones are deleted unless a model of the scene uses them
+	void Cancel();
+
+	bool IsActive() const { return active.load(); }
+	// 0..1 over all three stages
+	float GetProgress() const;
+};
+
@@ -0,0 +1,70 @@
+#include "stdafx.h"
+#include "MainThreadQueue.h"
+
+using namespace std;
+
+
+MainThreadQueue::MainThreadQueue()
+{
+	stub.next.store(nullptr, memory_order_relaxed);
+	head.store(&stub, memory_order_relaxed);
+	tail = &stub;
+}
+MainThreadQueue::~MainThreadQueue()
+{
+	function<void()> task;
+	while (Pop(task))
+	{
+	}
+	if (tail != &stub)
+	{
+		delete tail;
+	}
+}
+
+void MainThreadQueue::Post(const function<void()>& task)
+{
+	Node* node = new Node;
+	node->task = task;
+	node->next.store(nullptr, memory_order_relaxed);
+
+	Node* prev = head.exchange(node, memory_order_acq_rel);
+	// Until this store the consumer sees the queue end at prev, the task is picked up next frame then
+	prev->next.store(node, memory_order_release);
+
+	if (wakeup != nullptr)
+	{
+		wakeup();
+	}
+}
+size_t MainThreadQueue::Drain()
+{
+	// Tasks posted while draining (also by the tasks themselves) are run in this same call
+	size_t count = 0;
+	function<void()> task;
+	while (Pop(task))
+	{
+		task();
+		count++;
+	}
+	return count;
+}
+
+bool MainThreadQueue::Pop(function<void()>& task)
+{
+	Node* next = tail->next.load(memory_order_acquire);
+	if (next == nullptr)
+	{
+		return false;
+	}
+
+	// The popped node becomes the new sentinel, only its task is taken
+	task = move(next->task);
+	next->task = nullptr;
+	if (tail != &stub)
+	{
+		delete tail;
+	}
+	tail = next;
+	return true;
+}
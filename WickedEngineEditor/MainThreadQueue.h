@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+// Lock-free multiple producer, single consumer queue of tasks for the main thread
+//	Worker threads (file dialogs, loaders) post closures instead of touching the renderer or the
+//	components directly, the main loop runs them once per frame with Drain().
+class MainThreadQueue
+{
+private:
+	struct Node
+	{
+		std::atomic<Node*> next;
+		std::function<void()> task;
+	};
+
+	// Producers swap themselves into head, the consumer follows the links from tail
+	std::atomic<Node*> head;
+	Node* tail;
+	Node stub;
+	std::function<void()> wakeup;
+
+	bool Pop(std::function<void()>& task);
+
+public:
+	MainThreadQueue();
+	~MainThreadQueue();
+
+	// Can be called from any thread
+	void Post(const std::function<void()>& task);
+	// Called by Post() on the posting thread, so that a main loop that sleeps while idle wakes up.
+	//	Set it before any other thread can post.
+	void SetWakeup(const std::function<void()>& callback) { wakeup = callback; }
+	// Runs every task that was posted so far, only from the main thread. Returns the number of tasks run.
+	size_t Drain();
+};
+
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file
+//	Pages are only read from the disk when they are touched, so random access into a big file
+//	doesn't load the rest of it.
+class MappedFile
+{
+private:
+	void* fileHandle;
+	void* mappingHandle;
+	const uint8_t* data;
+	size_t size;
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const std::string& fileName);
+	void Close();
+
+	bool IsOpen() const { return data != nullptr; }
+	const uint8_t* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+};
+
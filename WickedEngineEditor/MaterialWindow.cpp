@@ -7,6 +7,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 	assert(GUI && "Invalid GUI!");
 
 	material = nullptr;
+	locked = false;
 
 	float screenW = (float)wiRenderer::GetDevice()->GetScreenWidth();
 	float screenH = (float)wiRenderer::GetDevice()->GetScreenHeight();
@@ -171,8 +172,8 @@ void MaterialWindow::SetMaterial(Material* mat)
 		emissiveSlider->SetValue(material->emissive);
 		sssSlider->SetValue(material->subsurfaceScattering);
 		pomSlider->SetValue(material->parallaxOcclusionMapping);
-		materialWindow->SetEnabled(true);
-		colorPicker->SetEnabled(true);
+		materialWindow->SetEnabled(!locked);
+		colorPicker->SetEnabled(!locked);
 	}
 	else
 	{
@@ -181,3 +182,13 @@ void MaterialWindow::SetMaterial(Material* mat)
 		colorPicker->SetEnabled(false);
 	}
 }
+void MaterialWindow::SetLocked(bool value)
+{
+	if (locked == value)
+	{
+		return;
+	}
+	locked = value;
+	materialWindow->SetEnabled(!locked && material != nullptr);
+	colorPicker->SetEnabled(!locked && material != nullptr);
+}
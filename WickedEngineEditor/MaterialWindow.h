@@ -16,10 +16,13 @@ public:
 	~MaterialWindow();
 
 	void SetMaterial(Material* mat);
+	// A locked window takes no edits, while the scene writer is reading the materials
+	void SetLocked(bool value);
 
 	wiGUI* GUI;
 
 	Material* material;
+	bool locked;
 
 	wiWindow*	materialWindow;
 	wiLabel*	materialLabel;
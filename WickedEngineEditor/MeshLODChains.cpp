@@ -0,0 +1,166 @@
+#include "stdafx.h"
+#include "MeshLODs.h"
+#include "BakeCache.h"
+
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// The chains on their own: building, hashing and serializing them only reads the meshes, so the
+//	converter compiles this without the renderer part in MeshLODs.cpp
+
+namespace
+{
+	template<typename T>
+	void Put(vector<uint8_t>& data, const T& value)
+	{
+		const uint8_t* bytes = (const uint8_t*)&value;
+		data.insert(data.end(), bytes, bytes + sizeof(T));
+	}
+	template<typename T>
+	bool Get(const uint8_t*& data, const uint8_t* end, T& value)
+	{
+		if ((size_t)(end - data) < sizeof(T))
+		{
+			return false;
+		}
+		memcpy(&value, data, sizeof(T));
+		data += sizeof(T);
+		return true;
+	}
+}
+
+
+void MeshLODs::BuildChains(const vector<Mesh*>& meshes, uint32_t levelCount, uint32_t threadCount, vector<Chain>& chains)
+{
+	chains.clear();
+	chains.resize(meshes.size());
+	atomic<size_t> next(0);
+	auto work = [&] {
+		size_t i;
+		vector<XMFLOAT3> positions;
+		while ((i = next.fetch_add(1)) < meshes.size())
+		{
+			const Mesh* mesh = meshes[i];
+			positions.resize(mesh->vertices.size());
+			for (size_t v = 0; v < positions.size(); ++v)
+			{
+				const XMFLOAT4& pos = mesh->vertices[v].pos;
+				positions[v] = XMFLOAT3(pos.x, pos.y, pos.z);
+			}
+			chains[i].meshName = mesh->name;
+			chains[i].geometryHash = HashGeometry(mesh);
+			MeshSimplifier::BuildChain(positions.data(), positions.size(), GetSubsetIndices(mesh), levelCount, chains[i].levels);
+		}
+	};
+	if (threadCount == 0)
+	{
+		threadCount = max(1u, thread::hardware_concurrency());
+	}
+	size_t workerCount = min((size_t)threadCount, meshes.size());
+	vector<thread> workers;
+	for (size_t i = 1; i < workerCount; ++i)
+	{
+		workers.push_back(thread(work));
+	}
+	work();
+	for (auto& x : workers)
+	{
+		x.join();
+	}
+}
+MeshSimplifier::SubsetIndices MeshLODs::GetSubsetIndices(const Mesh* mesh)
+{
+	MeshSimplifier::SubsetIndices subsets(mesh->subsets.size());
+	for (size_t s = 0; s < mesh->subsets.size(); ++s)
+	{
+		subsets[s].assign(mesh->subsets[s].subsetIndices.begin(), mesh->subsets[s].subsetIndices.end());
+	}
+	return subsets;
+}
+uint64_t MeshLODs::HashGeometry(const Mesh* mesh)
+{
+	uint64_t hash = BakeCache::Hash(mesh->vertices.data(), mesh->vertices.size() * sizeof(mesh->vertices[0]));
+	for (auto& x : mesh->subsets)
+	{
+		hash = BakeCache::Hash(x.subsetIndices.data(), x.subsetIndices.size() * sizeof(x.subsetIndices[0]), hash);
+	}
+	return hash;
+}
+
+void MeshLODs::WriteChains(const vector<const Chain*>& chains, vector<uint8_t>& data)
+{
+	// The first level is the mesh itself, it is not stored
+	Put(data, (uint32_t)chains.size());
+	for (auto& x : chains)
+	{
+		Put(data, (uint32_t)x->meshName.length());
+		data.insert(data.end(), x->meshName.begin(), x->meshName.end());
+		Put(data, x->geometryHash);
+		Put(data, (uint32_t)(x->levels.size() - 1));
+		for (size_t l = 1; l < x->levels.size(); ++l)
+		{
+			const MeshSimplifier::Level& level = x->levels[l];
+			Put(data, level.error);
+			Put(data, (uint32_t)level.subsetIndices.size());
+			for (auto& y : level.subsetIndices)
+			{
+				Put(data, (uint32_t)y.size());
+				const uint8_t* bytes = (const uint8_t*)y.data();
+				data.insert(data.end(), bytes, bytes + y.size() * sizeof(uint32_t));
+			}
+		}
+	}
+}
+bool MeshLODs::ReadChains(const uint8_t* data, size_t size, vector<Chain>& chains)
+{
+	const uint8_t* end = data + size;
+	uint32_t chainCount;
+	if (!Get(data, end, chainCount))
+	{
+		return false;
+	}
+	chains.resize(chainCount);
+	for (auto& x : chains)
+	{
+		uint32_t nameLength, levelCount;
+		if (!Get(data, end, nameLength) || (size_t)(end - data) < nameLength)
+		{
+			return false;
+		}
+		x.meshName.assign((const char*)data, nameLength);
+		data += nameLength;
+		if (!Get(data, end, x.geometryHash) || !Get(data, end, levelCount))
+		{
+			return false;
+		}
+		// Placeholder for the full detail, filled in from the mesh
+		x.levels.resize(levelCount + 1);
+		for (uint32_t l = 1; l <= levelCount; ++l)
+		{
+			MeshSimplifier::Level& level = x.levels[l];
+			uint32_t subsetCount;
+			if (!Get(data, end, level.error) || !Get(data, end, subsetCount))
+			{
+				return false;
+			}
+			level.subsetIndices.resize(subsetCount);
+			for (auto& y : level.subsetIndices)
+			{
+				uint32_t indexCount;
+				if (!Get(data, end, indexCount) || (size_t)(end - data) / sizeof(uint32_t) < indexCount)
+				{
+					return false;
+				}
+				y.resize(indexCount);
+				memcpy(y.data(), data, indexCount * sizeof(uint32_t));
+				data += indexCount * sizeof(uint32_t);
+			}
+			level.triangleCount = MeshSimplifier::CountTriangles(level.subsetIndices);
+		}
+	}
+	return data == end;
+}
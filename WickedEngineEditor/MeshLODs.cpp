@@ -0,0 +1,250 @@
+#include "stdafx.h"
+#include "MeshLODs.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <new>
+#include <cmath>
+#include <cfloat>
+
+using namespace std;
+using namespace wiGraphicsTypes;
+
+MeshLODs* MeshLODs::instance = nullptr;
+
+MeshLODs* MeshLODs::GetInstance()
+{
+	if (instance == nullptr)
+	{
+		instance = new MeshLODs;
+	}
+	return instance;
+}
+
+void MeshLODs::Set(Mesh* mesh, const Chain& chain)
+{
+	RestoreFullDetail(mesh);
+	Entry& entry = entries[mesh];
+	entry.chain = chain;
+	entry.current = 0;
+}
+const MeshLODs::Chain* MeshLODs::Get(const Mesh* mesh) const
+{
+	auto it = entries.find(const_cast<Mesh*>(mesh));
+	return it != entries.end() ? &it->second.chain : nullptr;
+}
+size_t MeshLODs::GetLevel(const Mesh* mesh) const
+{
+	auto it = entries.find(const_cast<Mesh*>(mesh));
+	return it != entries.end() ? it->second.current : 0;
+}
+void MeshLODs::Forget(Mesh* mesh)
+{
+	RestoreFullDetail(mesh);
+	entries.erase(mesh);
+}
+void MeshLODs::Clear()
+{
+	// The meshes are about to be deleted, nothing is restored
+	entries.clear();
+	pending.clear();
+}
+
+void MeshLODs::Apply(Mesh* mesh, size_t level)
+{
+	auto it = entries.find(mesh);
+	if (it == entries.end() || it->second.current == level || level >= it->second.chain.levels.size())
+	{
+		return;
+	}
+	const MeshSimplifier::Level& source = it->second.chain.levels[level];
+	if (source.subsetIndices.size() != mesh->subsets.size())
+	{
+		return;
+	}
+
+	for (size_t s = 0; s < mesh->subsets.size(); ++s)
+	{
+		mesh->subsets[s].subsetIndices.assign(source.subsetIndices[s].begin(), source.subsetIndices[s].end());
+	}
+	UploadIndices(mesh);
+	it->second.current = level;
+}
+void MeshLODs::UploadIndices(Mesh* mesh)
+{
+	for (auto& subset : mesh->subsets)
+	{
+		if (subset.subsetIndices.empty())
+		{
+			continue;
+		}
+		// The loader makes the index buffers immutable. The first upload puts a default usage buffer of the
+		//	same size in place, the full detail fits in it, so every level does.
+		GPUBufferDesc desc = subset.indexBuffer.GetDesc();
+		if (desc.Usage != USAGE_DEFAULT)
+		{
+			desc.Usage = USAGE_DEFAULT;
+			desc.CPUAccessFlags = 0;
+			subset.indexBuffer.~GPUBuffer();
+			new (&subset.indexBuffer) GPUBuffer;
+			wiRenderer::GetDevice()->CreateBuffer(&desc, nullptr, &subset.indexBuffer);
+		}
+		wiRenderer::GetDevice()->UpdateBuffer(&subset.indexBuffer, subset.subsetIndices.data(), GRAPHICSTHREAD_IMMEDIATE,
+			(int)(sizeof(subset.subsetIndices[0]) * subset.subsetIndices.size()));
+	}
+}
+void MeshLODs::RestoreFullDetail(Mesh* mesh)
+{
+	Apply(mesh, 0);
+}
+void MeshLODs::RestoreFullDetail()
+{
+	for (auto& x : entries)
+	{
+		Apply(x.first, 0);
+	}
+}
+
+void MeshLODs::Prune()
+{
+	size_t live = 0;
+	for (auto& x : wiRenderer::GetScene().models)
+	{
+		for (auto& y : x->meshes)
+		{
+			live += entries.count(y.second);
+		}
+	}
+	if (live == entries.size())
+	{
+		return;
+	}
+	// The meshes that left the scene may be freed already, they are not restored
+	unordered_set<Mesh*> alive;
+	for (auto& x : wiRenderer::GetScene().models)
+	{
+		for (auto& y : x->meshes)
+		{
+			alive.insert(y.second);
+		}
+	}
+	for (auto it = entries.begin(); it != entries.end();)
+	{
+		if (alive.find(it->first) == alive.end())
+		{
+			it = entries.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void MeshLODs::Select(const XMFLOAT3& eye, float fov, float screenHeight, float errorPixels)
+{
+	Prune();
+	if (entries.empty())
+	{
+		return;
+	}
+
+	// Distance over scale of the closest instance, the level errors are in object space
+	unordered_map<Mesh*, float> closest;
+	XMVECTOR E = XMLoadFloat3(&eye);
+	for (auto& x : wiRenderer::GetScene().models)
+	{
+		for (auto& y : x->objects)
+		{
+			if (y->mesh == nullptr || entries.find(y->mesh) == entries.end())
+			{
+				continue;
+			}
+			XMFLOAT3 boundsMin = y->bounds.getMin();
+			XMFLOAT3 boundsMax = y->bounds.getMax();
+			XMVECTOR P = XMVectorClamp(E, XMLoadFloat3(&boundsMin), XMLoadFloat3(&boundsMax));
+			float distance = XMVectorGetX(XMVector3Length(E - P));
+			XMMATRIX W = XMLoadFloat4x4(&y->world);
+			float scale = max(max(XMVectorGetX(XMVector3Length(W.r[0])), XMVectorGetX(XMVector3Length(W.r[1]))), XMVectorGetX(XMVector3Length(W.r[2])));
+			float ratio = scale > 0 ? distance / scale : FLT_MAX;
+			auto it = closest.find(y->mesh);
+			if (it == closest.end() || ratio < it->second)
+			{
+				closest[y->mesh] = ratio;
+			}
+		}
+	}
+
+	// An error e at distance d covers e * screenHeight / (2 * d * tan(fov / 2)) pixels
+	float pixelsPerUnitAtOne = screenHeight / (2 * tanf(fov * 0.5f));
+	const float keepMargin = 1.25f;
+	for (auto& x : closest)
+	{
+		// Hysteresis: a switch uploads the index buffers, so a mesh at the boundary of two levels must not
+		//	flip between them every frame. The shown level and the finer ones are kept up to keepMargin
+		//	times the target, a coarser level is only taken under the target.
+		const Entry& entry = entries[x.first];
+		const Chain& chain = entry.chain;
+		size_t level = 0;
+		for (size_t l = chain.levels.size() - 1; l > 0; --l)
+		{
+			float margin = l <= entry.current ? keepMargin : 1.0f;
+			if (chain.levels[l].error * pixelsPerUnitAtOne <= errorPixels * margin * x.second)
+			{
+				level = l;
+				break;
+			}
+		}
+		Apply(x.first, level);
+	}
+}
+
+void MeshLODs::Write(vector<uint8_t>& data) const
+{
+	vector<const Chain*> chains;
+	for (auto& x : entries)
+	{
+		chains.push_back(&x.second.chain);
+	}
+	WriteChains(chains, data);
+}
+void MeshLODs::SetPending(const uint8_t* data, size_t size)
+{
+	pending.clear();
+	vector<Chain> chains;
+	if (!ReadChains(data, size, chains))
+	{
+		wiBackLog::post("The LOD chains of the scene are corrupted, they were skipped!");
+		return;
+	}
+	for (auto& x : chains)
+	{
+		pending[x.meshName] = x;
+	}
+}
+void MeshLODs::Adopt(Model* model)
+{
+	if (pending.empty())
+	{
+		return;
+	}
+	for (auto& x : model->meshes)
+	{
+		auto it = pending.find(x.first);
+		if (it == pending.end())
+		{
+			continue;
+		}
+		Mesh* mesh = x.second;
+		// A chain of different geometry would reference the wrong vertices
+		if (it->second.geometryHash == HashGeometry(mesh))
+		{
+			MeshSimplifier::Level& full = it->second.levels[0];
+			full.subsetIndices = GetSubsetIndices(mesh);
+			full.error = 0;
+			full.triangleCount = MeshSimplifier::CountTriangles(full.subsetIndices);
+			Set(mesh, it->second);
+		}
+		pending.erase(it);
+	}
+}
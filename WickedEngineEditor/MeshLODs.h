@@ -0,0 +1,78 @@
+#pragma once
+#include "WickedEngine.h"
+#include "MeshSimplifier.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// LOD chains of the meshes of the scene
+//	A level is a simplified index list per subset on the vertices of the mesh, so switching the level
+//	only replaces the subset indices (and their index buffers). Every frame the coarsest level whose
+//	error stays under the error target on the screen is shown, for the closest instance of the mesh.
+//	Everything else that reads the geometry (saving, bakes) sees the full detail: the writer and the
+//	impostors switch back to it first, the bake keys hash the first level.
+class MeshLODs
+{
+public:
+	struct Chain
+	{
+		std::string meshName;
+		uint64_t geometryHash;	// of the full detail, a chain is only restored on the same geometry
+		std::vector<MeshSimplifier::Level> levels;
+	};
+
+private:
+	struct Entry
+	{
+		Chain chain;
+		size_t current;
+	};
+
+	static MeshLODs* instance;
+	std::unordered_map<Mesh*, Entry> entries;
+	// Chains of a scene that is still loading, by mesh name
+	std::unordered_map<std::string, Chain> pending;
+
+public:
+	static MeshLODs* GetInstance();
+
+	// Building and serializing the chains is in MeshLODChains.cpp, it doesn't touch the renderer
+	// Simplifies the meshes on a worker pool, one mesh per task. The meshes are only read.
+	static void BuildChains(const std::vector<Mesh*>& meshes, uint32_t levelCount, uint32_t threadCount, std::vector<Chain>& chains);
+	static uint64_t HashGeometry(const Mesh* mesh);
+	// The full detail
+	static MeshSimplifier::SubsetIndices GetSubsetIndices(const Mesh* mesh);
+
+	// Scene package chunk of the chains
+	static void WriteChains(const std::vector<const Chain*>& chains, std::vector<uint8_t>& data);
+	static bool ReadChains(const uint8_t* data, size_t size, std::vector<Chain>& chains);
+
+	void Set(Mesh* mesh, const Chain& chain);
+	const Chain* Get(const Mesh* mesh) const;
+	size_t GetLevel(const Mesh* mesh) const;
+	void Forget(Mesh* mesh);
+	// Drops the entries of the meshes that are not in the scene any more, Select() does it every frame
+	void Prune();
+	void Clear();
+
+	// Copies the subset indices of the mesh into its index buffers
+	static void UploadIndices(Mesh* mesh);
+
+	// Replaces the subset indices of the mesh with the ones of the level
+	void Apply(Mesh* mesh, size_t level);
+	void RestoreFullDetail(Mesh* mesh);
+	void RestoreFullDetail();
+	// Picks the levels from the camera, errorPixels is the allowed error on the screen. A level is kept
+	//	until its error is a quarter over the target, so it doesn't flip at the boundary.
+	void Select(const XMFLOAT3& eye, float fov, float screenHeight, float errorPixels);
+
+	// Serializes the chains of the scene, for the scene package
+	void Write(std::vector<uint8_t>& data) const;
+	// Chains of a package that is being loaded, they are attached by Adopt() as the meshes arrive
+	void SetPending(const uint8_t* data, size_t size);
+	// Attaches the pending chains to the meshes of the model that have the same name and geometry
+	void Adopt(Model* model);
+};
+
@@ -0,0 +1,431 @@
+#include "stdafx.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace DirectX;
+
+namespace
+{
+	// Forsyth's scoring, the cache here is only for the scoring, it is larger than the one of the GPU
+	const uint32_t scoringCacheSize = 32;
+
+	float VertexScore(int cachePosition, uint32_t remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+		{
+			return -1;
+		}
+		float score = 0;
+		if (cachePosition >= 0)
+		{
+			// The last triangle's vertices get a fixed score, so the next one doesn't just reuse its edge
+			if (cachePosition < 3)
+			{
+				score = 0.75f;
+			}
+			else
+			{
+				score = powf(1.0f - (float)(cachePosition - 3) / (float)(scoringCacheSize - 3), 1.5f);
+			}
+		}
+		// Vertices with few triangles left are finished first, so they leave the cache for good
+		score += 2.0f / sqrtf((float)remainingTriangles);
+		return score;
+	}
+
+	struct Triangle
+	{
+		uint32_t indices[3];
+	};
+	XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+}
+
+
+void MeshOptimizer::Statistics::Add(const Statistics& other)
+{
+	transformedCount += other.transformedCount;
+	triangleCount += other.triangleCount;
+	usedVertexCount += other.usedVertexCount;
+	acmr = triangleCount > 0 ? (float)transformedCount / (float)triangleCount : 0;
+	atvr = usedVertexCount > 0 ? (float)transformedCount / (float)usedVertexCount : 0;
+}
+
+MeshOptimizer::Statistics MeshOptimizer::AnalyzeVertexCache(const vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	Statistics statistics = { 0, 0, 0, 0, 0 };
+	if (indices.size() < 3)
+	{
+		return statistics;
+	}
+
+	// The timestamp of a vertex tells if it is still among the last cacheSize misses
+	vector<uint32_t> timestamps(vertexCount, 0);
+	vector<uint8_t> used(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	size_t misses = 0, usedCount = 0;
+	for (auto& x : indices)
+	{
+		if (time - timestamps[x] > cacheSize)
+		{
+			timestamps[x] = time++;
+			misses++;
+		}
+		if (!used[x])
+		{
+			used[x] = 1;
+			usedCount++;
+		}
+	}
+	statistics.transformedCount = misses;
+	statistics.triangleCount = indices.size() / 3;
+	statistics.usedVertexCount = usedCount;
+	statistics.acmr = (float)misses / (float)statistics.triangleCount;
+	statistics.atvr = (float)misses / (float)usedCount;
+	return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(vector<uint32_t>& indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangles of every vertex
+	vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+	{
+		offsets[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		offsets[v + 1] += offsets[v];
+	}
+	vector<uint32_t> adjacency(triangleCount * 3);
+	vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+	{
+		uint32_t v = indices[i];
+		adjacency[offsets[v] + remaining[v]++] = (uint32_t)(i / 3);
+	}
+
+	vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		vertexScores[v] = VertexScore(-1, remaining[v]);
+	}
+	vector<uint8_t> emitted(triangleCount, 0);
+
+	vector<uint32_t> cache, nextCache;
+	vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+	size_t scan = 0;
+	int best = -1;
+	while (result.size() < triangleCount * 3)
+	{
+		// Nothing good around the cache, the next triangle is taken in the input order
+		if (best < 0)
+		{
+			while (emitted[scan])
+			{
+				scan++;
+			}
+			best = (int)scan;
+		}
+
+		const uint32_t* triangle = &indices[best * 3];
+		result.insert(result.end(), triangle, triangle + 3);
+		emitted[best] = 1;
+
+		// The triangle's vertices go to the front of the cache, and it is taken out of their lists
+		nextCache.clear();
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32_t v = triangle[k];
+			nextCache.push_back(v);
+			uint32_t* list = &adjacency[offsets[v]];
+			for (uint32_t i = 0; i < remaining[v]; ++i)
+			{
+				if (list[i] == (uint32_t)best)
+				{
+					list[i] = list[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+		for (auto& x : cache)
+		{
+			if (x != triangle[0] && x != triangle[1] && x != triangle[2])
+			{
+				nextCache.push_back(x);
+			}
+		}
+		for (size_t i = scoringCacheSize; i < nextCache.size(); ++i)
+		{
+			vertexScores[nextCache[i]] = VertexScore(-1, remaining[nextCache[i]]);
+		}
+		if (nextCache.size() > scoringCacheSize)
+		{
+			nextCache.resize(scoringCacheSize);
+		}
+		cache.swap(nextCache);
+
+		// Only the triangles around the cache changed their scores, the best of them is next
+		for (size_t i = 0; i < cache.size(); ++i)
+		{
+			vertexScores[cache[i]] = VertexScore((int)i, remaining[cache[i]]);
+		}
+		best = -1;
+		float bestScore = -1;
+		for (auto& v : cache)
+		{
+			for (uint32_t i = 0; i < remaining[v]; ++i)
+			{
+				uint32_t t = adjacency[offsets[v] + i];
+				float score = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					best = (int)t;
+				}
+			}
+		}
+	}
+	indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(vector<uint32_t>& indices, const XMFLOAT3* positions, size_t vertexCount, float threshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	// A cluster ends where a triangle misses the cache with all of its vertices: the cache order started
+	//	over there, so moving the clusters around costs little
+	const uint32_t cacheSize = 16;
+	vector<uint32_t> clusterStarts;
+	{
+		vector<uint32_t> timestamps(vertexCount, 0);
+		uint32_t time = cacheSize + 1;
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			int misses = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t v = indices[t * 3 + k];
+				if (time - timestamps[v] > cacheSize)
+				{
+					timestamps[v] = time++;
+					misses++;
+				}
+			}
+			if (t == 0 || misses == 3)
+			{
+				clusterStarts.push_back((uint32_t)t);
+			}
+		}
+	}
+	if (clusterStarts.size() < 2)
+	{
+		return;
+	}
+	clusterStarts.push_back((uint32_t)triangleCount);
+
+	// The mesh centroid and every cluster's area weighted centroid and normal
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0;
+	size_t clusterCount = clusterStarts.size() - 1;
+	vector<float> sortKeys(clusterCount);
+	vector<XMVECTOR> clusterCentroids(clusterCount), clusterNormals(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		XMVECTOR centroid = XMVectorZero(), normal = XMVectorZero();
+		float area = 0;
+		for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+		{
+			const XMFLOAT3& p0 = positions[indices[t * 3 + 0]];
+			const XMFLOAT3& p1 = positions[indices[t * 3 + 1]];
+			const XMFLOAT3& p2 = positions[indices[t * 3 + 2]];
+			XMFLOAT3 e0 = Sub(p1, p0), e1 = Sub(p2, p0);
+			XMVECTOR N = XMVector3Cross(XMLoadFloat3(&e0), XMLoadFloat3(&e1));
+			float triangleArea = XMVectorGetX(XMVector3Length(N)) * 0.5f;
+			XMVECTOR C = (XMLoadFloat3(&p0) + XMLoadFloat3(&p1) + XMLoadFloat3(&p2)) / 3.0f;
+			centroid += C * triangleArea;
+			normal += N;
+			area += triangleArea;
+		}
+		meshCentroid += centroid;
+		meshArea += area;
+		clusterCentroids[c] = area > 0 ? centroid / area : centroid;
+		clusterNormals[c] = XMVector3Normalize(normal);
+	}
+	if (meshArea <= 0)
+	{
+		return;
+	}
+	meshCentroid /= meshArea;
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		sortKeys[c] = XMVectorGetX(XMVector3Dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]));
+	}
+
+	// Outward facing clusters first
+	vector<uint32_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		order[c] = (uint32_t)c;
+	}
+	stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (auto& c : order)
+	{
+		result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+	}
+
+	// The cache must not suffer more than allowed
+	float before = AnalyzeVertexCache(indices, vertexCount, cacheSize).acmr;
+	float after = AnalyzeVertexCache(result, vertexCount, cacheSize).acmr;
+	if (after <= before * threshold)
+	{
+		indices.swap(result);
+	}
+}
+
+vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(vector<vector<uint32_t>*>& lists, size_t vertexCount)
+{
+	vector<uint32_t> remap(vertexCount, UINT32_MAX);
+	uint32_t next = 0;
+	for (auto& x : lists)
+	{
+		for (auto& index : *x)
+		{
+			if (remap[index] == UINT32_MAX)
+			{
+				remap[index] = next++;
+			}
+			index = remap[index];
+		}
+	}
+	for (auto& x : remap)
+	{
+		if (x == UINT32_MAX)
+		{
+			x = next++;
+		}
+	}
+	return remap;
+}
+
+bool MeshOptimizer::IsSameTopology(const vector<uint32_t>& before, const vector<uint32_t>& after, const vector<uint32_t>& remap)
+{
+	if (before.size() != after.size() || before.size() % 3 != 0)
+	{
+		return false;
+	}
+
+	// Every triangle is rotated so that its smallest index comes first, that keeps the winding
+	auto canonical = [](const uint32_t* t, const vector<uint32_t>* remap) {
+		Triangle x;
+		for (int k = 0; k < 3; ++k)
+		{
+			x.indices[k] = remap != nullptr ? (*remap)[t[k]] : t[k];
+		}
+		while (x.indices[0] > x.indices[1] || x.indices[0] > x.indices[2])
+		{
+			uint32_t first = x.indices[0];
+			x.indices[0] = x.indices[1];
+			x.indices[1] = x.indices[2];
+			x.indices[2] = first;
+		}
+		return x;
+	};
+	auto less = [](const Triangle& a, const Triangle& b) {
+		return lexicographical_compare(a.indices, a.indices + 3, b.indices, b.indices + 3);
+	};
+
+	vector<Triangle> a, b;
+	for (size_t i = 0; i < before.size(); i += 3)
+	{
+		a.push_back(canonical(&before[i], remap.empty() ? nullptr : &remap));
+		b.push_back(canonical(&after[i], nullptr));
+	}
+	sort(a.begin(), a.end(), less);
+	sort(b.begin(), b.end(), less);
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		if (!equal(a[i].indices, a[i].indices + 3, b[i].indices))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool MeshOptimizer::OptimizeMesh(Mesh* mesh, bool reorderVertices, Statistics& before, Statistics& after)
+{
+	size_t vertexCount = mesh->vertices.size();
+	vector<XMFLOAT3> positions(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		const XMFLOAT4& pos = mesh->vertices[v].pos;
+		positions[v] = XMFLOAT3(pos.x, pos.y, pos.z);
+	}
+
+	vector<vector<uint32_t>> original(mesh->subsets.size()), optimized(mesh->subsets.size());
+	Statistics beforeMesh = { 0, 0, 0, 0, 0 }, afterMesh = { 0, 0, 0, 0, 0 };
+	for (size_t s = 0; s < mesh->subsets.size(); ++s)
+	{
+		original[s].assign(mesh->subsets[s].subsetIndices.begin(), mesh->subsets[s].subsetIndices.end());
+		beforeMesh.Add(AnalyzeVertexCache(original[s], vertexCount));
+		optimized[s] = original[s];
+		OptimizeVertexCache(optimized[s], vertexCount);
+		OptimizeOverdraw(optimized[s], positions.data(), vertexCount);
+	}
+	vector<uint32_t> remap;
+	if (reorderVertices)
+	{
+		vector<vector<uint32_t>*> lists;
+		for (auto& x : optimized)
+		{
+			lists.push_back(&x);
+		}
+		remap = OptimizeVertexFetch(lists, vertexCount);
+	}
+
+	for (size_t s = 0; s < mesh->subsets.size(); ++s)
+	{
+		if (!IsSameTopology(original[s], optimized[s], remap))
+		{
+			return false;
+		}
+		afterMesh.Add(AnalyzeVertexCache(optimized[s], vertexCount));
+	}
+
+	for (size_t s = 0; s < mesh->subsets.size(); ++s)
+	{
+		mesh->subsets[s].subsetIndices.assign(optimized[s].begin(), optimized[s].end());
+	}
+	if (reorderVertices)
+	{
+		auto vertices = mesh->vertices;
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			mesh->vertices[remap[v]] = vertices[v];
+		}
+	}
+	before.Add(beforeMesh);
+	after.Add(afterMesh);
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include <vector>
+#include <cstdint>
+
+struct Mesh;
+
+// Reorders the triangles and vertices of a mesh for the GPU, the triangles themselves don't change
+//	Vertex cache: Forsyth's linear speed ordering, so the triangles reuse the vertices that were just
+//	transformed. Overdraw: the cache ordered triangles are cut into clusters where the cache starts over,
+//	and the clusters are sorted so the outward facing ones come first (they occlude the rest), as long as
+//	the cache efficiency stays within the threshold. Vertex fetch: the vertices are renumbered in the
+//	order they are first used. Every function works on one index list (one subset, one draw).
+class MeshOptimizer
+{
+public:
+	struct Statistics
+	{
+		float acmr;		// average cache miss ratio: transformed vertices per triangle
+		float atvr;		// average transformed vertex ratio: transformed vertices per used vertex, 1 is the best
+		size_t transformedCount, triangleCount, usedVertexCount;	// so that lists can be summed up
+
+		void Add(const Statistics& other);
+	};
+
+	// FIFO cache of the given size, close to what the GPUs do
+	static Statistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+	// The indices should come from OptimizeVertexCache(). threshold is the ACMR that may be given up
+	//	for less overdraw, relative to the input (1.05 allows 5% more cache misses).
+	static void OptimizeOverdraw(std::vector<uint32_t>& indices, const DirectX::XMFLOAT3* positions, size_t vertexCount, float threshold = 1.05f);
+
+	// Renumbers the vertices of every list in the order of their first use, the unused ones go to the
+	//	end. Returns the remap: old vertex index -> new vertex index. The vertices have to be moved by
+	//	the caller (new[remap[i]] = old[i]).
+	static std::vector<uint32_t> OptimizeVertexFetch(std::vector<std::vector<uint32_t>*>& lists, size_t vertexCount);
+
+	// True if the lists have the same triangles with the same winding, in any order, after the vertices
+	//	of the first one are renumbered with remap (empty: no renumbering)
+	static bool IsSameTopology(const std::vector<uint32_t>& before, const std::vector<uint32_t>& after, const std::vector<uint32_t>& remap);
+
+	// The whole pass on every subset of the mesh. The vertices are only reordered if asked, because their
+	//	GPU buffers can't be updated from here. The result is checked with IsSameTopology(), the mesh is
+	//	left alone (and false is returned) if it fails.
+	static bool OptimizeMesh(Mesh* mesh, bool reorderVertices, Statistics& before, Statistics& after);
+};
+
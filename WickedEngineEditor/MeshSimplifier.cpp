@@ -0,0 +1,369 @@
+#include "stdafx.h"
+#include "MeshSimplifier.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+
+using namespace std;
+using namespace DirectX;
+
+namespace
+{
+	// Symmetric 4x4 matrix of the plane equations, in double because the sums of many small planes
+	//	cancel out badly in float
+	struct Quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double weight;
+
+		void AddPlane(double a, double b, double c, double d, double w)
+		{
+			a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+			b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+			c2 += w * c * c; cd += w * c * d;
+			d2 += w * d * d;
+			weight += w;
+		}
+		void Add(const Quadric& q)
+		{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+			b2 += q.b2; bc += q.bc; bd += q.bd;
+			c2 += q.c2; cd += q.cd;
+			d2 += q.d2;
+			weight += q.weight;
+		}
+		// Weighted sum of the squared distances to the planes
+		double Evaluate(const XMFLOAT3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double result =
+				a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+				b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+				c2 * z * z + 2 * cd * z +
+				d2;
+			return max(result, 0.0);
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from, to;
+		float cost;	// squared distance
+	};
+
+	XMFLOAT3 Cross(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		XMFLOAT3 e0(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+		XMFLOAT3 e1(p2.x - p0.x, p2.y - p0.y, p2.z - p0.z);
+		return XMFLOAT3(e0.y * e1.z - e0.z * e1.y, e0.z * e1.x - e0.x * e1.z, e0.x * e1.y - e0.y * e1.x);
+	}
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	uint64_t EdgeKey(uint32_t a, uint32_t b)
+	{
+		return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+	}
+}
+
+
+float MeshSimplifier::Simplify(const XMFLOAT3* positions, size_t vertexCount, const SubsetIndices& subsets,
+	size_t targetTriangles, float maxError, SubsetIndices& result)
+{
+	// All subsets in one list, every triangle remembers where it came from
+	vector<uint32_t> indices;
+	vector<uint32_t> triangleSubsets;
+	for (size_t s = 0; s < subsets.size(); ++s)
+	{
+		for (size_t i = 0; i + 2 < subsets[s].size(); i += 3)
+		{
+			indices.push_back(subsets[s][i + 0]);
+			indices.push_back(subsets[s][i + 1]);
+			indices.push_back(subsets[s][i + 2]);
+			triangleSubsets.push_back((uint32_t)s);
+		}
+	}
+
+	// Locked vertices: seams, open borders and subset borders
+	vector<uint8_t> locked(vertexCount, 0);
+	{
+		unordered_map<uint64_t, uint32_t> firstAtPosition;
+		vector<uint8_t> used(vertexCount, 0);
+		for (auto& x : indices)
+		{
+			used[x] = 1;
+		}
+		for (uint32_t v = 0; v < (uint32_t)vertexCount; ++v)
+		{
+			if (!used[v])
+			{
+				continue;
+			}
+			uint32_t bits[3];
+			memcpy(bits, &positions[v], sizeof(bits));
+			uint64_t key = ((uint64_t)bits[0] * 73856093ull) ^ ((uint64_t)bits[1] * 19349663ull) ^ ((uint64_t)bits[2] * 83492791ull);
+			auto it = firstAtPosition.find(key);
+			if (it == firstAtPosition.end())
+			{
+				firstAtPosition[key] = v;
+			}
+			else if (memcmp(&positions[it->second], &positions[v], sizeof(XMFLOAT3)) == 0)
+			{
+				locked[it->second] = 1;
+				locked[v] = 1;
+			}
+		}
+
+		unordered_map<uint64_t, uint32_t> edgeUses;
+		vector<uint32_t> vertexSubsets(vertexCount, UINT32_MAX);
+		for (size_t t = 0; t < triangleSubsets.size(); ++t)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				uint32_t a = indices[t * 3 + e];
+				edgeUses[EdgeKey(a, indices[t * 3 + (e + 1) % 3])]++;
+				if (vertexSubsets[a] == UINT32_MAX)
+				{
+					vertexSubsets[a] = triangleSubsets[t];
+				}
+				else if (vertexSubsets[a] != triangleSubsets[t])
+				{
+					locked[a] = 1;
+				}
+			}
+		}
+		for (auto& x : edgeUses)
+		{
+			if (x.second == 1)
+			{
+				locked[(uint32_t)(x.first >> 32)] = 1;
+				locked[(uint32_t)(x.first & 0xFFFFFFFF)] = 1;
+			}
+		}
+	}
+
+	// Area weighted plane of every triangle to its corners
+	vector<Quadric> quadrics(vertexCount);
+	memset(quadrics.data(), 0, sizeof(Quadric) * quadrics.size());
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		const XMFLOAT3& p0 = positions[indices[i + 0]];
+		XMFLOAT3 n = Cross(p0, positions[indices[i + 1]], positions[indices[i + 2]]);
+		float length = sqrtf(Dot(n, n));
+		if (length <= 0)
+		{
+			continue;
+		}
+		double a = n.x / length, b = n.y / length, c = n.z / length;
+		double d = -(a * p0.x + b * p0.y + c * p0.z);
+		double area = length * 0.5;
+		for (int k = 0; k < 3; ++k)
+		{
+			quadrics[indices[i + k]].AddPlane(a, b, c, d, area);
+		}
+	}
+
+	vector<uint32_t> remap(vertexCount);
+	vector<uint8_t> touched(vertexCount);
+	vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	vector<uint32_t> adjacency;
+	vector<Collapse> collapses;
+	float maxCost = maxError < FLT_MAX ? maxError * maxError : FLT_MAX;
+	float resultCost = 0;
+
+	// Every pass collapses the cheapest edges that don't touch each other, then the triangles are rebuilt
+	while (indices.size() / 3 > targetTriangles)
+	{
+		size_t triangleCount = indices.size() / 3;
+
+		fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (auto& x : indices)
+		{
+			adjacencyOffsets[x + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		}
+		adjacency.resize(indices.size());
+		vector<uint32_t> fillCounts(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency[fillCounts[indices[i]]++] = (uint32_t)(i / 3);
+		}
+
+		// The cheaper direction of every edge
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int e = 0; e < 3; ++e)
+			{
+				uint32_t a = indices[i + e], b = indices[i + (e + 1) % 3];
+				// every inner edge is seen from both triangles, only one of them adds it
+				if (a > b || (locked[a] && locked[b]))
+				{
+					continue;
+				}
+				Quadric q = quadrics[a];
+				q.Add(quadrics[b]);
+				double weight = max(q.weight, 1e-20);
+				Collapse collapse = { 0, 0, FLT_MAX };
+				if (!locked[a])
+				{
+					collapse.from = a;
+					collapse.to = b;
+					collapse.cost = (float)(q.Evaluate(positions[b]) / weight);
+				}
+				if (!locked[b])
+				{
+					float cost = (float)(q.Evaluate(positions[a]) / weight);
+					if (cost < collapse.cost)
+					{
+						collapse.from = b;
+						collapse.to = a;
+						collapse.cost = cost;
+					}
+				}
+				if (collapse.cost <= maxCost)
+				{
+					collapses.push_back(collapse);
+				}
+			}
+		}
+		if (collapses.empty())
+		{
+			break;
+		}
+		sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			remap[v] = (uint32_t)v;
+		}
+		fill(touched.begin(), touched.end(), 0);
+
+		// A collapse removes about two triangles, the rest of the goal is left for the next pass
+		size_t goal = (triangleCount - targetTriangles + 1) / 2;
+		size_t collapsed = 0;
+		for (auto& x : collapses)
+		{
+			if (collapsed >= goal)
+			{
+				break;
+			}
+			if (touched[x.from] || touched[x.to])
+			{
+				continue;
+			}
+
+			// The triangles around the removed vertex must not flip or fold onto themselves
+			bool valid = true;
+			for (uint32_t k = adjacencyOffsets[x.from]; k < adjacencyOffsets[x.from + 1] && valid; ++k)
+			{
+				const uint32_t* t = &indices[adjacency[k] * 3];
+				if (t[0] == x.to || t[1] == x.to || t[2] == x.to)
+				{
+					continue;
+				}
+				XMFLOAT3 before = Cross(positions[t[0]], positions[t[1]], positions[t[2]]);
+				XMFLOAT3 after = Cross(
+					positions[t[0] == x.from ? x.to : t[0]],
+					positions[t[1] == x.from ? x.to : t[1]],
+					positions[t[2] == x.from ? x.to : t[2]]);
+				float lengths = sqrtf(Dot(before, before) * Dot(after, after));
+				valid = lengths > 0 && Dot(before, after) > 0.25f * lengths;
+			}
+			if (!valid)
+			{
+				continue;
+			}
+
+			remap[x.from] = x.to;
+			quadrics[x.to].Add(quadrics[x.from]);
+			resultCost = max(resultCost, x.cost);
+			collapsed++;
+
+			// The neighbourhood stays as it is until the next pass, so the flip tests above see the real triangles
+			for (uint32_t k = adjacencyOffsets[x.from]; k < adjacencyOffsets[x.from + 1]; ++k)
+			{
+				const uint32_t* t = &indices[adjacency[k] * 3];
+				touched[t[0]] = 1;
+				touched[t[1]] = 1;
+				touched[t[2]] = 1;
+			}
+		}
+		if (collapsed == 0)
+		{
+			break;
+		}
+
+		size_t count = 0;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			uint32_t a = remap[indices[i + 0]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+			if (a == b || b == c || c == a)
+			{
+				continue;
+			}
+			triangleSubsets[count] = triangleSubsets[i / 3];
+			indices[count * 3 + 0] = a;
+			indices[count * 3 + 1] = b;
+			indices[count * 3 + 2] = c;
+			count++;
+		}
+		indices.resize(count * 3);
+		triangleSubsets.resize(count);
+	}
+
+	result.clear();
+	result.resize(subsets.size());
+	for (size_t t = 0; t < triangleSubsets.size(); ++t)
+	{
+		auto& x = result[triangleSubsets[t]];
+		x.push_back(indices[t * 3 + 0]);
+		x.push_back(indices[t * 3 + 1]);
+		x.push_back(indices[t * 3 + 2]);
+	}
+	return sqrtf(resultCost);
+}
+
+void MeshSimplifier::BuildChain(const XMFLOAT3* positions, size_t vertexCount, const SubsetIndices& subsets,
+	uint32_t levelCount, vector<Level>& levels)
+{
+	levels.clear();
+	Level full;
+	full.subsetIndices = subsets;
+	full.error = 0;
+	full.triangleCount = CountTriangles(subsets);
+	levels.push_back(full);
+
+	// Every level starts from the full detail, so the errors don't add up along the chain
+	while (levels.size() < levelCount)
+	{
+		size_t previous = levels.back().triangleCount;
+		Level level;
+		level.error = Simplify(positions, vertexCount, subsets, previous / 2, FLT_MAX, level.subsetIndices);
+		level.triangleCount = CountTriangles(level.subsetIndices);
+		if (level.triangleCount == 0 || level.triangleCount > previous * 9 / 10)
+		{
+			break;
+		}
+		level.error = max(level.error, levels.back().error);
+		levels.push_back(level);
+	}
+}
+
+size_t MeshSimplifier::CountTriangles(const SubsetIndices& subsets)
+{
+	size_t count = 0;
+	for (auto& x : subsets)
+	{
+		count += x.size() / 3;
+	}
+	return count;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include <vector>
+#include <cstdint>
+
+// Quadric error mesh simplification by edge collapses
+//	Only the indices change: a vertex collapses onto a neighbour that already exists, so the simplified
+//	triangles can be drawn with the vertex buffer of the original mesh. The subsets are simplified
+//	together, the vertices on subset borders, on open borders and on attribute seams (two vertices at the
+//	same position) are locked, so nothing cracks open.
+class MeshSimplifier
+{
+public:
+	typedef std::vector<std::vector<uint32_t>> SubsetIndices;
+
+	// Collapses edges until there are at most targetTriangles triangles left, or the next collapse would
+	//	move the surface more than maxError. Returns the error of the result: the largest collapse error,
+	//	as a distance in the units of the positions.
+	static float Simplify(const DirectX::XMFLOAT3* positions, size_t vertexCount, const SubsetIndices& subsets,
+		size_t targetTriangles, float maxError, SubsetIndices& result);
+
+	struct Level
+	{
+		SubsetIndices subsetIndices;
+		float error;
+		size_t triangleCount;
+	};
+	// Full detail as the first level, then every level has half the triangles of the one before. It stops
+	//	early when the simplifier can't remove enough triangles any more.
+	static void BuildChain(const DirectX::XMFLOAT3* positions, size_t vertexCount, const SubsetIndices& subsets,
+		uint32_t levelCount, std::vector<Level>& levels);
+
+	static size_t CountTriangles(const SubsetIndices& subsets);
+};
+
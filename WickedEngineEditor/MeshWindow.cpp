@@ -1,8 +1,19 @@
 #include "stdafx.h"
 #include "MeshWindow.h"
+#include "BakeCache.h"
+#include "MeshLODs.h"
+#include "MeshOptimizer.h"
+#include "SceneSnapshot.h"
 
+#include <sstream>
+#include <chrono>
 
-MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui)
+using namespace std;
+
+extern SceneWriter sceneWriter;
+
+
+MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui), locked(false), lodLevels(4)
 {
 	assert(GUI && "Invalid GUI!");
 
@@ -11,7 +22,7 @@ MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui)
 
 
 	meshWindow = new wiWindow(GUI, "Mesh Window");
-	meshWindow->SetSize(XMFLOAT2(400, 300));
+	meshWindow->SetSize(XMFLOAT2(400, 520));
 	meshWindow->SetEnabled(false);
 	GUI->AddWidget(meshWindow);
 
@@ -56,11 +67,46 @@ MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui)
 	impostorCreateButton->OnClick([&](wiEventArgs args) {
 		if (mesh != nullptr)
 		{
+			uint64_t key = BakeCache::GetInstance()->GetImpostorKey(mesh);
+			if (BakeCache::GetInstance()->IsUpToDate(mesh, key))
+			{
+				wiBackLog::post("The impostor is up to date.");
+				return;
+			}
+			// Impostors are rendered from the full detail
+			MeshLODs::GetInstance()->RestoreFullDetail(mesh);
 			wiRenderer::CreateImpostor(mesh);
+			BakeCache::GetInstance()->SetBaked(mesh, key);
 		}
 	});
 	meshWindow->AddWidget(impostorCreateButton);
 
+	impostorRefreshButton = new wiButton("Refresh Stale Impostors");
+	impostorRefreshButton->SetSize(XMFLOAT2(240, 30));
+	impostorRefreshButton->SetPos(XMFLOAT2(x - 50, y += 30));
+	impostorRefreshButton->OnClick([&](wiEventArgs args) {
+		// Every impostor of the scene whose mesh or materials changed since it was made
+		BakeCache* cache = BakeCache::GetInstance();
+		for (auto& x : wiRenderer::GetScene().models)
+		{
+			for (auto& y : x->meshes)
+			{
+				if (!cache->IsBaked(y.second))
+				{
+					continue;
+				}
+				uint64_t key = cache->GetImpostorKey(y.second);
+				if (!cache->IsUpToDate(y.second, key))
+				{
+					MeshLODs::GetInstance()->RestoreFullDetail(y.second);
+					wiRenderer::CreateImpostor(y.second);
+					cache->SetBaked(y.second, key);
+				}
+			}
+		}
+	});
+	meshWindow->AddWidget(impostorRefreshButton);
+
 	impostorDistanceSlider = new wiSlider(0, 1000, 100, 10000, "Impostor Distance: ");
 	impostorDistanceSlider->SetSize(XMFLOAT2(100, 30));
 	impostorDistanceSlider->SetPos(XMFLOAT2(x, y += 30));
@@ -83,6 +129,74 @@ MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui)
 	});
 	meshWindow->AddWidget(tessellationFactorSlider);
 
+	lodLevelsSlider = new wiSlider(2, 5, (float)lodLevels, 3, "LOD Levels: ");
+	lodLevelsSlider->SetSize(XMFLOAT2(100, 30));
+	lodLevelsSlider->SetPos(XMFLOAT2(x, y += 30));
+	lodLevelsSlider->OnSlide([&](wiEventArgs args) {
+		lodLevels = (uint32_t)args.fValue;
+	});
+	meshWindow->AddWidget(lodLevelsSlider);
+
+	lodGenerateButton = new wiButton("Generate LODs");
+	lodGenerateButton->SetSize(XMFLOAT2(240, 30));
+	lodGenerateButton->SetPos(XMFLOAT2(x - 50, y += 30));
+	lodGenerateButton->OnClick([&](wiEventArgs args) {
+		if (mesh != nullptr)
+		{
+			GenerateLODs(vector<Mesh*>(1, mesh));
+		}
+	});
+	meshWindow->AddWidget(lodGenerateButton);
+
+	lodGenerateAllButton = new wiButton("Generate LODs For All");
+	lodGenerateAllButton->SetSize(XMFLOAT2(240, 30));
+	lodGenerateAllButton->SetPos(XMFLOAT2(x - 50, y += 30));
+	lodGenerateAllButton->OnClick([&](wiEventArgs args) {
+		vector<Mesh*> meshes;
+		for (auto& x : wiRenderer::GetScene().models)
+		{
+			for (auto& y : x->meshes)
+			{
+				meshes.push_back(y.second);
+			}
+		}
+		GenerateLODs(meshes);
+	});
+	meshWindow->AddWidget(lodGenerateAllButton);
+
+	optimizeButton = new wiButton("Optimize");
+	optimizeButton->SetSize(XMFLOAT2(240, 30));
+	optimizeButton->SetPos(XMFLOAT2(x - 50, y += 30));
+	optimizeButton->OnClick([&](wiEventArgs args) {
+		if (mesh != nullptr)
+		{
+			OptimizeMeshes(vector<Mesh*>(1, mesh));
+		}
+	});
+	meshWindow->AddWidget(optimizeButton);
+
+	optimizeAllButton = new wiButton("Optimize All");
+	optimizeAllButton->SetSize(XMFLOAT2(240, 30));
+	optimizeAllButton->SetPos(XMFLOAT2(x - 50, y += 30));
+	optimizeAllButton->OnClick([&](wiEventArgs args) {
+		vector<Mesh*> meshes;
+		for (auto& x : wiRenderer::GetScene().models)
+		{
+			for (auto& y : x->meshes)
+			{
+				meshes.push_back(y.second);
+			}
+		}
+		OptimizeMeshes(meshes);
+	});
+	meshWindow->AddWidget(optimizeAllButton);
+
+	lodLabel = new wiLabel("LODInfo");
+	lodLabel->SetPos(XMFLOAT2(x - 150, y += 40));
+	lodLabel->SetSize(XMFLOAT2(340, 20));
+	lodLabel->SetText("");
+	meshWindow->AddWidget(lodLabel);
+
 
 
 
@@ -98,8 +212,15 @@ MeshWindow::~MeshWindow()
 	SAFE_DELETE(massSlider);
 	SAFE_DELETE(frictionSlider);
 	SAFE_DELETE(impostorCreateButton);
+	SAFE_DELETE(impostorRefreshButton);
 	SAFE_DELETE(impostorDistanceSlider);
 	SAFE_DELETE(tessellationFactorSlider);
+	SAFE_DELETE(lodLevelsSlider);
+	SAFE_DELETE(lodGenerateButton);
+	SAFE_DELETE(lodGenerateAllButton);
+	SAFE_DELETE(optimizeButton);
+	SAFE_DELETE(optimizeAllButton);
+	SAFE_DELETE(lodLabel);
 }
 
 void MeshWindow::SetMesh(Mesh* mesh)
@@ -112,10 +233,125 @@ void MeshWindow::SetMesh(Mesh* mesh)
 		frictionSlider->SetValue(mesh->friction);
 		impostorDistanceSlider->SetValue(mesh->impostorDistance);
 		tessellationFactorSlider->SetValue(mesh->getTessellationFactor());
-		meshWindow->SetEnabled(true);
+		UpdateLODLabel();
+		meshWindow->SetEnabled(!locked);
 	}
 	else
 	{
 		meshWindow->SetEnabled(false);
 	}
 }
+void MeshWindow::SetLocked(bool value)
+{
+	if (locked == value)
+	{
+		return;
+	}
+	locked = value;
+	meshWindow->SetEnabled(!locked && mesh != nullptr);
+}
+
+void MeshWindow::GenerateLODs(const vector<Mesh*>& meshes)
+{
+	auto start = chrono::steady_clock::now();
+	// Setting the chains rewrites the indices, the writer must not be reading them
+	sceneWriter.Wait();
+	// The chains are made from the full detail
+	for (auto& x : meshes)
+	{
+		MeshLODs::GetInstance()->RestoreFullDetail(x);
+	}
+	vector<MeshLODs::Chain> chains;
+	MeshLODs::BuildChains(meshes, lodLevels, 0, chains);
+
+	size_t triangles = 0, lodTriangles = 0;
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		const auto& levels = chains[i].levels;
+		triangles += levels[0].triangleCount;
+		if (levels.size() > 1)
+		{
+			MeshLODs::GetInstance()->Set(meshes[i], chains[i]);
+			lodTriangles += levels[1].triangleCount;
+		}
+		else
+		{
+			MeshLODs::GetInstance()->Forget(meshes[i]);
+		}
+	}
+
+	stringstream ss("");
+	ss << "LODs of " << meshes.size() << " meshes generated in " << chrono::duration<float>(chrono::steady_clock::now() - start).count()
+		<< "s, " << triangles << " triangles, " << lodTriangles << " in the first LOD";
+	wiBackLog::post(ss.str().c_str());
+	UpdateLODLabel();
+}
+
+void MeshWindow::OptimizeMeshes(const vector<Mesh*>& meshes)
+{
+	auto start = chrono::steady_clock::now();
+	MeshOptimizer::Statistics before = { 0, 0, 0, 0, 0 }, after = { 0, 0, 0, 0, 0 };
+	size_t failed = 0;
+	// The indices are rewritten, the writer must not be reading them
+	sceneWriter.Wait();
+	for (auto& x : meshes)
+	{
+		MeshLODs* lods = MeshLODs::GetInstance();
+		lods->RestoreFullDetail(x);
+		// The vertex buffers belong to the engine, only the triangle order changes here
+		if (!MeshOptimizer::OptimizeMesh(x, false, before, after))
+		{
+			failed++;
+			continue;
+		}
+		MeshLODs::UploadIndices(x);
+		BakeCache::GetInstance()->InvalidateGeometry(x);
+
+		// The LODs get the same vertex cache order, their triangles are on the same vertices
+		const MeshLODs::Chain* chain = lods->Get(x);
+		if (chain != nullptr)
+		{
+			MeshLODs::Chain reordered = *chain;
+			for (size_t s = 0; s < x->subsets.size(); ++s)
+			{
+				reordered.levels[0].subsetIndices[s].assign(x->subsets[s].subsetIndices.begin(), x->subsets[s].subsetIndices.end());
+			}
+			for (size_t l = 1; l < reordered.levels.size(); ++l)
+			{
+				for (auto& y : reordered.levels[l].subsetIndices)
+				{
+					MeshOptimizer::OptimizeVertexCache(y, x->vertices.size());
+				}
+			}
+			reordered.geometryHash = MeshLODs::HashGeometry(x);
+			lods->Set(x, reordered);
+		}
+	}
+
+	stringstream ss("");
+	ss.precision(3);
+	ss << "Optimized " << meshes.size() - failed << " meshes in " << chrono::duration<float>(chrono::steady_clock::now() - start).count()
+		<< "s, ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr;
+	if (failed > 0)
+	{
+		ss << ", " << failed << " failed the topology check and were left alone";
+	}
+	wiBackLog::post(ss.str().c_str());
+}
+
+void MeshWindow::UpdateLODLabel()
+{
+	const MeshLODs::Chain* chain = mesh != nullptr ? MeshLODs::GetInstance()->Get(mesh) : nullptr;
+	if (chain == nullptr)
+	{
+		lodLabel->SetText("No LODs");
+		return;
+	}
+	stringstream ss("");
+	ss << "LOD triangles:";
+	for (auto& x : chain->levels)
+	{
+		ss << " " << x.triangleCount;
+	}
+	lodLabel->SetText(ss.str());
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <vector>
+#include <cstdint>
+
 struct Material;
 class wiGUI;
 class wiWindow;
@@ -19,15 +22,32 @@ public:
 	wiGUI* GUI;
 
 	void SetMesh(Mesh* mesh);
+	// A locked window takes no edits, while the scene writer is reading the meshes
+	void SetLocked(bool value);
 
 	Mesh* mesh;
+	bool locked;
+	uint32_t lodLevels;		// including the full detail
 
 	wiWindow*	meshWindow;
 	wiCheckBox* doubleSidedCheckBox;
 	wiSlider*	massSlider;
 	wiSlider*	frictionSlider;
 	wiButton*	impostorCreateButton;
+	wiButton*	impostorRefreshButton;
 	wiSlider*	impostorDistanceSlider;
 	wiSlider*	tessellationFactorSlider;
+	wiSlider*	lodLevelsSlider;
+	wiButton*	lodGenerateButton;
+	wiButton*	lodGenerateAllButton;
+	wiButton*	optimizeButton;
+	wiButton*	optimizeAllButton;
+	wiLabel*	lodLabel;
+
+	// Builds the LOD chains of the meshes with the levels of the slider
+	void GenerateLODs(const std::vector<Mesh*>& meshes);
+	void UpdateLODLabel();
+	// Vertex cache and overdraw ordering of the triangles, the results go to the backlog
+	void OptimizeMeshes(const std::vector<Mesh*>& meshes);
 };
 
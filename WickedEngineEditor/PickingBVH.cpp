@@ -0,0 +1,319 @@
+#include "stdafx.h"
+#include "PickingBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace std;
+using namespace DirectX;
+
+
+void PickingBVH::Build(const vector<Box>& boxes)
+{
+	Clear();
+	if (boxes.empty())
+	{
+		return;
+	}
+
+	items = boxes;
+	itemIndices.resize(items.size());
+	vector<XMFLOAT3> centers(items.size());
+	for (uint32_t i = 0; i < (uint32_t)items.size(); ++i)
+	{
+		itemIndices[i] = i;
+		XMStoreFloat3(&centers[i], (XMLoadFloat3(&items[i].min) + XMLoadFloat3(&items[i].max)) * 0.5f);
+	}
+
+	nodes.reserve(items.size() * 2);
+	Node root;
+	root.offset = 0;
+	root.count = (uint32_t)items.size();
+	nodes.push_back(root);
+	UpdateBox(nodes[0]);
+	Subdivide(0, centers);
+}
+bool PickingBVH::Refit(const vector<Box>& boxes)
+{
+	if (boxes.size() != items.size())
+	{
+		return false;
+	}
+	if (boxes.empty())
+	{
+		return true;
+	}
+
+	items = boxes;
+
+	// Children are always allocated after their parent, so a reverse pass is bottom-up
+	for (size_t i = nodes.size(); i > 0; --i)
+	{
+		Node& node = nodes[i - 1];
+		if (node.count > 0)
+		{
+			UpdateBox(node);
+		}
+		else
+		{
+			const Box& a = nodes[node.offset].box;
+			const Box& b = nodes[node.offset + 1].box;
+			XMStoreFloat3(&node.box.min, XMVectorMin(XMLoadFloat3(&a.min), XMLoadFloat3(&b.min)));
+			XMStoreFloat3(&node.box.max, XMVectorMax(XMLoadFloat3(&a.max), XMLoadFloat3(&b.max)));
+		}
+	}
+	return true;
+}
+void PickingBVH::Clear()
+{
+	nodes.clear();
+	itemIndices.clear();
+	items.clear();
+}
+
+void PickingBVH::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, vector<Hit>& hits) const
+{
+	hits.clear();
+	if (nodes.empty())
+	{
+		return;
+	}
+
+	XMVECTOR O = XMLoadFloat3(&origin);
+	XMVECTOR D = XMLoadFloat3(&direction);
+	// Division by zero gives infinities here, which the slab test handles correctly
+	XMVECTOR invD = XMVectorReciprocal(D);
+
+	auto intersects = [&](const Box& box, float& tmin) {
+		XMVECTOR t0 = (XMLoadFloat3(&box.min) - O) * invD;
+		XMVECTOR t1 = (XMLoadFloat3(&box.max) - O) * invD;
+		XMVECTOR tnear = XMVectorMin(t0, t1);
+		XMVECTOR tfar = XMVectorMax(t0, t1);
+		float enter = max(max(XMVectorGetX(tnear), XMVectorGetY(tnear)), XMVectorGetZ(tnear));
+		float exit = min(min(XMVectorGetX(tfar), XMVectorGetY(tfar)), XMVectorGetZ(tfar));
+		tmin = max(enter, 0.0f);
+		return exit >= tmin;
+	};
+
+	uint32_t stack[64];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+		float t;
+		if (!intersects(node.box, t))
+		{
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				uint32_t item = itemIndices[node.offset + i];
+				if (intersects(items[item], t))
+				{
+					Hit hit;
+					hit.item = item;
+					hit.distance = t;
+					hits.push_back(hit);
+				}
+			}
+		}
+		else if (stackSize + 2 <= _countof(stack))
+		{
+			stack[stackSize++] = node.offset;
+			stack[stackSize++] = node.offset + 1;
+		}
+	}
+
+	sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+		return a.distance < b.distance;
+	});
+}
+
+void PickingBVH::Query(const XMFLOAT4* planes, uint32_t planeCount, vector<uint32_t>& result) const
+{
+	result.clear();
+	if (nodes.empty() || planeCount == 0)
+	{
+		return;
+	}
+
+	XMVECTOR P[8];
+	XMVECTOR positive[8];
+	planeCount = min(planeCount, (uint32_t)_countof(P));
+	for (uint32_t i = 0; i < planeCount; ++i)
+	{
+		P[i] = XMLoadFloat4(&planes[i]);
+		positive[i] = XMVectorGreater(P[i], XMVectorZero());
+	}
+
+	enum { OUTSIDE, INTERSECTS, INSIDE };
+	auto classify = [&](const Box& box) {
+		XMVECTOR bmin = XMLoadFloat3(&box.min);
+		XMVECTOR bmax = XMLoadFloat3(&box.max);
+		int state = INSIDE;
+		for (uint32_t i = 0; i < planeCount; ++i)
+		{
+			// The corner furthest along the plane normal decides if the box is outside,
+			//	the opposite corner decides if it is completely inside
+			XMVECTOR pVertex = XMVectorSelect(bmin, bmax, positive[i]);
+			if (XMVectorGetX(XMPlaneDotCoord(P[i], pVertex)) < 0)
+			{
+				return (int)OUTSIDE;
+			}
+			XMVECTOR nVertex = XMVectorSelect(bmax, bmin, positive[i]);
+			if (XMVectorGetX(XMPlaneDotCoord(P[i], nVertex)) < 0)
+			{
+				state = INTERSECTS;
+			}
+		}
+		return state;
+	};
+
+	// Subtrees that are completely inside are collected without testing them any further
+	struct Entry
+	{
+		uint32_t node;
+		bool inside;
+	};
+	Entry stack[64];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, false };
+	while (stackSize > 0)
+	{
+		Entry entry = stack[--stackSize];
+		const Node& node = nodes[entry.node];
+		bool inside = entry.inside;
+		if (!inside)
+		{
+			int state = classify(node.box);
+			if (state == OUTSIDE)
+			{
+				continue;
+			}
+			inside = state == INSIDE;
+		}
+
+		if (node.count > 0)
+		{
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				uint32_t item = itemIndices[node.offset + i];
+				if (inside || classify(items[item]) != OUTSIDE)
+				{
+					result.push_back(item);
+				}
+			}
+		}
+		else if (stackSize + 2 <= _countof(stack))
+		{
+			stack[stackSize++] = { node.offset, inside };
+			stack[stackSize++] = { node.offset + 1, inside };
+		}
+	}
+}
+
+bool PickingBVH::IntersectTriangle(FXMVECTOR origin, FXMVECTOR direction, FXMVECTOR v0, GXMVECTOR v1, HXMVECTOR v2, float& distance)
+{
+	// Moller-Trumbore, both faces are hit
+	XMVECTOR e1 = v1 - v0;
+	XMVECTOR e2 = v2 - v0;
+	XMVECTOR p = XMVector3Cross(direction, e2);
+	float det = XMVectorGetX(XMVector3Dot(e1, p));
+	if (fabsf(det) < FLT_EPSILON)
+	{
+		return false;
+	}
+	float invDet = 1.0f / det;
+	XMVECTOR s = origin - v0;
+	float u = XMVectorGetX(XMVector3Dot(s, p)) * invDet;
+	if (u < 0 || u > 1)
+	{
+		return false;
+	}
+	XMVECTOR q = XMVector3Cross(s, e1);
+	float v = XMVectorGetX(XMVector3Dot(direction, q)) * invDet;
+	if (v < 0 || u + v > 1)
+	{
+		return false;
+	}
+	float t = XMVectorGetX(XMVector3Dot(e2, q)) * invDet;
+	if (t < 0)
+	{
+		return false;
+	}
+	distance = t;
+	return true;
+}
+
+
+void PickingBVH::Subdivide(uint32_t nodeIndex, vector<XMFLOAT3>& centers)
+{
+	// Median split on the widest axis of the item centers, nodes are referenced by index
+	//	because the node array grows during the recursion
+	uint32_t first = nodes[nodeIndex].offset;
+	uint32_t count = nodes[nodeIndex].count;
+	if (count <= leafSize)
+	{
+		return;
+	}
+
+	XMVECTOR cmin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR cmax = XMVectorReplicate(-FLT_MAX);
+	for (uint32_t i = first; i < first + count; ++i)
+	{
+		XMVECTOR c = XMLoadFloat3(&centers[itemIndices[i]]);
+		cmin = XMVectorMin(cmin, c);
+		cmax = XMVectorMax(cmax, c);
+	}
+	XMFLOAT3 extent;
+	XMStoreFloat3(&extent, cmax - cmin);
+	int axis = 0;
+	if (extent.y > extent.x)
+	{
+		axis = 1;
+	}
+	if (extent.z > (axis == 0 ? extent.x : extent.y))
+	{
+		axis = 2;
+	}
+
+	uint32_t half = count / 2;
+	nth_element(itemIndices.begin() + first, itemIndices.begin() + first + half, itemIndices.begin() + first + count,
+		[&](uint32_t a, uint32_t b) {
+		return (&centers[a].x)[axis] < (&centers[b].x)[axis];
+	});
+
+	uint32_t childIndex = (uint32_t)nodes.size();
+	Node left, right;
+	left.offset = first;
+	left.count = half;
+	right.offset = first + half;
+	right.count = count - half;
+	nodes.push_back(left);
+	nodes.push_back(right);
+	UpdateBox(nodes[childIndex]);
+	UpdateBox(nodes[childIndex + 1]);
+
+	nodes[nodeIndex].offset = childIndex;
+	nodes[nodeIndex].count = 0;
+
+	Subdivide(childIndex, centers);
+	Subdivide(childIndex + 1, centers);
+}
+void PickingBVH::UpdateBox(Node& node) const
+{
+	XMVECTOR bmin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR bmax = XMVectorReplicate(-FLT_MAX);
+	for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+	{
+		const Box& box = items[itemIndices[i]];
+		bmin = XMVectorMin(bmin, XMLoadFloat3(&box.min));
+		bmax = XMVectorMax(bmax, XMLoadFloat3(&box.max));
+	}
+	XMStoreFloat3(&node.box.min, bmin);
+	XMStoreFloat3(&node.box.max, bmax);
+}
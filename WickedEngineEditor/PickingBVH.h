@@ -0,0 +1,61 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include <vector>
+#include <cstdint>
+
+// Bounding volume hierarchy over axis aligned boxes for editor picking
+//	It only knows about boxes and item indices, so it can be built and queried without the engine.
+//	When only the boxes move, Refit() updates the hierarchy in place instead of rebuilding it.
+class PickingBVH
+{
+public:
+	struct Box
+	{
+		DirectX::XMFLOAT3 min;
+		DirectX::XMFLOAT3 max;
+	};
+	struct Hit
+	{
+		uint32_t item;
+		float distance; // where the ray enters the item's box
+	};
+
+private:
+	struct Node
+	{
+		Box box;
+		uint32_t offset;	// leaf: first item index, internal: first child node (the other one is next to it)
+		uint32_t count;		// zero for internal nodes
+	};
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> itemIndices;
+	std::vector<Box> items;
+
+	void Subdivide(uint32_t nodeIndex, std::vector<DirectX::XMFLOAT3>& centers);
+	void UpdateBox(Node& node) const;
+
+public:
+	// Leaf size of the hierarchy
+	static const uint32_t leafSize = 4;
+
+	void Build(const std::vector<Box>& boxes);
+	// Same items with updated boxes, returns false if the item count differs (Build() is needed then)
+	bool Refit(const std::vector<Box>& boxes);
+	void Clear();
+
+	size_t GetItemCount() const { return items.size(); }
+	const Box& GetItemBox(uint32_t item) const { return items[item]; }
+
+	// Collects every item whose box is hit by the ray, sorted by entry distance
+	void Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, std::vector<Hit>& hits) const;
+	// Collects every item whose box is inside or intersects a convex volume
+	//	The planes are (normal, distance) with the normals pointing inwards
+	void Query(const DirectX::XMFLOAT4* planes, uint32_t planeCount, std::vector<uint32_t>& result) const;
+
+	// Ray-triangle intersection for refining box hits
+	static bool IntersectTriangle(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction,
+		DirectX::FXMVECTOR v0, DirectX::GXMVECTOR v1, DirectX::HXMVECTOR v2, float& distance);
+};
+
@@ -0,0 +1,106 @@
+#include "stdafx.h"
+#include "ProbeBakeQueue.h"
+
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+using namespace DirectX;
+
+
+ProbeBakeQueue::ProbeBakeQueue() :secondsPerTexel(0), completed(0), total(0)
+{
+}
+
+float ProbeBakeQueue::EstimateCost(const Request& request) const
+{
+	return (float)(secondsPerTexel * 6.0 * request.resolution * request.resolution);
+}
+
+void ProbeBakeQueue::Push(const XMFLOAT3& position, int resolution)
+{
+	Request request;
+	request.position = position;
+	request.resolution = resolution;
+	request.priority = PRIORITY_NEW;
+	request.replaces = nullptr;
+	newRequests.push_back(request);
+	total++;
+}
+void ProbeBakeQueue::PushStale(const XMFLOAT3& position, int resolution, void* replaces)
+{
+	for (auto& x : staleRequests)
+	{
+		if (x.replaces == replaces)
+		{
+			x.resolution = resolution;
+			return;
+		}
+	}
+	Request request;
+	request.position = position;
+	request.resolution = resolution;
+	request.priority = PRIORITY_STALE;
+	request.replaces = replaces;
+	staleRequests.push_back(request);
+	total++;
+}
+void ProbeBakeQueue::Clear()
+{
+	newRequests.clear();
+	staleRequests.clear();
+	completed = 0;
+	total = 0;
+}
+void ProbeBakeQueue::Forget(void* probe)
+{
+	auto it = remove_if(staleRequests.begin(), staleRequests.end(), [=](const Request& x) { return x.replaces == probe; });
+	total -= (uint32_t)distance(it, staleRequests.end());
+	staleRequests.erase(it, staleRequests.end());
+}
+
+uint32_t ProbeBakeQueue::Update(float budget)
+{
+	if (IsEmpty() || bake == nullptr)
+	{
+		return 0;
+	}
+
+	auto start = chrono::steady_clock::now();
+	uint32_t baked = 0;
+	while (!IsEmpty())
+	{
+		deque<Request>& queue = newRequests.empty() ? staleRequests : newRequests;
+		const Request& request = queue.front();
+
+		float spent = chrono::duration<float>(chrono::steady_clock::now() - start).count();
+		// The first bake of a frame always runs, so a probe that is too big for the budget still gets baked
+		if (baked > 0 && spent + EstimateCost(request) > budget)
+		{
+			break;
+		}
+
+		Request current = request;
+		queue.pop_front();
+		auto bakeStart = chrono::steady_clock::now();
+		bool done = bake(current);
+		completed++;
+		if (!done)
+		{
+			continue;
+		}
+		baked++;
+
+		// Moving average, so a slow first bake (shader compilation, resource creation) is forgotten soon
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - bakeStart).count();
+		double texels = 6.0 * current.resolution * current.resolution;
+		secondsPerTexel = secondsPerTexel == 0 ? seconds / texels : secondsPerTexel * 0.75 + seconds / texels * 0.25;
+	}
+
+	if (IsEmpty())
+	{
+		completed = 0;
+		total = 0;
+	}
+	return baked;
+}
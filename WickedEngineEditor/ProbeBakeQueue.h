@@ -0,0 +1,61 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include <deque>
+#include <functional>
+#include <cstdint>
+
+// Environment probe bakes spread over frames
+//	Every bake renders a whole cubemap, so the queue can't split one, but it only starts as many bakes
+//	in a frame as the time budget allows. The cost of a bake is estimated from the previous ones, per
+//	cube face texel. A bake that doesn't fit any budget is started alone, at the beginning of a frame.
+//	The renderer is reached only through the bake function, so the scheduling works without one.
+class ProbeBakeQueue
+{
+public:
+	enum Priority
+	{
+		PRIORITY_NEW,	// probes that were just placed
+		PRIORITY_STALE,	// rebakes of existing probes, after every new one
+	};
+	struct Request
+	{
+		DirectX::XMFLOAT3 position;
+		int resolution;
+		Priority priority;
+		void* replaces;	// the probe that this bake supersedes, nullptr for new probes
+	};
+	// Bakes the request, returns false if it was skipped (the probe to replace is gone)
+	typedef std::function<bool(const Request&)> BakeFunction;
+
+private:
+	std::deque<Request> newRequests, staleRequests;
+	BakeFunction bake;
+	double secondsPerTexel;
+	uint32_t completed, total;
+
+	float EstimateCost(const Request& request) const;
+
+public:
+	ProbeBakeQueue();
+
+	void SetBakeFunction(const BakeFunction& value) { bake = value; }
+
+	void Push(const DirectX::XMFLOAT3& position, int resolution);
+	// Ignored if a rebake of the same probe is already waiting
+	void PushStale(const DirectX::XMFLOAT3& position, int resolution, void* replaces);
+	// Drops every request, for example when the scene is cleared
+	void Clear();
+	// Forgets a probe that was removed from the scene before its rebake
+	void Forget(void* probe);
+
+	// Bakes while the estimated cost fits the budget (seconds). Returns the number of probes baked.
+	uint32_t Update(float budget);
+
+	bool IsEmpty() const { return newRequests.empty() && staleRequests.empty(); }
+	size_t GetPendingCount() const { return newRequests.size() + staleRequests.size(); }
+	// Progress of the current batch: the counts restart when the queue runs empty
+	uint32_t GetCompletedCount() const { return completed; }
+	uint32_t GetTotalCount() const { return total; }
+};
+
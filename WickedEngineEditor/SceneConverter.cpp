@@ -0,0 +1,621 @@
+#include "stdafx.h"
+#include "SceneConverter.h"
+
+#include "ScenePackage.h"
+#include "MeshLODs.h"
+
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdio>
+#include <cfloat>
+
+using namespace std;
+
+extern int __editorVersion;
+
+namespace
+{
+	size_t GetFileSize(const string& fileName)
+	{
+		ifstream file(fileName, ios::binary | ios::ate);
+		if (!file.is_open())
+		{
+			return 0;
+		}
+		return (size_t)file.tellg();
+	}
+
+	bool HasExtension(const string& fileName, const string& extension)
+	{
+		if (fileName.length() < extension.length())
+		{
+			return false;
+		}
+		string ext = fileName.substr(fileName.length() - extension.length());
+		transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+		return ext == extension;
+	}
+
+	// Expands the directories among the inputs
+	void CollectFiles(const vector<string>& inputs, const string& extension, vector<string>& files)
+	{
+		for (auto& x : inputs)
+		{
+			DWORD attributes = GetFileAttributesA(x.c_str());
+			if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+			{
+				files.push_back(x);
+				continue;
+			}
+
+			string directory = x;
+			if (directory.back() != '/' && directory.back() != '\\')
+			{
+				directory += "/";
+			}
+			WIN32_FIND_DATAA data;
+			HANDLE handle = FindFirstFileA((directory + "*" + extension).c_str(), &data);
+			if (handle == INVALID_HANDLE_VALUE)
+			{
+				continue;
+			}
+			do
+			{
+				if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+				{
+					files.push_back(directory + data.cFileName);
+				}
+			} while (FindNextFileA(handle, &data));
+			FindClose(handle);
+		}
+		sort(files.begin(), files.end());
+	}
+
+	// Everything that ends up in the shaders, the name is left out
+	// Everything the material saves except its name, so two materials only count as equal if they would
+	//	be saved the same, whatever fields the engine adds to them later
+	bool ArchiveMaterial(Material* material, vector<uint8_t>& data)
+	{
+		string tempFileName = ScenePackage::MakeTempFileName("material");
+		string name = material->name;
+		material->name.clear();
+		bool opened;
+		{
+			wiArchive archive(tempFileName, false);
+			opened = archive.IsOpen();
+			if (opened)
+			{
+				material->Serialize(archive);
+			}
+		}
+		material->name = name;
+
+		bool succeeded = false;
+		if (opened)
+		{
+			ifstream file(tempFileName, ios::binary);
+			data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+			succeeded = !data.empty();
+		}
+		remove(tempFileName.c_str());
+		return succeeded;
+	}
+
+	float Seconds(chrono::steady_clock::time_point start)
+	{
+		return chrono::duration<float>(chrono::steady_clock::now() - start).count();
+	}
+
+	// Every model of a scene package, or the model of a plain archive. Returns an error message.
+	string LoadModels(const string& fileName, vector<Model*>& models, SceneConverter::Result& result)
+	{
+		ScenePackage::Reader reader;
+		if (reader.Open(fileName, __editorVersion))
+		{
+			// Every chunk has to pass its hash check and deserialize
+			result.chunkCount = reader.GetChunkCount();
+			for (uint32_t i = 0; i < reader.GetChunkCount(); ++i)
+			{
+				stringstream ss("");
+				ss << "chunk " << i << " is corrupted";
+				if (reader.GetChunk(i).type == ScenePackage::CHUNK_LODS)
+				{
+					vector<uint8_t> data;
+					vector<MeshLODs::Chain> chains;
+					if (!reader.ReadChunk(i, data) || !MeshLODs::ReadChains(data.data(), data.size(), chains))
+					{
+						return ss.str();
+					}
+					continue;
+				}
+				Model* model = reader.LoadChunk(i);
+				if (model == nullptr)
+				{
+					return ss.str();
+				}
+				models.push_back(model);
+			}
+			return "";
+		}
+		if (ScenePackage::IsPackage(fileName))
+		{
+			return "the table of contents is invalid";
+		}
+
+		// Plain model archive
+		wiArchive archive(fileName, true);
+		if (!archive.IsOpen())
+		{
+			return "could not open the archive";
+		}
+		Model* model = new Model;
+		model->Serialize(archive);
+		models.push_back(model);
+		return "";
+	}
+
+	void CountModel(Model* model, SceneConverter::Result& result)
+	{
+		result.objectCount += model->objects.size();
+		result.meshCount += model->meshes.size();
+		result.materialCount += model->materials.size();
+		for (auto& x : model->meshes)
+		{
+			result.vertexCount += x.second->vertices.size();
+		}
+	}
+}
+
+
+SceneConverter::Result::Result() :succeeded(false), inputSize(0), outputSize(0), loadTime(0), processTime(0), writeTime(0),
+	objectCount(0), meshCount(0), vertexCount(0), materialCount(0), mergedMaterialCount(0), chunkCount(0),
+	triangleCount(0), lodTriangleCount(0), lodMaxError(0), lodMeanError(0)
+{
+	MeshOptimizer::Statistics zero = { 0, 0, 0, 0, 0 };
+	cacheBefore = zero;
+	cacheAfter = zero;
+}
+
+bool SceneConverter::ParseArguments(const vector<string>& arguments, Options& options)
+{
+	for (size_t i = 0; i < arguments.size(); ++i)
+	{
+		const string& x = arguments[i];
+		if (x == "-convert")
+		{
+			options.mode = MODE_CONVERT;
+		}
+		else if (x == "-validate")
+		{
+			options.mode = MODE_VALIDATE;
+		}
+		else if (x == "-lodbench")
+		{
+			options.mode = MODE_LODBENCH;
+		}
+		else if (x == "-out" && i + 1 < arguments.size())
+		{
+			options.outputDirectory = arguments[++i];
+		}
+		else if (x == "-threads" && i + 1 < arguments.size())
+		{
+			options.threadCount = (uint32_t)max(0, atoi(arguments[++i].c_str()));
+		}
+		else if (x == "-dedup")
+		{
+			options.deduplicateMaterials = true;
+		}
+		else if (x == "-optimize")
+		{
+			options.optimizeMeshes = true;
+		}
+		else if (x == "-lods")
+		{
+			options.buildLODs = true;
+		}
+		else if (x == "-levels" && i + 1 < arguments.size())
+		{
+			options.lodLevels = (uint32_t)max(2, atoi(arguments[++i].c_str()));
+		}
+		else
+		{
+			options.inputs.push_back(x);
+		}
+	}
+	return options.mode != MODE_NONE;
+}
+
+int SceneConverter::Run(const Options& options)
+{
+	vector<string> files;
+	CollectFiles(options.inputs, options.mode == MODE_CONVERT ? ".wio" : ".wimf", files);
+	if (files.empty())
+	{
+		printf("Nothing to do, no input files were found.\n");
+		return 1;
+	}
+	if (!options.outputDirectory.empty())
+	{
+		CreateDirectoryA(options.outputDirectory.c_str(), nullptr);
+	}
+
+	// Every file is independent, the workers take the next one until there are none left
+	auto start = chrono::steady_clock::now();
+	vector<Result> results(files.size());
+	atomic<size_t> next(0);
+	auto work = [&] {
+		size_t i;
+		while ((i = next.fetch_add(1)) < files.size())
+		{
+			switch (options.mode)
+			{
+			case MODE_CONVERT:
+				results[i] = Convert(files[i], options);
+				break;
+			case MODE_LODBENCH:
+				results[i] = BenchmarkLODs(files[i], options);
+				break;
+			default:
+				results[i] = Validate(files[i]);
+				break;
+			}
+		}
+	};
+	uint32_t threadCount = options.threadCount > 0 ? options.threadCount : max(1u, thread::hardware_concurrency());
+	// The benchmark keeps the pool for the meshes of one file
+	size_t workerCount = options.mode == MODE_LODBENCH ? 1 : min((size_t)threadCount, files.size());
+	vector<thread> workers;
+	for (size_t i = 1; i < workerCount; ++i)
+	{
+		workers.push_back(thread(work));
+	}
+	work();
+	for (auto& x : workers)
+	{
+		x.join();
+	}
+	float totalTime = Seconds(start);
+
+	size_t failed = 0;
+	size_t inputSize = 0, outputSize = 0, mergedMaterials = 0;
+	for (auto& x : results)
+	{
+		if (x.succeeded && options.mode == MODE_LODBENCH)
+		{
+			printf("OK    %s  meshes %zu  triangles %zu  lod triangles %zu  simplify %.3fs  %.0f triangles/s  error max %.4f%%  mean %.4f%%\n",
+				x.fileName.c_str(), x.meshCount, x.triangleCount, x.lodTriangleCount, x.processTime,
+				x.processTime > 0 ? x.triangleCount / x.processTime : 0.0f, x.lodMaxError * 100, x.lodMeanError * 100);
+		}
+		else if (x.succeeded)
+		{
+			printf("OK    %s  in %zu KB  out %zu KB  load %.3fs  process %.3fs  write %.3fs  objects %zu  meshes %zu  vertices %zu  materials %zu (-%zu)  chunks %u\n",
+				x.fileName.c_str(), x.inputSize / 1024, x.outputSize / 1024, x.loadTime, x.processTime, x.writeTime,
+				x.objectCount, x.meshCount, x.vertexCount, x.materialCount, x.mergedMaterialCount, x.chunkCount);
+			if (options.optimizeMeshes)
+			{
+				printf("      ACMR %.3f -> %.3f  ATVR %.3f -> %.3f\n", x.cacheBefore.acmr, x.cacheAfter.acmr, x.cacheBefore.atvr, x.cacheAfter.atvr);
+			}
+		}
+		else
+		{
+			printf("FAIL  %s  %s\n", x.fileName.c_str(), x.error.c_str());
+			failed++;
+		}
+		inputSize += x.inputSize;
+		outputSize += x.outputSize;
+		mergedMaterials += x.mergedMaterialCount;
+	}
+	printf("%zu files, %zu failed, %.3fs on %zu threads, in %zu KB, out %zu KB, %zu materials merged\n",
+		results.size(), failed, totalTime, workerCount, inputSize / 1024, outputSize / 1024, mergedMaterials);
+	fflush(stdout);
+
+	return failed > 0 ? 1 : 0;
+}
+
+SceneConverter::Result SceneConverter::Convert(const string& fileName, const Options& options)
+{
+	Result result;
+	result.fileName = fileName;
+	result.inputSize = GetFileSize(fileName);
+
+	string dir, file;
+	wiHelper::SplitPath(fileName, dir, file);
+	file = file.substr(0, file.length() - 4);
+
+	auto start = chrono::steady_clock::now();
+	Model* model = new Model;
+	model->LoadFromDisk(dir, file, "common");
+	result.loadTime = Seconds(start);
+	if (model->objects.empty() && model->lights.empty() && model->decals.empty())
+	{
+		result.error = "the model is empty or could not be loaded";
+		SAFE_DELETE(model);
+		return result;
+	}
+
+	start = chrono::steady_clock::now();
+	if (options.deduplicateMaterials)
+	{
+		result.mergedMaterialCount = DeduplicateMaterials(model);
+	}
+	result.error = CheckModel(model);
+	CountModel(model, result);
+	if (options.optimizeMeshes && result.error.empty())
+	{
+		for (auto& x : model->meshes)
+		{
+			// Vertex groups reference the vertices by index, those meshes keep their vertex order
+			bool reorderVertices = x.second->vertexGroups.empty();
+			if (!MeshOptimizer::OptimizeMesh(x.second, reorderVertices, result.cacheBefore, result.cacheAfter))
+			{
+				result.error = "mesh " + x.first + " changed its triangles in the optimizer";
+				break;
+			}
+		}
+	}
+	vector<uint8_t> lodData;
+	if (options.buildLODs && result.error.empty())
+	{
+		// The files are already spread over the workers
+		vector<Mesh*> meshes;
+		for (auto& x : model->meshes)
+		{
+			meshes.push_back(x.second);
+		}
+		vector<MeshLODs::Chain> chains;
+		MeshLODs::BuildChains(meshes, options.lodLevels, 1, chains);
+		vector<const MeshLODs::Chain*> chainPointers;
+		for (auto& x : chains)
+		{
+			chainPointers.push_back(&x);
+		}
+		MeshLODs::WriteChains(chainPointers, lodData);
+	}
+	result.processTime = Seconds(start);
+	if (!result.error.empty())
+	{
+		SAFE_DELETE(model);
+		return result;
+	}
+
+	string outputDirectory = options.outputDirectory.empty() ? dir : options.outputDirectory;
+	if (!outputDirectory.empty() && outputDirectory.back() != '/' && outputDirectory.back() != '\\')
+	{
+		outputDirectory += "/";
+	}
+	string outputName = outputDirectory + file + ".wimf";
+	string tempName = outputName + ".tmp";
+
+	// Same as the editor's save: the complete file replaces the old one, a failed write leaves it alone
+	start = chrono::steady_clock::now();
+	bool written = ScenePackage::Write(model, tempName, __editorVersion, lodData) &&
+		MoveFileExA(tempName.c_str(), outputName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+	result.writeTime = Seconds(start);
+	SAFE_DELETE(model);
+	if (!written)
+	{
+		remove(tempName.c_str());
+		result.error = "could not write " + outputName;
+		return result;
+	}
+
+	result.outputSize = GetFileSize(outputName);
+	ScenePackage::Reader reader;
+	if (reader.Open(outputName, __editorVersion))
+	{
+		result.chunkCount = reader.GetChunkCount();
+	}
+	result.succeeded = true;
+	return result;
+}
+
+SceneConverter::Result SceneConverter::Validate(const string& fileName)
+{
+	Result result;
+	result.fileName = fileName;
+	result.inputSize = GetFileSize(fileName);
+
+	auto start = chrono::steady_clock::now();
+	vector<Model*> models;
+	result.error = LoadModels(fileName, models, result);
+	result.loadTime = Seconds(start);
+
+	start = chrono::steady_clock::now();
+	for (auto& x : models)
+	{
+		if (result.error.empty())
+		{
+			result.error = CheckModel(x);
+		}
+		CountModel(x, result);
+		SAFE_DELETE(x);
+	}
+	result.processTime = Seconds(start);
+
+	result.succeeded = result.error.empty();
+	return result;
+}
+
+SceneConverter::Result SceneConverter::BenchmarkLODs(const string& fileName, const Options& options)
+{
+	Result result;
+	result.fileName = fileName;
+	result.inputSize = GetFileSize(fileName);
+
+	auto start = chrono::steady_clock::now();
+	vector<Model*> models;
+	result.error = LoadModels(fileName, models, result);
+	result.loadTime = Seconds(start);
+
+	vector<Mesh*> meshes;
+	for (auto& x : models)
+	{
+		CountModel(x, result);
+		for (auto& y : x->meshes)
+		{
+			meshes.push_back(y.second);
+		}
+	}
+	if (result.error.empty() && meshes.empty())
+	{
+		result.error = "there are no meshes";
+	}
+
+	if (result.error.empty())
+	{
+		start = chrono::steady_clock::now();
+		vector<MeshLODs::Chain> chains;
+		MeshLODs::BuildChains(meshes, options.lodLevels, options.threadCount, chains);
+		result.processTime = Seconds(start);
+
+		// The errors are compared with the size of the meshes, so that different scenes are comparable
+		size_t measured = 0;
+		for (size_t i = 0; i < chains.size(); ++i)
+		{
+			const auto& levels = chains[i].levels;
+			result.triangleCount += levels[0].triangleCount;
+			for (size_t l = 1; l < levels.size(); ++l)
+			{
+				result.lodTriangleCount += levels[l].triangleCount;
+			}
+
+			XMVECTOR minimum = XMVectorReplicate(FLT_MAX), maximum = XMVectorReplicate(-FLT_MAX);
+			for (auto& x : meshes[i]->vertices)
+			{
+				XMVECTOR P = XMLoadFloat4(&x.pos);
+				minimum = XMVectorMin(minimum, P);
+				maximum = XMVectorMax(maximum, P);
+			}
+			float size = XMVectorGetX(XMVector3Length(maximum - minimum));
+			if (levels.size() > 1 && size > 0)
+			{
+				float error = levels.back().error / size;
+				result.lodMaxError = max(result.lodMaxError, error);
+				result.lodMeanError += error;
+				measured++;
+			}
+		}
+		if (measured > 0)
+		{
+			result.lodMeanError /= measured;
+		}
+	}
+
+	for (auto& x : models)
+	{
+		SAFE_DELETE(x);
+	}
+	result.succeeded = result.error.empty();
+	return result;
+}
+
+size_t SceneConverter::DeduplicateMaterials(Model* model)
+{
+	// Pick the survivors in name order, so the result doesn't depend on the hash map
+	vector<Material*> materials;
+	for (auto& x : model->materials)
+	{
+		materials.push_back(x.second);
+	}
+	sort(materials.begin(), materials.end(), [](const Material* a, const Material* b) { return a->name < b->name; });
+
+	// Materials are compared by their archives, bucketed by the hash of the archive
+	unordered_map<Material*, Material*> replacements;
+	unordered_map<uint64_t, vector<pair<Material*, vector<uint8_t>>>> unique;
+	for (auto& x : materials)
+	{
+		vector<uint8_t> data;
+		if (!ArchiveMaterial(x, data))
+		{
+			// can't be compared, it stays
+			continue;
+		}
+		auto& bucket = unique[ScenePackage::Hash(data.data(), data.size())];
+		Material* found = nullptr;
+		for (auto& y : bucket)
+		{
+			if (y.second == data)
+			{
+				found = y.first;
+				break;
+			}
+		}
+		if (found == nullptr)
+		{
+			bucket.push_back(make_pair(x, move(data)));
+		}
+		else
+		{
+			replacements[x] = found;
+		}
+	}
+	if (replacements.empty())
+	{
+		return 0;
+	}
+
+	for (auto& x : model->meshes)
+	{
+		Mesh* mesh = x.second;
+		for (size_t s = 0; s < mesh->subsets.size(); ++s)
+		{
+			auto it = replacements.find(mesh->subsets[s].material);
+			if (it == replacements.end())
+			{
+				continue;
+			}
+			mesh->subsets[s].material = it->second;
+			// the names link the subsets to the materials when the model is deserialized
+			if (s < mesh->materialNames.size())
+			{
+				mesh->materialNames[s] = it->second->name;
+			}
+		}
+	}
+	for (auto& x : replacements)
+	{
+		model->materials.erase(x.first->name);
+		Material* material = x.first;
+		SAFE_DELETE(material);
+	}
+	return replacements.size();
+}
+
+string SceneConverter::CheckModel(Model* model)
+{
+	for (auto& x : model->objects)
+	{
+		if (x->mesh != nullptr && model->meshes.find(x->mesh->name) == model->meshes.end())
+		{
+			return "object " + x->name + " references a mesh outside of the model";
+		}
+	}
+	for (auto& x : model->meshes)
+	{
+		Mesh* mesh = x.second;
+		for (auto& subset : mesh->subsets)
+		{
+			if (subset.material == nullptr)
+			{
+				return "mesh " + mesh->name + " has a subset without material";
+			}
+			if (subset.subsetIndices.size() % 3 != 0)
+			{
+				return "mesh " + mesh->name + " has an incomplete triangle";
+			}
+			for (auto& index : subset.subsetIndices)
+			{
+				if (index >= mesh->vertices.size())
+				{
+					return "mesh " + mesh->name + " has an index out of range";
+				}
+			}
+		}
+	}
+	return "";
+}
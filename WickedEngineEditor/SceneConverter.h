@@ -0,0 +1,76 @@
+#pragma once
+#include "WickedEngine.h"
+#include "MeshOptimizer.h"
+
+#include <string>
+#include <vector>
+
+// Batch conversion and validation of model files, built as its own console program without a window
+//	WickedEngineConverter.exe -convert <files or directories...> [-out <directory>] [-threads <count>] [-dedup] [-optimize] [-lods] [-levels <count>]
+//	WickedEngineConverter.exe -validate <files or directories...> [-threads <count>]
+//	WickedEngineConverter.exe -lodbench <files or directories...> [-threads <count>] [-levels <count>]
+//	Directories are searched for .wio (convert) or .wimf (validate, lodbench) files, not recursively.
+//	Converted files are written as scene packages next to the input, or into the -out directory, with
+//	the LOD chains of the meshes if -lods is given. -optimize reorders the triangles and vertices of the
+//	meshes for the GPU and checks that every mesh kept its triangles, a mesh that didn't fails the file. The LOD benchmark simplifies every mesh of the files,
+//	one file at a time with the meshes on the worker pool, and reports the speed and the errors.
+class SceneConverter
+{
+public:
+	enum Mode
+	{
+		MODE_NONE,
+		MODE_CONVERT,
+		MODE_VALIDATE,
+		MODE_LODBENCH,
+	};
+
+	struct Options
+	{
+		Mode mode;
+		std::vector<std::string> inputs;
+		std::string outputDirectory;
+		uint32_t threadCount;		// zero uses every core
+		bool deduplicateMaterials;
+		bool optimizeMeshes;
+		bool buildLODs;
+		uint32_t lodLevels;			// including the full detail
+
+		Options() :mode(MODE_NONE), threadCount(0), deduplicateMaterials(false), optimizeMeshes(false), buildLODs(false), lodLevels(4) {}
+	};
+
+	struct Result
+	{
+		std::string fileName;
+		bool succeeded;
+		std::string error;
+		size_t inputSize, outputSize;
+		float loadTime, processTime, writeTime;	// seconds
+		size_t objectCount, meshCount, vertexCount;
+		size_t materialCount, mergedMaterialCount;
+		uint32_t chunkCount;
+		size_t triangleCount, lodTriangleCount;	// lodTriangleCount: all levels but the full detail
+		float lodMaxError, lodMeanError;		// coarsest levels, relative to the size of the meshes
+		MeshOptimizer::Statistics cacheBefore, cacheAfter;
+
+		Result();
+	};
+
+	// Returns false if the arguments don't name a mode
+	static bool ParseArguments(const std::vector<std::string>& arguments, Options& options);
+
+	// Processes every input on a worker pool, prints a line per file and a summary to stdout, returns
+	//	the process exit code. Materials load their textures as they deserialize, so a device has to be
+	//	in place: the converter installs a GraphicsDevice_Null.
+	static int Run(const Options& options);
+
+	static Result Convert(const std::string& fileName, const Options& options);
+	static Result Validate(const std::string& fileName);
+	static Result BenchmarkLODs(const std::string& fileName, const Options& options);
+
+	// Merges the materials that only differ in their names, returns how many were removed
+	static size_t DeduplicateMaterials(Model* model);
+	// Checks the references of the meshes, returns an empty string if the model is fine
+	static std::string CheckModel(Model* model);
+};
+
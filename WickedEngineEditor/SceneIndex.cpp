@@ -0,0 +1,134 @@
+#include "stdafx.h"
+#include "SceneIndex.h"
+
+#include <vector>
+
+SceneIndex* SceneIndex::instance = nullptr;
+
+SceneIndex* SceneIndex::GetInstance()
+{
+	if (instance == nullptr)
+	{
+		instance = new SceneIndex;
+	}
+	return instance;
+}
+
+void SceneIndex::Add(Transform* node)
+{
+	if (node == nullptr)
+	{
+		return;
+	}
+	version++;
+
+	vector<Transform*> stack;
+	stack.push_back(node);
+	while (!stack.empty())
+	{
+		Transform* x = stack.back();
+		stack.pop_back();
+		lookup[x->GetID()] = x;
+		for (auto& y : x->children)
+		{
+			stack.push_back(y);
+		}
+	}
+}
+void SceneIndex::Remove(Transform* node)
+{
+	if (node == nullptr)
+	{
+		return;
+	}
+	version++;
+
+	vector<Transform*> stack;
+	stack.push_back(node);
+	while (!stack.empty())
+	{
+		Transform* x = stack.back();
+		stack.pop_back();
+		auto it = lookup.find(x->GetID());
+		if (it != lookup.end() && it->second == x)
+		{
+			lookup.erase(it);
+		}
+		for (auto& y : x->children)
+		{
+			stack.push_back(y);
+		}
+	}
+}
+void SceneIndex::Rebuild(Transform* root)
+{
+	lookup.clear();
+	const auto& current = wiRenderer::GetScene().models;
+	models.assign(current.begin(), current.end());
+	Add(root);
+}
+void SceneIndex::Clear()
+{
+	version++;
+	lookup.clear();
+	models.clear();
+}
+void SceneIndex::CheckModels()
+{
+	const auto& current = wiRenderer::GetScene().models;
+	auto it = current.begin();
+	for (auto& x : models)
+	{
+		if (it == current.end() || *it != x)
+		{
+			Rebuild(wiRenderer::GetScene().GetWorldNode());
+			return;
+		}
+		++it;
+	}
+	models.insert(models.end(), it, current.end());
+}
+
+Transform* SceneIndex::Find(uint64_t id)
+{
+	CheckModels();
+	auto it = lookup.find(id);
+	if (it != lookup.end())
+	{
+		return it->second;
+	}
+
+	Transform* found = wiRenderer::GetScene().GetWorldNode()->find(id);
+	if (found != nullptr)
+	{
+		lookup[id] = found;
+		version++;
+	}
+	return found;
+}
+
+bool SceneIndex::Verify(Transform* root) const
+{
+	if (root == nullptr)
+	{
+		return true;
+	}
+
+	vector<Transform*> stack;
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		Transform* x = stack.back();
+		stack.pop_back();
+		auto it = lookup.find(x->GetID());
+		if (it == lookup.end() || it->second != x)
+		{
+			return false;
+		}
+		for (auto& y : x->children)
+		{
+			stack.push_back(y);
+		}
+	}
+	return true;
+}
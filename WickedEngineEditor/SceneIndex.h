@@ -0,0 +1,44 @@
+#pragma once
+#include "WickedEngine.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Index from Transform::GetID() to the node for the scene graph
+//	Editor operations that add or remove scene nodes report them here, so ID lookups don't have to
+//	walk the whole transform tree. A node stays indexed while it is detached (for example while it is
+//	attached to the translator), only removal from the scene drops it. The engine frees whole models
+//	on its own (unload, ClearWorld), so the index remembers the models it was built over and starts
+//	over from the tree when one of them is gone, before it hands out a pointer.
+class SceneIndex
+{
+private:
+	std::unordered_map<uint64_t, Transform*> lookup;
+	std::vector<Model*> models;
+	uint64_t version = 0;
+	static SceneIndex* instance;
+
+	// Rebuilds if a model was removed since the last check, added models only need the lookup on a miss
+	void CheckModels();
+public:
+	static SceneIndex* GetInstance();
+
+	// Index the node and its whole subtree
+	void Add(Transform* node);
+	// Drop the node and its whole subtree
+	void Remove(Transform* node);
+	void Rebuild(Transform* root);
+	void Clear();
+
+	// Nodes that were added behind the editor's back (scripts, engine helpers) are looked up in the
+	//	tree on a miss and indexed from then on
+	Transform* Find(uint64_t id);
+	size_t GetCount() const { return lookup.size(); }
+	// Incremented whenever nodes are added or removed, caches over the scene can compare against it
+	uint64_t GetVersion() const { return version; }
+
+	// Checks that every node of the tree is indexed correctly, for tests: nodes that were added behind
+	//	the editor's back are only indexed once Find() has met them
+	bool Verify(Transform* root) const;
+};
+
@@ -0,0 +1,487 @@
+#include "stdafx.h"
+#include "ScenePackage.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+
+namespace
+{
+	bool ReadFileData(const string& fileName, vector<uint8_t>& data)
+	{
+		ifstream file(fileName, ios::binary | ios::ate);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		data.resize((size_t)file.tellg());
+		file.seekg(0, ios::beg);
+		file.read((char*)data.data(), (streamsize)data.size());
+		return file.good() || file.eof();
+	}
+
+	// Disjoint sets over meshes, joined by shared materials
+	size_t FindRoot(vector<size_t>& parents, size_t x)
+	{
+		while (parents[x] != x)
+		{
+			parents[x] = parents[parents[x]];
+			x = parents[x];
+		}
+		return x;
+	}
+
+	// Model that only references entities owned by someone else
+	void ReleaseChunkModel(Model* model)
+	{
+		model->objects.clear();
+		model->lights.clear();
+		model->decals.clear();
+		model->meshes.clear();
+		model->materials.clear();
+		SAFE_DELETE(model);
+	}
+}
+
+
+uint64_t ScenePackage::Hash(const uint8_t* data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool ScenePackage::IsPackage(const string& fileName)
+{
+	ifstream file(fileName, ios::binary);
+	Header header;
+	if (!file.is_open() || !file.read((char*)&header, sizeof(header)))
+	{
+		return false;
+	}
+	return header.magic == MAGIC;
+}
+
+string ScenePackage::MakeTempFileName(const string& prefix)
+{
+	static atomic<uint32_t> counter(0);
+	CreateDirectoryA("temp", nullptr);
+	stringstream ss("");
+	ss << "temp/" << prefix << GetCurrentProcessId() << "_" << counter.fetch_add(1);
+	return ss.str();
+}
+
+bool ScenePackage::Write(Model* model, const string& fileName, int editorVersion, const vector<uint8_t>& lodData)
+{
+	// Group the content: meshes that share a material belong together, because a material can only
+	//	be deserialized into one model. Parent links are resolved by name inside one model archive, so
+	//	a whole transform hierarchy belongs together too, with the meshes of its objects.
+	vector<Mesh*> meshes;
+	unordered_map<Mesh*, size_t> meshIndices;
+	auto addMesh = [&](Mesh* mesh) {
+		if (meshIndices.find(mesh) == meshIndices.end())
+		{
+			meshIndices[mesh] = meshes.size();
+			meshes.push_back(mesh);
+		}
+	};
+	for (auto& x : model->objects)
+	{
+		if (x->mesh != nullptr)
+		{
+			addMesh(x->mesh);
+		}
+	}
+	// Meshes that no object uses, by name so that the same scene is always written the same way
+	vector<Mesh*> unusedMeshes;
+	for (auto& x : model->meshes)
+	{
+		if (meshIndices.find(x.second) == meshIndices.end())
+		{
+			unusedMeshes.push_back(x.second);
+		}
+	}
+	sort(unusedMeshes.begin(), unusedMeshes.end(), [](const Mesh* a, const Mesh* b) { return a->name < b->name; });
+	for (auto& x : unusedMeshes)
+	{
+		addMesh(x);
+	}
+
+	vector<Transform*> entities;
+	for (auto& x : model->objects)
+	{
+		entities.push_back(x);
+	}
+	for (auto& x : model->lights)
+	{
+		entities.push_back(x);
+	}
+	for (auto& x : model->decals)
+	{
+		entities.push_back(x);
+	}
+	unordered_map<string, size_t> entityNames;
+	for (size_t i = 0; i < entities.size(); ++i)
+	{
+		entityNames[entities[i]->name] = i;
+	}
+
+	// Disjoint sets over the meshes, then the entities
+	vector<size_t> parents(meshes.size() + entities.size());
+	for (size_t i = 0; i < parents.size(); ++i)
+	{
+		parents[i] = i;
+	}
+	auto join = [&](size_t a, size_t b) {
+		parents[FindRoot(parents, a)] = FindRoot(parents, b);
+	};
+	unordered_map<Material*, size_t> materialOwners;
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		for (auto& subset : meshes[i]->subsets)
+		{
+			if (subset.material == nullptr)
+			{
+				continue;
+			}
+			auto it = materialOwners.find(subset.material);
+			if (it == materialOwners.end())
+			{
+				materialOwners[subset.material] = i;
+			}
+			else
+			{
+				join(i, it->second);
+			}
+		}
+	}
+	for (size_t i = 0; i < entities.size(); ++i)
+	{
+		Object* object = dynamic_cast<Object*>(entities[i]);
+		if (object != nullptr && object->mesh != nullptr)
+		{
+			join(meshes.size() + i, meshIndices[object->mesh]);
+		}
+		if (!entities[i]->parentName.empty())
+		{
+			auto it = entityNames.find(entities[i]->parentName);
+			if (it != entityNames.end())
+			{
+				join(meshes.size() + i, meshes.size() + it->second);
+			}
+		}
+	}
+
+	// Pack the groups with meshes into chunks of roughly minChunkVertices, the groups without a mesh
+	//	go into the entities chunk
+	unordered_map<size_t, size_t> groupChunks;
+	vector<size_t> chunkVertices;
+	vector<Model*> chunks;
+	vector<uint32_t> chunkTypes;
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		size_t root = FindRoot(parents, i);
+		if (groupChunks.find(root) == groupChunks.end())
+		{
+			if (chunks.empty() || chunkVertices.back() >= minChunkVertices)
+			{
+				chunks.push_back(new Model);
+				chunkTypes.push_back(CHUNK_MODEL);
+				chunkVertices.push_back(0);
+			}
+			groupChunks[root] = chunks.size() - 1;
+		}
+		chunkVertices[groupChunks[root]] += meshes[i]->vertices.size();
+	}
+	Model* entityChunk = new Model;
+	auto chunkOf = [&](size_t node) {
+		auto it = groupChunks.find(FindRoot(parents, node));
+		return it != groupChunks.end() ? chunks[it->second] : entityChunk;
+	};
+	for (size_t i = 0; i < entities.size(); ++i)
+	{
+		Model* chunk = chunkOf(meshes.size() + i);
+		if (Object* object = dynamic_cast<Object*>(entities[i]))
+		{
+			chunk->Add(object);
+		}
+		else if (Light* light = dynamic_cast<Light*>(entities[i]))
+		{
+			chunk->Add(light);
+		}
+		else if (Decal* decal = dynamic_cast<Decal*>(entities[i]))
+		{
+			chunk->Add(decal);
+		}
+	}
+	for (auto& x : unusedMeshes)
+	{
+		Model* chunk = chunkOf(meshIndices[x]);
+		chunk->meshes[x->name] = x;
+		for (auto& subset : x->subsets)
+		{
+			if (subset.material != nullptr)
+			{
+				chunk->materials[subset.material->name] = subset.material;
+			}
+		}
+	}
+	// Materials that no mesh uses
+	for (auto& x : model->materials)
+	{
+		if (materialOwners.find(x.second) == materialOwners.end())
+		{
+			entityChunk->materials[x.first] = x.second;
+		}
+	}
+	if (entityChunk->objects.empty() && entityChunk->lights.empty() && entityChunk->decals.empty() && entityChunk->materials.empty())
+	{
+		ReleaseChunkModel(entityChunk);
+	}
+	else
+	{
+		chunks.push_back(entityChunk);
+		chunkTypes.push_back(CHUNK_ENTITIES);
+	}
+
+	// wiArchive only writes files, so every worker serializes into its own temporary file
+	vector<vector<uint8_t>> blobs(chunks.size());
+	atomic<size_t> next(0);
+	atomic<bool> failed(false);
+	auto work = [&] {
+		size_t i;
+		while ((i = next.fetch_add(1)) < chunks.size())
+		{
+			string tempFileName = MakeTempFileName("write");
+			{
+				wiArchive archive(tempFileName, false);
+				if (!archive.IsOpen())
+				{
+					failed.store(true);
+					continue;
+				}
+				chunks[i]->Serialize(archive);
+			}
+			if (!ReadFileData(tempFileName, blobs[i]))
+			{
+				failed.store(true);
+			}
+			remove(tempFileName.c_str());
+		}
+	};
+	size_t workerCount = min((size_t)max(1u, thread::hardware_concurrency()), chunks.size());
+	vector<thread> workers;
+	for (size_t i = 1; i < workerCount; ++i)
+	{
+		workers.push_back(thread(work));
+	}
+	work();
+	for (auto& x : workers)
+	{
+		x.join();
+	}
+
+	for (auto& x : chunks)
+	{
+		ReleaseChunkModel(x);
+	}
+	if (failed.load())
+	{
+		return false;
+	}
+	if (!lodData.empty())
+	{
+		blobs.push_back(lodData);
+		chunkTypes.push_back(CHUNK_LODS);
+	}
+
+	// Stitch: header, table of contents, then the chunks in order
+	Header header;
+	header.magic = MAGIC;
+	header.formatVersion = FORMAT_VERSION;
+	header.editorVersion = editorVersion;
+	header.chunkCount = (uint32_t)blobs.size();
+
+	vector<ChunkEntry> toc(blobs.size());
+	uint64_t offset = sizeof(Header) + sizeof(ChunkEntry) * toc.size();
+	for (size_t i = 0; i < blobs.size(); ++i)
+	{
+		toc[i].type = chunkTypes[i];
+		toc[i].reserved = 0;
+		toc[i].offset = offset;
+		toc[i].size = blobs[i].size();
+		toc[i].hash = Hash(blobs[i].data(), blobs[i].size());
+		offset += toc[i].size;
+	}
+
+	ofstream file(fileName, ios::binary | ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	file.write((const char*)&header, sizeof(header));
+	if (!toc.empty())
+	{
+		file.write((const char*)toc.data(), (streamsize)(sizeof(ChunkEntry) * toc.size()));
+	}
+	for (auto& x : blobs)
+	{
+		file.write((const char*)x.data(), (streamsize)x.size());
+	}
+	file.close();
+	return !file.fail();
+}
+
+bool ScenePackage::Read(const string& fileName, int editorVersion, vector<Model*>& models)
+{
+	Reader reader;
+	if (!reader.Open(fileName, editorVersion))
+	{
+		return false;
+	}
+	for (uint32_t i = 0; i < reader.GetChunkCount(); ++i)
+	{
+		if (reader.GetChunk(i).type == CHUNK_LODS)
+		{
+			continue;
+		}
+		Model* model = reader.LoadChunk(i);
+		if (model != nullptr)
+		{
+			models.push_back(model);
+		}
+	}
+	return true;
+}
+
+
+ScenePackage::Reader::Reader() :header(nullptr), toc(nullptr)
+{
+}
+
+bool ScenePackage::Reader::Open(const string& name, int editorVersion)
+{
+	Close();
+	if (!file.Open(name) || file.GetSize() < sizeof(Header))
+	{
+		Close();
+		return false;
+	}
+
+	const Header* h = (const Header*)file.GetData();
+	if (h->magic != MAGIC || h->formatVersion > FORMAT_VERSION ||
+		file.GetSize() < sizeof(Header) + sizeof(ChunkEntry) * (size_t)h->chunkCount)
+	{
+		Close();
+		return false;
+	}
+	const ChunkEntry* entries = (const ChunkEntry*)(file.GetData() + sizeof(Header));
+	for (uint32_t i = 0; i < h->chunkCount; ++i)
+	{
+		if (entries[i].offset + entries[i].size > file.GetSize())
+		{
+			Close();
+			return false;
+		}
+	}
+	if (h->editorVersion > editorVersion)
+	{
+		wiBackLog::post(("Warning: " + name + " was written by a newer editor!").c_str());
+	}
+
+	fileName = name;
+	header = h;
+	toc = entries;
+	return true;
+}
+void ScenePackage::Reader::Close()
+{
+	file.Close();
+	header = nullptr;
+	toc = nullptr;
+}
+
+Model* ScenePackage::Reader::LoadChunk(uint32_t index) const
+{
+	string tempFileName = GetTempFileName(index);
+	if (!ExtractChunk(index, tempFileName))
+	{
+		return nullptr;
+	}
+	return DecodeChunk(tempFileName);
+}
+bool ScenePackage::Reader::ReadChunk(uint32_t index, vector<uint8_t>& data) const
+{
+	const ChunkEntry& entry = toc[index];
+	const uint8_t* chunk = file.GetData() + entry.offset;
+	if (Hash(chunk, (size_t)entry.size) != entry.hash)
+	{
+		wiBackLog::post("Corrupted scene package chunk was skipped!");
+		return false;
+	}
+	data.assign(chunk, chunk + entry.size);
+	return true;
+}
+bool ScenePackage::Reader::ExtractChunk(uint32_t index, const string& tempFileName) const
+{
+	const ChunkEntry& entry = toc[index];
+	const uint8_t* chunk = file.GetData() + entry.offset;
+	if (Hash(chunk, (size_t)entry.size) != entry.hash)
+	{
+		wiBackLog::post("Corrupted scene package chunk was skipped!");
+		return false;
+	}
+
+	// wiArchive can only read files, so the chunk goes through a temporary one. It is marked temporary,
+	//	so it stays in the file cache and is usually deleted by the decoder before it ever reaches the disk.
+	HANDLE temp = CreateFileA(tempFileName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+	if (temp == INVALID_HANDLE_VALUE)
+	{
+		wiBackLog::post(("Failed to create " + tempFileName + ", a scene package chunk was skipped!").c_str());
+		return false;
+	}
+	bool written = true;
+	for (uint64_t offset = 0; written && offset < entry.size;)
+	{
+		DWORD size = (DWORD)min(entry.size - offset, (uint64_t)(64 * 1024 * 1024));
+		DWORD sizeWritten = 0;
+		written = WriteFile(temp, chunk + offset, size, &sizeWritten, nullptr) && sizeWritten == size;
+		offset += size;
+	}
+	CloseHandle(temp);
+	if (!written)
+	{
+		remove(tempFileName.c_str());
+		wiBackLog::post(("Failed to write " + tempFileName + ", a scene package chunk was skipped!").c_str());
+		return false;
+	}
+	return true;
+}
+Model* ScenePackage::Reader::DecodeChunk(const string& tempFileName)
+{
+	Model* model = nullptr;
+	{
+		wiArchive archive(tempFileName, true);
+		if (archive.IsOpen())
+		{
+			model = new Model;
+			model->Serialize(archive);
+		}
+	}
+	remove(tempFileName.c_str());
+	return model;
+}
+string ScenePackage::Reader::GetTempFileName(uint32_t index) const
+{
+	return MakeTempFileName("chunk");
+}
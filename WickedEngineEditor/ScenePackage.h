@@ -0,0 +1,96 @@
+#pragma once
+#include "WickedEngine.h"
+#include "MappedFile.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Chunked .wimf container
+//	[Header] [ChunkEntry * chunkCount] [chunk data...]
+//	Every chunk is a complete model archive, so chunks can be serialized and deserialized independently
+//	of each other. The scene is split along materials and hierarchies: objects that share a mesh or a
+//	material always end up in the same chunk, and so does every transform hierarchy, because the parent
+//	links are restored by name inside one archive. Files without the package header are plain model
+//	archives (the old format).
+class ScenePackage
+{
+public:
+	enum ChunkType
+	{
+		CHUNK_MODEL,	// objects with their meshes and materials, and the entities in their hierarchies
+		CHUNK_ENTITIES,	// hierarchies without a mesh: lights, decals and objects, and unused materials
+		CHUNK_LODS,		// LOD chains of the meshes (MeshLODs), not a model archive
+	};
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t formatVersion;
+		int32_t editorVersion;	// __editorVersion of the writer
+		uint32_t chunkCount;
+	};
+	struct ChunkEntry
+	{
+		uint32_t type;
+		uint32_t reserved;
+		uint64_t offset;	// from the beginning of the file
+		uint64_t size;
+		uint64_t hash;		// FNV-1a of the chunk data
+	};
+
+	static const uint32_t MAGIC = 0x4B504957; // "WIPK"
+	static const uint32_t FORMAT_VERSION = 2;
+
+	// Chunks below this many vertices are merged with others, so small scenes don't pay for many chunks
+	static const size_t minChunkVertices = 64 * 1024;
+
+	static uint64_t Hash(const uint8_t* data, size_t size);
+
+	// Checks the header only
+	static bool IsPackage(const std::string& fileName);
+	// wiArchive can only open files, so everything that serializes in memory goes through these. They are
+	//	in the temp directory, because the scene may be in a read-only one, and every name is unique.
+	static std::string MakeTempFileName(const std::string& prefix);
+
+	// Serializes the model's content chunk by chunk on a worker pool, then stitches the chunks together.
+	//	The model is only read, it must not change while this runs. The LOD chains are stored as they are.
+	static bool Write(Model* model, const std::string& fileName, int editorVersion, const std::vector<uint8_t>& lodData = std::vector<uint8_t>());
+
+	// Deserializes every model chunk into its own model, returns false if the file is not a valid package
+	static bool Read(const std::string& fileName, int editorVersion, std::vector<Model*>& models);
+
+	// Random access to the chunks of a package through a memory mapping, only the table of contents
+	//	and the chunks that are actually loaded are read from the disk
+	class Reader
+	{
+	private:
+		MappedFile file;
+		std::string fileName;
+		const Header* header;
+		const ChunkEntry* toc;
+	public:
+		Reader();
+
+		// Returns false if the file is not a valid package
+		bool Open(const std::string& fileName, int editorVersion);
+		void Close();
+
+		bool IsOpen() const { return header != nullptr; }
+		uint32_t GetChunkCount() const { return header != nullptr ? header->chunkCount : 0; }
+		const ChunkEntry& GetChunk(uint32_t index) const { return toc[index]; }
+		// Deserializes one chunk into a new model, nullptr if the chunk is corrupted
+		Model* LoadChunk(uint32_t index) const;
+		// Copies the data of a chunk that is not a model, returns false if it is corrupted
+		bool ReadChunk(uint32_t index, std::vector<uint8_t>& data) const;
+
+		// The two halves of LoadChunk(), so that they can run on different threads:
+		//	copies the chunk into a file that wiArchive can open, then deserializes (and deletes) that file.
+		//	ExtractChunk() reports its failures to the backlog.
+		bool ExtractChunk(uint32_t index, const std::string& tempFileName) const;
+		static Model* DecodeChunk(const std::string& tempFileName);
+		// A new file name in the temp directory for every call
+		std::string GetTempFileName(uint32_t index) const;
+	};
+};
+
@@ -0,0 +1,190 @@
+#include "stdafx.h"
+#include "SceneSnapshot.h"
+
+#include "ScenePackage.h"
+#include "MeshLODs.h"
+
+using namespace std;
+
+extern int __editorVersion;
+
+
+SceneSnapshot::SceneSnapshot() :model(nullptr)
+{
+}
+SceneSnapshot::~SceneSnapshot()
+{
+	Release();
+}
+
+void SceneSnapshot::Capture()
+{
+	Release();
+	model = new Model;
+
+	// The meshes are shared with the scene, they are written in full detail
+	MeshLODs::GetInstance()->RestoreFullDetail();
+	lodData.clear();
+	MeshLODs::GetInstance()->Write(lodData);
+
+	auto& children = wiRenderer::GetScene().GetWorldNode()->children;
+	for (auto& x : children)
+	{
+		Model* source = dynamic_cast<Model*>(x);
+		if (source == nullptr)
+		{
+			continue;
+		}
+
+		// The copies keep the parent names for serialization, but they must not reference the scene graph,
+		//	otherwise destroying them would detach live nodes
+		for (auto& y : source->objects)
+		{
+			Object* o = new Object(*y);
+			o->parent = nullptr;
+			o->children.clear();
+			model->Add(o);
+		}
+		for (auto& y : source->lights)
+		{
+			Light* l = new Light(*y);
+			l->parent = nullptr;
+			l->children.clear();
+			model->Add(l);
+		}
+		for (auto& y : source->decals)
+		{
+			Decal* d = new Decal(*y);
+			d->parent = nullptr;
+			d->children.clear();
+			model->Add(d);
+		}
+		// Meshes and materials that no object uses are saved too, like Save did with the whole model
+		model->meshes.insert(source->meshes.begin(), source->meshes.end());
+		model->materials.insert(source->materials.begin(), source->materials.end());
+	}
+}
+bool SceneSnapshot::Write(const string& fileName) const
+{
+	if (model == nullptr)
+	{
+		return false;
+	}
+
+	string tempName = fileName + ".tmp";
+	if (!ScenePackage::Write(model, tempName, __editorVersion, lodData))
+	{
+		remove(tempName.c_str());
+		return false;
+	}
+
+	return MoveFileExA(tempName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+}
+void SceneSnapshot::Release()
+{
+	if (model == nullptr)
+	{
+		return;
+	}
+
+	for (auto& x : model->objects)
+	{
+		// particle systems are shared with the original object
+		x->eParticleSystems.clear();
+		x->hParticleSystems.clear();
+		SAFE_DELETE(x);
+	}
+	for (auto& x : model->lights)
+	{
+		SAFE_DELETE(x);
+	}
+	for (auto& x : model->decals)
+	{
+		SAFE_DELETE(x);
+	}
+	// Meshes and materials belong to the scene
+	model->objects.clear();
+	model->lights.clear();
+	model->decals.clear();
+	model->meshes.clear();
+	model->materials.clear();
+	SAFE_DELETE(model);
+	lodData.clear();
+}
+
+
+SceneWriter::SceneWriter() :finished(false), running(false), succeeded(false), autosaveInterval(0)
+{
+	lastAutosave = chrono::steady_clock::now();
+}
+SceneWriter::~SceneWriter()
+{
+	Wait();
+}
+
+bool SceneWriter::Save(const string& name)
+{
+	if (running)
+	{
+		return false;
+	}
+
+	// Only the snapshot is taken on the main thread, serialization and the disk write are on the worker
+	snapshot.Capture();
+	fileName = name;
+	finished.store(false);
+	running = true;
+	worker = thread([this] {
+		succeeded = snapshot.Write(fileName);
+		finished.store(true);
+	});
+	return true;
+}
+void SceneWriter::Update(bool autosaveAllowed)
+{
+	if (running && finished.load())
+	{
+		Finish();
+	}
+
+	if (autosaveInterval > 0 && autosaveAllowed && !running && !autosaveFileName.empty())
+	{
+		auto now = chrono::steady_clock::now();
+		if (chrono::duration<float>(now - lastAutosave).count() >= autosaveInterval)
+		{
+			lastAutosave = now;
+			Save(autosaveFileName);
+		}
+	}
+}
+void SceneWriter::Wait()
+{
+	if (running)
+	{
+		Finish();
+	}
+}
+
+void SceneWriter::Finish()
+{
+	if (worker.joinable())
+	{
+		worker.join();
+	}
+	running = false;
+	snapshot.Release();
+
+	if (succeeded)
+	{
+		wiBackLog::post(("Scene saved: " + fileName).c_str());
+	}
+	else if (fileName == autosaveFileName)
+	{
+		// Autosave runs behind the user's back, it must not pop up a modal dialog
+		wiBackLog::post(("Autosave failed: could not write " + fileName + "!").c_str());
+	}
+	else
+	{
+		wiHelper::messageBox("Could not save " + fileName + "!");
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "WickedEngine.h"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+// Copy of the scene that can be serialized away from the main thread
+//	Objects, lights and decals are copied, because the editor, the engine and scripts write their
+//	fields directly and there is no write hook for a copy on write. They are small, so copying them
+//	is cheap next to the write. Meshes and materials (all of them, also the unused ones) are large,
+//	so the snapshot shares them with the scene and the editor doesn't change them while a write is
+//	running: the mesh and material windows are locked, LOD selection and impostor baking pause, and
+//	anything else that changes or destroys meshes or materials waits for the writer first
+//	(SceneWriter::Wait()).
+class SceneSnapshot
+{
+private:
+	Model* model;
+	std::vector<uint8_t> lodData;
+public:
+	SceneSnapshot();
+	~SceneSnapshot();
+
+	// Must be called on the main thread
+	void Capture();
+	// Serializes into fileName.tmp and moves it over fileName when it is complete, so an interrupted
+	//	write never leaves a broken file behind
+	bool Write(const std::string& fileName) const;
+	void Release();
+
+	bool IsEmpty() const { return model == nullptr; }
+};
+
+// Writes scene snapshots on a worker thread, periodically (autosave) or on request (Save)
+class SceneWriter
+{
+private:
+	SceneSnapshot snapshot;
+	std::thread worker;
+	std::atomic<bool> finished;
+	bool running;
+	bool succeeded;
+	std::string fileName;
+	std::chrono::steady_clock::time_point lastAutosave;
+
+	void Finish();
+
+public:
+	SceneWriter();
+	~SceneWriter();
+
+	// Seconds between autosaves, zero disables autosave
+	float autosaveInterval;
+	std::string autosaveFileName;
+
+	// Snapshots the scene now and writes it in the background, returns false if a write is in progress
+	bool Save(const std::string& fileName);
+	// Call every frame on the main thread: starts autosaves and reports finished writes. Autosaves are
+	//	postponed while autosaveAllowed is false, e.g. while a scene is still streaming in.
+	void Update(bool autosaveAllowed = true);
+	// Blocks until the current write is done
+	void Wait();
+
+	bool IsBusy() const { return running; }
+};
+
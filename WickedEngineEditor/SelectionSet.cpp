@@ -0,0 +1,79 @@
+#include "stdafx.h"
+#include "SelectionSet.h"
+
+
+wiRenderer::Picked* SelectionSet::Find(uint64_t transformID) const
+{
+	auto it = lookup.find(transformID);
+	if (it != lookup.end())
+	{
+		return items[it->second];
+	}
+	return nullptr;
+}
+
+bool SelectionSet::Add(wiRenderer::Picked* picked)
+{
+	if (picked == nullptr || picked->transform == nullptr)
+	{
+		return false;
+	}
+
+	uint64_t id = picked->transform->GetID();
+	if (Contains(id))
+	{
+		return false;
+	}
+
+	version++;
+	lookup.insert(make_pair(id, items.size()));
+	items.push_back(picked);
+	savedParents.push_back(picked->transform->parent);
+	return true;
+}
+bool SelectionSet::Remove(uint64_t transformID)
+{
+	auto it = lookup.find(transformID);
+	if (it == lookup.end())
+	{
+		return false;
+	}
+	version++;
+	size_t index = it->second;
+	lookup.erase(it);
+	RemoveAt(index);
+	return true;
+}
+void SelectionSet::Clear()
+{
+	version++;
+	for (auto& x : items)
+	{
+		SAFE_DELETE(x);
+	}
+	items.clear();
+	savedParents.clear();
+	lookup.clear();
+}
+void SelectionSet::Reserve(size_t count)
+{
+	items.reserve(count);
+	savedParents.reserve(count);
+	lookup.reserve(count);
+}
+
+void SelectionSet::RemoveAt(size_t index)
+{
+	SAFE_DELETE(items[index]);
+
+	// Swap with the last one to keep the storage contiguous
+	size_t last = items.size() - 1;
+	if (index != last)
+	{
+		items[index] = items[last];
+		savedParents[index] = savedParents[last];
+		lookup[items[index]->transform->GetID()] = index;
+	}
+	items.pop_back();
+	savedParents.pop_back();
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "WickedEngine.h"
+
+#include <vector>
+#include <unordered_map>
+
+// The editor's selection
+//	Picks are stored contiguously for iteration and indexed by transform ID for O(1) lookup. The parent
+//	that each selected transform had before it was selected is kept alongside, so that it can be
+//	reattached after translation.
+class SelectionSet
+{
+private:
+	std::vector<wiRenderer::Picked*> items;
+	std::vector<Transform*> savedParents;
+	std::unordered_map<uint64_t, size_t> lookup;
+	uint64_t version = 0;
+
+	void RemoveAt(size_t index);
+public:
+	typedef std::vector<wiRenderer::Picked*>::iterator iterator;
+	typedef std::vector<wiRenderer::Picked*>::const_iterator const_iterator;
+
+	iterator begin() { return items.begin(); }
+	iterator end() { return items.end(); }
+	const_iterator begin() const { return items.begin(); }
+	const_iterator end() const { return items.end(); }
+	bool empty() const { return items.empty(); }
+	size_t size() const { return items.size(); }
+	wiRenderer::Picked* operator[](size_t index) const { return items[index]; }
+
+	bool Contains(uint64_t transformID) const { return lookup.find(transformID) != lookup.end(); }
+	// Returns nullptr if the transform is not selected
+	wiRenderer::Picked* Find(uint64_t transformID) const;
+	Transform* GetSavedParent(size_t index) const { return savedParents[index]; }
+	// Incremented whenever the selection changes
+	uint64_t GetVersion() const { return version; }
+
+	// Takes ownership of the pick and remembers the current parent of its transform
+	//	Returns false (and doesn't take ownership) if there is no transform or it is already selected
+	bool Add(wiRenderer::Picked* picked);
+	// Deletes the pick that belongs to the transform, returns false if it wasn't selected
+	bool Remove(uint64_t transformID);
+	// Deletes every pick
+	void Clear();
+	void Reserve(size_t count);
+};
+
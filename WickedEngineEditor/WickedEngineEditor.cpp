@@ -1,6 +1,8 @@
 #include "stdafx.h"
 #include "WickedEngineEditor.h"
 #include "Editor.h"
+#include <shellapi.h>
+#include <sstream>
 
 #define MAX_LOADSTRING 100
 
@@ -42,6 +44,60 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
     LoadStringW(hInstance, IDC_WICKEDENGINEGAME, szWindowClass, MAX_LOADSTRING);
     MyRegisterClass(hInstance);
 
+	{
+		vector<string> arguments;
+		int argc = 0;
+		LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+		for (int i = 1; argv != nullptr && i < argc; ++i)
+		{
+			// The first call measures, the size includes the terminating zero
+			int size = WideCharToMultiByte(CP_ACP, 0, argv[i], -1, nullptr, 0, nullptr, nullptr);
+			string argument(size > 0 ? size : 1, '\0');
+			if (size > 0)
+			{
+				WideCharToMultiByte(CP_ACP, 0, argv[i], -1, &argument[0], size, nullptr, nullptr);
+			}
+			argument.resize(argument.size() - 1);
+			arguments.push_back(argument);
+		}
+		LocalFree(argv);
+
+		// -script <file> plays an input script with the window hidden, -replay <file> plays back what
+		//	-record <file> recorded, -scene <file> is loaded before either of them. Scripts and replays
+		//	write their frame times to -timings <file> and exit.
+		for (size_t i = 0; i + 1 < arguments.size(); ++i)
+		{
+			if (arguments[i] == "-script")
+			{
+				editor.inputScript = arguments[i + 1];
+				nCmdShow = SW_HIDE;
+			}
+			else if (arguments[i] == "-replay")
+			{
+				editor.inputReplay = arguments[i + 1];
+			}
+			else if (arguments[i] == "-record")
+			{
+				editor.inputRecording = arguments[i + 1];
+			}
+			else if (arguments[i] == "-scene")
+			{
+				editor.inputScene = arguments[i + 1];
+			}
+			else if (arguments[i] == "-timings")
+			{
+				editor.timingsFile = arguments[i + 1];
+			}
+		}
+		if (!editor.inputScript.empty() || !editor.inputReplay.empty())
+		{
+			if (AttachConsole(ATTACH_PARENT_PROCESS))
+			{
+				freopen("CONOUT$", "w", stdout);
+			}
+		}
+	}
+
     // Perform application initialization:
     if (!InitInstance (hInstance, nCmdShow))
     {
@@ -59,10 +115,23 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
+			editor.Wake();
+		}
+		else if (editor.IsIdle()) {
+
+			// Sleeps until the next message, but still runs a frame every now and then for the timers
+			//	(autosave, backlog)
+			DWORD result = MsgWaitForMultipleObjects(0, nullptr, FALSE, 1000, QS_ALLINPUT);
+			editor.Waited();
+			if (result == WAIT_TIMEOUT)
+			{
+				editor.RunFrame();
+			}
+
 		}
 		else {
 
-			editor.run();
+			editor.RunFrame();
 
 		}
 	}
@@ -71,7 +140,6 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 }
 
 
-
 //
 //  FUNCTION: MyRegisterClass()
 //
@@ -119,11 +187,85 @@ BOOL InitInstance(HINSTANCE hInstance, int nCmdShow)
    ifstream file("config.ini");
    if (file.is_open())
    {
-	   int enabled;
-	   file >> voidStr >> enabled;
+	   // Key-value pairs, in any order, unknown keys are skipped
+	   int enabled = 0, fullscreen = 0;
+	   int configX = x, configY = y, configW = w, configH = h;
+	   string key, value;
+	   while (file >> key >> value)
+	   {
+		   stringstream ss(value);
+		   if (key == "enabled")
+		   {
+			   ss >> enabled;
+		   }
+		   else if (key == "x")
+		   {
+			   ss >> configX;
+		   }
+		   else if (key == "y")
+		   {
+			   ss >> configY;
+		   }
+		   else if (key == "w")
+		   {
+			   ss >> configW;
+		   }
+		   else if (key == "h")
+		   {
+			   ss >> configH;
+		   }
+		   else if (key == "fullscreen")
+		   {
+			   ss >> fullscreen;
+		   }
+		   else if (key == "historyBudgetMB")
+		   {
+			   int historyBudgetMB;
+			   if (ss >> historyBudgetMB)
+			   {
+				   editor.historyBudget = (size_t)historyBudgetMB * 1024 * 1024;
+			   }
+		   }
+		   else if (key == "autosaveMinutes")
+		   {
+			   float autosaveMinutes;
+			   if (ss >> autosaveMinutes)
+			   {
+				   editor.autosaveInterval = autosaveMinutes * 60;
+			   }
+		   }
+		   else if (key == "contentBudgetMB")
+		   {
+			   int contentBudgetMB;
+			   if (ss >> contentBudgetMB)
+			   {
+				   editor.contentBudget = (size_t)contentBudgetMB * 1024 * 1024;
+			   }
+		   }
+		   else if (key == "idleMode")
+		   {
+			   int idleMode;
+			   if (ss >> idleMode)
+			   {
+				   editor.idleMode = idleMode != 0;
+			   }
+		   }
+		   else if (key == "optimizeOnImport")
+		   {
+			   int optimizeOnImport;
+			   if (ss >> optimizeOnImport)
+			   {
+				   editor.optimizeOnImport = optimizeOnImport != 0;
+			   }
+		   }
+	   }
 	   if (enabled != 0)
 	   {
-		   file >> voidStr >> x >> voidStr >> y >> voidStr >> w >> voidStr >> h >> voidStr >> editor.fullscreen;
+		   x = configX;
+		   y = configY;
+		   w = configW;
+		   h = configH;
+		   editor.fullscreen = fullscreen != 0;
 		   editor.screenW = w;
 		   editor.screenH = h;
 	   }
@@ -1,5 +1,12 @@
 #include "stdafx.h"
 #include "WorldWindow.h"
+#include "SceneSnapshot.h"
+
+#include <sstream>
+
+using namespace std;
+
+extern SceneWriter sceneWriter;
 
 
 WorldWindow::WorldWindow(wiGUI* gui) : GUI(gui)
@@ -11,7 +18,7 @@ WorldWindow::WorldWindow(wiGUI* gui) : GUI(gui)
 
 
 	worldWindow = new wiWindow(GUI, "World Window");
-	worldWindow->SetSize(XMFLOAT2(400, 300));
+	worldWindow->SetSize(XMFLOAT2(400, 450));
 	GUI->AddWidget(worldWindow);
 
 	float x = 200;
@@ -44,6 +51,50 @@ WorldWindow::WorldWindow(wiGUI* gui) : GUI(gui)
 	});
 	worldWindow->AddWidget(fogHeightSlider);
 
+	// Every mesh above either threshold gets an impostor, the distance comes from the error target
+	impostorTrianglesSlider = new wiSlider(0, 100000, (float)impostorSettings.minTriangles, 1000, "Impostor Min Triangles: ");
+	impostorTrianglesSlider->SetSize(XMFLOAT2(100, 30));
+	impostorTrianglesSlider->SetPos(XMFLOAT2(x, y += 50));
+	impostorTrianglesSlider->OnSlide([&](wiEventArgs args) {
+		impostorSettings.minTriangles = (uint32_t)args.fValue;
+	});
+	worldWindow->AddWidget(impostorTrianglesSlider);
+
+	impostorInstancesSlider = new wiSlider(1, 1000, (float)impostorSettings.minInstances, 999, "Impostor Min Instances: ");
+	impostorInstancesSlider->SetSize(XMFLOAT2(100, 30));
+	impostorInstancesSlider->SetPos(XMFLOAT2(x, y += 30));
+	impostorInstancesSlider->OnSlide([&](wiEventArgs args) {
+		impostorSettings.minInstances = (uint32_t)args.fValue;
+	});
+	worldWindow->AddWidget(impostorInstancesSlider);
+
+	impostorErrorSlider = new wiSlider(0.5f, 16, impostorSettings.errorPixels, 31, "Impostor Error Pixels: ");
+	impostorErrorSlider->SetSize(XMFLOAT2(100, 30));
+	impostorErrorSlider->SetPos(XMFLOAT2(x, y += 30));
+	impostorErrorSlider->OnSlide([&](wiEventArgs args) {
+		impostorSettings.errorPixels = args.fValue;
+	});
+	worldWindow->AddWidget(impostorErrorSlider);
+
+	impostorBatchButton = new wiButton("Batch Impostors");
+	impostorBatchButton->SetSize(XMFLOAT2(240, 30));
+	impostorBatchButton->SetPos(XMFLOAT2(x - 50, y += 30));
+	impostorBatchButton->OnClick([&](wiEventArgs args) {
+		// The impostor distances are set on the meshes right away
+		sceneWriter.Wait();
+		size_t selected = impostorBatch.Start(impostorSettings);
+		stringstream ss("");
+		ss << "Impostors: " << selected << " meshes selected, " << (impostorBatch.GetTotalCount() - impostorBatch.GetCompletedCount()) << " to make";
+		wiBackLog::post(ss.str().c_str());
+	});
+	worldWindow->AddWidget(impostorBatchButton);
+
+	impostorProgressLabel = new wiLabel("ImpostorBatchProgress");
+	impostorProgressLabel->SetPos(XMFLOAT2(x - 50, y += 40));
+	impostorProgressLabel->SetSize(XMFLOAT2(240, 20));
+	impostorProgressLabel->SetText("");
+	worldWindow->AddWidget(impostorProgressLabel);
+
 
 
 
@@ -58,6 +109,11 @@ WorldWindow::~WorldWindow()
 	SAFE_DELETE(fogStartSlider);
 	SAFE_DELETE(fogEndSlider);
 	SAFE_DELETE(fogHeightSlider);
+	SAFE_DELETE(impostorTrianglesSlider);
+	SAFE_DELETE(impostorInstancesSlider);
+	SAFE_DELETE(impostorErrorSlider);
+	SAFE_DELETE(impostorBatchButton);
+	SAFE_DELETE(impostorProgressLabel);
 }
 
 void WorldWindow::UpdateFromRenderer()
@@ -68,3 +124,29 @@ void WorldWindow::UpdateFromRenderer()
 	fogEndSlider->SetValue(w.fogSEH.y);
 	fogHeightSlider->SetValue(w.fogSEH.z);
 }
+
+void WorldWindow::Update(float budget)
+{
+	if (impostorBatch.IsEmpty())
+	{
+		return;
+	}
+
+	impostorBatch.Update(budget);
+
+	if (impostorBatch.IsEmpty())
+	{
+		stringstream ss("");
+		if (!impostorBatch.GetAtlasPages().empty())
+		{
+			ss << "Impostor atlas: " << impostorBatch.GetAtlasPages().size() << " pages";
+		}
+		impostorProgressLabel->SetText(ss.str());
+	}
+	else
+	{
+		stringstream ss("");
+		ss << "Making impostors: " << impostorBatch.GetCompletedCount() << " / " << impostorBatch.GetTotalCount();
+		impostorProgressLabel->SetText(ss.str());
+	}
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include "ImpostorBatch.h"
 
 struct Material;
 class wiGUI;
@@ -6,6 +7,7 @@ class wiWindow;
 class wiLabel;
 class wiCheckBox;
 class wiSlider;
+class wiButton;
 
 class WorldWindow
 {
@@ -21,5 +23,17 @@ public:
 	wiSlider* fogStartSlider;
 	wiSlider* fogEndSlider;
 	wiSlider* fogHeightSlider;
+	wiSlider* impostorTrianglesSlider;
+	wiSlider* impostorInstancesSlider;
+	wiSlider* impostorErrorSlider;
+	wiButton* impostorBatchButton;
+	wiLabel* impostorProgressLabel;
+
+	// Impostors of the whole scene are made a few per frame through this
+	ImpostorBatch impostorBatch;
+	ImpostorBatch::Settings impostorSettings;
+
+	// Makes the impostors that fit in the budget (seconds) and shows the progress, called every frame
+	void Update(float budget);
 };
 
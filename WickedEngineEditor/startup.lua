@@ -37,10 +37,6 @@ runProcess(function()
 			ReloadShaders("D:\\PROJECTS\\DirectX\\WickedEngine\\WickedEngine\\shaders\\")
 		end
 		
-		if(input.Press(VK_F10)) then
-			PutEnvProbe(GetCamera().GetPosition(),256);
-		end
-		
 		if(input.Press(VK_F6)) then
 			main.GetActiveComponent().SetPreferredThreadingCount(4);
 		end
@@ -0,0 +1,138 @@
+#include "EditorCore.h"
+#include "FrameTimings.h"
+
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+using namespace DirectX;
+
+// Console runner of the editor core, builds on every platform
+//	Plays an input script through EditorCore without the engine: no window, no graphics device and no
+//	scene, the host prints what the editor would do and in which frame. The frame times are those of the
+//	core and the script, not of rendering.
+//	EditorRunner <script> [-orbital] [-timings <file.csv>]
+namespace
+{
+	class LogHost : public EditorCore::Host
+	{
+	public:
+		const ScriptedInput* input = nullptr;
+		bool fpsCamera = true;
+		bool clipboardEmpty = true;
+		int operationCount = 0;
+		int cameraFrameCount = 0;
+
+		void Log(const char* operation, const string& detail = "")
+		{
+			printf("frame %llu: %s%s%s\n", (unsigned long long)input->GetFrame(), operation, detail.empty() ? "" : " ", detail.c_str());
+			operationCount++;
+		}
+		static string Point(const XMFLOAT2& value)
+		{
+			char text[64];
+			snprintf(text, sizeof(text), "(%g, %g)", value.x, value.y);
+			return text;
+		}
+
+		bool IsFPSCamera() override { return fpsCamera; }
+		void UpdateCamera(const EditorCore::CameraControl& control) override
+		{
+			// a frame is only counted if the camera moves
+			if (control.move.x != 0 || control.move.y != 0 || control.move.z != 0 ||
+				control.rotation.x != 0 || control.rotation.y != 0 ||
+				control.pan.x != 0 || control.pan.y != 0 || control.zoom != 0)
+			{
+				cameraFrameCount++;
+			}
+		}
+		void Hover(const XMFLOAT2& pointer) override {}
+		void Select(bool additive) override { Log(additive ? "select additive" : "select"); }
+		void MarqueeSelect(const XMFLOAT2& start, const XMFLOAT2& end, bool additive) override
+		{
+			Log(additive ? "marquee select additive" : "marquee select", Point(start) + " " + Point(end));
+		}
+		void Delete() override { Log("delete"); }
+		void Copy() override
+		{
+			Log("copy");
+			clipboardEmpty = false;
+		}
+		void CopyToFile() override { Log("copy to file"); }
+		bool IsClipboardEmpty() override { return clipboardEmpty; }
+		void Paste() override { Log("paste"); }
+		void PasteFromFile() override { Log("paste from file"); }
+		void Duplicate() override { Log("duplicate"); }
+		void Undo() override { Log("undo"); }
+		void Redo() override { Log("redo"); }
+		void ToggleProfiler() override { Log("toggle profiler"); }
+		void WriteProfile() override { Log("write profile"); }
+		void PutProbe() override { Log("put probe"); }
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	string scriptFile, timingsFile;
+	bool orbital = false;
+	bool valid = true;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-timings") == 0 && i + 1 < argc)
+		{
+			timingsFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "-orbital") == 0)
+		{
+			orbital = true;
+		}
+		else if (argv[i][0] != '-' && scriptFile.empty())
+		{
+			scriptFile = argv[i];
+		}
+		else
+		{
+			valid = false;
+		}
+	}
+	if (!valid || scriptFile.empty())
+	{
+		printf("EditorRunner <script> [-orbital] [-timings <file.csv>]\n");
+		return 1;
+	}
+
+	ScriptedInput input;
+	if (!input.Load(scriptFile))
+	{
+		printf("%s\n", input.GetError().c_str());
+		return 1;
+	}
+
+	LogHost host;
+	host.input = &input;
+	host.fpsCamera = !orbital;
+	input.SetCommandCallback([&](const string& command, const string& argument) {
+		// there is no scene to load or save, the commands are only logged
+		host.Log(command.c_str(), argument);
+	});
+
+	EditorCore core(&host);
+	FrameTimings timings;
+	while (!input.IsFinished())
+	{
+		input.Update();
+		core.Update(input);
+		timings.Frame();
+	}
+
+	printf("%d operations, the camera moved in %d frames\n", host.operationCount, host.cameraFrameCount);
+	printf("%s\n", timings.GetSummary().c_str());
+	if (!timingsFile.empty() && !timings.WriteCSV(timingsFile))
+	{
+		printf("Could not write %s\n", timingsFile.c_str());
+		return 1;
+	}
+	return 0;
+}
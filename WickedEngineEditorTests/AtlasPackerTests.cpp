@@ -0,0 +1,69 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "AtlasPacker.h"
+
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+namespace
+{
+	bool Overlap(const AtlasPacker::Rect& a, const AtlasPacker::Rect& b, uint32_t padding)
+	{
+		return a.page == b.page && a.x < b.x + b.width + padding && b.x < a.x + a.width + padding &&
+			a.y < b.y + b.height + padding && b.y < a.y + a.height + padding;
+	}
+}
+
+// Impostors of a forested level: mostly one size, a few bigger ones
+TEST(AtlasPacker_RectsStayInsideAndApart)
+{
+	vector<pair<uint32_t, uint32_t>> sizes;
+	for (int i = 0; i < 300; ++i)
+	{
+		sizes.push_back(i % 10 == 0 ? make_pair(768u, 128u) : make_pair(384u, 64u));
+	}
+	AtlasPacker packer(2048, 2);
+	vector<AtlasPacker::Rect> rects;
+	CHECK(packer.Pack(sizes, rects));
+	CHECK_EQUAL(sizes.size(), rects.size());
+
+	bool inside = true, apart = true, sized = true;
+	for (size_t i = 0; i < rects.size(); ++i)
+	{
+		const AtlasPacker::Rect& rect = rects[i];
+		inside = inside && rect.page < packer.GetPageCount() && rect.x + rect.width <= 2048 && rect.y + rect.height <= 2048;
+		sized = sized && rect.width == sizes[i].first && rect.height == sizes[i].second;
+		for (size_t j = 0; j < i; ++j)
+		{
+			apart = apart && !Overlap(rect, rects[j], 2);
+		}
+	}
+	CHECK(inside);
+	CHECK(apart);
+	CHECK(sized);
+	// 270 * 386 * 66 + 30 * 770 * 130 texels with the padding are 2.4 pages, the shelves waste less than one
+	CHECK_EQUAL(3u, packer.GetPageCount());
+}
+
+TEST(AtlasPacker_UVAndTooBig)
+{
+	AtlasPacker packer(1024, 0);
+	vector<AtlasPacker::Rect> rects;
+	vector<pair<uint32_t, uint32_t>> sizes = { make_pair(512u, 256u), make_pair(512u, 256u), make_pair(256u, 256u) };
+	CHECK(packer.Pack(sizes, rects));
+	CHECK_EQUAL(1u, packer.GetPageCount());
+	// the two wide ones share the first shelf
+	CHECK_EQUAL(0u, rects[0].y);
+	CHECK_EQUAL(0u, rects[1].y);
+	CHECK_EQUAL(512u, rects[1].x);
+	DirectX::XMFLOAT4 uv = packer.GetUV(rects[1]);
+	CHECK_EQUAL(0.5f, uv.x);
+	CHECK_EQUAL(0.0f, uv.y);
+	CHECK_EQUAL(0.5f, uv.z);
+	CHECK_EQUAL(0.25f, uv.w);
+
+	sizes.push_back(make_pair(2048u, 16u));
+	CHECK(!packer.Pack(sizes, rects));
+}
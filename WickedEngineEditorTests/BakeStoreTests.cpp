@@ -0,0 +1,94 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "BakeStore.h"
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+
+using namespace std;
+
+namespace
+{
+	// Stands in for rendering a probe and saving its cubemap
+	bool WriteBlob(const string& fileName, const string& data)
+	{
+		ofstream file(fileName, ios::binary | ios::trunc);
+		file << data;
+		return file.good();
+	}
+	string ReadBlob(const string& fileName)
+	{
+		ifstream file(fileName, ios::binary);
+		return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	}
+}
+
+TEST(BakeStore_HitDoesNotBake)
+{
+	CreateDirectoryA("temp", nullptr);
+	BakeStore store("temp/bakes/");
+	const uint64_t key = 0x0123456789abcdefull;
+	remove(store.GetFileName(key).c_str());
+	CHECK(!store.Contains(key));
+
+	int bakes = 0;
+	string restored;
+	auto restore = [&](const string& fileName) {
+		restored = ReadBlob(fileName);
+		return true;
+	};
+	auto bake = [&](const string& fileName) {
+		bakes++;
+		return WriteBlob(fileName, "cubemap");
+	};
+
+	CHECK(!store.Restore(key, restore, bake));
+	CHECK_EQUAL(1, bakes);
+	CHECK(store.Contains(key));
+	CHECK(restored.empty());
+
+	// the same key, in this session or after a restart, is loaded from the disk
+	CHECK(store.Restore(key, restore, bake));
+	CHECK_EQUAL(1, bakes);
+	CHECK(restored == "cubemap");
+	BakeStore restarted("temp/bakes/");
+	CHECK(restarted.Restore(key, restore, bake));
+	CHECK_EQUAL(1, bakes);
+	CHECK_EQUAL(2u, store.GetHitCount() + restarted.GetHitCount());
+
+	// an other key is an other scene
+	CHECK(!store.Restore(key + 1, restore, bake));
+	CHECK_EQUAL(2, bakes);
+
+	remove(store.GetFileName(key).c_str());
+	remove(store.GetFileName(key + 1).c_str());
+}
+
+TEST(BakeStore_BadFilesAreBakedAgain)
+{
+	CreateDirectoryA("temp", nullptr);
+	CreateDirectoryA("temp/bakes", nullptr);
+	BakeStore store("temp/bakes/");
+	const uint64_t key = 42;
+	CHECK(WriteBlob(store.GetFileName(key), "wrong resolution"));
+
+	int bakes = 0;
+	// the file doesn't load: it is deleted and baked again
+	CHECK(!store.Restore(key, [](const string&) { return false; }, [&](const string& fileName) {
+		bakes++;
+		return WriteBlob(fileName, "cubemap");
+	}));
+	CHECK_EQUAL(1, bakes);
+	CHECK(ReadBlob(store.GetFileName(key)) == "cubemap");
+
+	// a bake that could not save leaves nothing behind
+	remove(store.GetFileName(key).c_str());
+	CHECK(!store.Restore(key, [](const string&) { return true; }, [&](const string& fileName) {
+		bakes++;
+		WriteBlob(fileName, "half");
+		return false;
+	}));
+	CHECK_EQUAL(2, bakes);
+	CHECK(!store.Contains(key));
+}
@@ -0,0 +1,161 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "ContentCache.h"
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+// The resources are tracked without an owner, so nothing is loaded and evicting only drops the entry
+TEST(ContentCache_EvictsLeastRecentlyUsed)
+{
+	string a = "cache_a", b = "cache_b", c = "cache_c";
+
+	ContentCache cache(nullptr, 2500);
+	cache.Track(a, nullptr, 1000);
+	cache.Track(b, nullptr, 1000);
+	cache.Track(c, nullptr, 1000);
+	// over budget, but everything is referenced
+	CHECK_EQUAL(3000u, cache.GetStats().resident);
+	CHECK_EQUAL(0u, cache.GetStats().evictions);
+
+	cache.Release(a);
+	CHECK_EQUAL(1u, cache.GetStats().evictions);
+	CHECK_EQUAL(2000u, cache.GetStats().resident);
+
+	// b is released before c, so b goes first when the budget shrinks
+	cache.Release(b);
+	cache.Release(c);
+	CHECK_EQUAL(2000u, cache.GetStats().resident);
+	CHECK_EQUAL(0u, cache.GetStats().referenced);
+	cache.SetBudget(1500);
+	CHECK_EQUAL(2u, cache.GetStats().evictions);
+	CHECK_EQUAL(1u, cache.GetStats().count);
+
+	// a hit keeps the size that the resource was first tracked with
+	size_t hits = cache.GetStats().hits;
+	cache.Track(c, nullptr, 5000);
+	CHECK_EQUAL(hits + 1, cache.GetStats().hits);
+	CHECK_EQUAL(1000u, cache.GetStats().referenced);
+	size_t misses = cache.GetStats().misses;
+	cache.Track(b, nullptr, 1000);
+	CHECK_EQUAL(misses + 1, cache.GetStats().misses);
+
+	// releasing more often than referenced is ignored
+	cache.Release(b);
+	cache.Release(b);
+	cache.Release(c);
+	cache.Trim();
+	CHECK_EQUAL(0u, cache.GetStats().count);
+	CHECK_EQUAL(0u, cache.GetStats().resident);
+}
+
+// Switches between levels that share some of their textures, the way ClearWorld and a load do: the new
+//	level references its textures, then the old level releases its own. Memory must plateau at the budget
+//	(or at the current level, if that alone is bigger) however long this runs.
+TEST(ContentCache_LevelSwitchingSoak)
+{
+	const int levelCount = 8, texturesPerLevel = 50, sharedPerLevel = 10, switchCount = 400;
+
+	vector<pair<string, size_t>> shared;
+	for (int i = 0; i < sharedPerLevel; ++i)
+	{
+		stringstream ss("");
+		ss << "soak_shared" << i;
+		shared.push_back(make_pair(ss.str(), (size_t)2048));
+	}
+	vector<vector<pair<string, size_t>>> levels(levelCount);
+	vector<size_t> levelSizes(levelCount, 0);
+	for (int l = 0; l < levelCount; ++l)
+	{
+		levels[l] = shared;
+		levelSizes[l] = shared.size() * 2048;
+		for (int i = 0; i < texturesPerLevel; ++i)
+		{
+			stringstream ss("");
+			ss << "soak_level" << l << "_" << i;
+			size_t size = 1024 * (1 + (l + i) % 8);
+			levels[l].push_back(make_pair(ss.str(), size));
+			levelSizes[l] += size;
+		}
+	}
+
+	const size_t budget = 512 * 1024;
+	ContentCache cache(nullptr, budget);
+	int current = -1;
+	uint32_t state = 12345;
+	size_t peak = 0, lastHalfPeak = 0, firstHalfPeak = 0;
+	for (int s = 0; s < switchCount; ++s)
+	{
+		state = state * 1664525u + 1013904223u;
+		int next = (int)((state >> 16) % levelCount);
+
+		for (auto& x : levels[next])
+		{
+			cache.Track(x.first, nullptr, x.second);
+		}
+		if (current >= 0)
+		{
+			for (auto& x : levels[current])
+			{
+				cache.Release(x.first);
+			}
+		}
+		current = next;
+
+		const ContentCache::Stats& stats = cache.GetStats();
+		CHECK_EQUAL(levelSizes[current], stats.referenced);
+		CHECK(stats.resident <= max(budget, stats.referenced));
+		peak = max(peak, stats.resident);
+		if (s < switchCount / 2)
+		{
+			firstHalfPeak = max(firstHalfPeak, stats.resident);
+		}
+		else
+		{
+			lastHalfPeak = max(lastHalfPeak, stats.resident);
+		}
+	}
+	// no growth after the cache has filled up
+	CHECK(lastHalfPeak <= firstHalfPeak);
+	CHECK(cache.GetStats().hits > 0);
+	CHECK(cache.GetStats().evictions > 0);
+
+	stringstream ss("");
+	ss << switchCount << " level switches: peak " << peak / 1024 << " KB (budget " << budget / 1024 << " KB), "
+		<< cache.GetStats().hits << " hits, " << cache.GetStats().misses << " misses, " << cache.GetStats().evictions << " evictions";
+	Tests::Report(ss.str());
+}
+
+// The memory cost of a texture comes from its description, not from a file next to the executable
+TEST(ContentCache_TextureSizeFromDescription)
+{
+	wiGraphicsTypes::Texture2D texture;
+	texture.desc.Width = 1024;
+	texture.desc.Height = 512;
+	texture.desc.ArraySize = 1;
+	texture.desc.MipLevels = 1;
+	texture.desc.Format = wiGraphicsTypes::FORMAT_R8G8B8A8_UNORM;
+	CHECK_EQUAL(1024u * 512u * 4u, ContentCache::GetTextureSize(&texture));
+
+	// half a byte per texel, the small mips take a whole 4x4 block: 11 levels down to 1x1
+	texture.desc.Format = wiGraphicsTypes::FORMAT_BC1_UNORM;
+	texture.desc.MipLevels = 0;
+	size_t expected = 0;
+	for (size_t w = 1024, h = 512; w > 0; w /= 2, h /= 2)
+	{
+		expected += ((max(w, (size_t)1) + 3) / 4) * ((max(h, (size_t)1) + 3) / 4) * 8;
+	}
+	CHECK_EQUAL(expected, ContentCache::GetTextureSize(&texture));
+
+	// a cubemap is six slices
+	texture.desc.Format = wiGraphicsTypes::FORMAT_R8G8B8A8_UNORM;
+	texture.desc.MipLevels = 1;
+	texture.desc.ArraySize = 6;
+	CHECK_EQUAL(6u * 1024u * 512u * 4u, ContentCache::GetTextureSize(&texture));
+	CHECK_EQUAL(0u, ContentCache::GetTextureSize(nullptr));
+}
@@ -0,0 +1,231 @@
+#include "Tests.h"
+#include "EditorCore.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+
+using namespace std;
+using namespace DirectX;
+
+namespace
+{
+	// Remembers what the core asked for, one string per operation
+	class RecordingHost : public EditorCore::Host
+	{
+	public:
+		vector<string> operations;
+		vector<EditorCore::CameraControl> cameras;
+		bool fpsCamera = true;
+		bool clipboardEmpty = true;
+		XMFLOAT2 marqueeStart = XMFLOAT2(0, 0), marqueeEnd = XMFLOAT2(0, 0);
+
+		bool IsFPSCamera() override { return fpsCamera; }
+		void UpdateCamera(const EditorCore::CameraControl& control) override { cameras.push_back(control); }
+		void Hover(const XMFLOAT2& pointer) override {}
+		void Select(bool additive) override { operations.push_back(additive ? "select additive" : "select"); }
+		void MarqueeSelect(const XMFLOAT2& start, const XMFLOAT2& end, bool additive) override
+		{
+			operations.push_back(additive ? "marquee additive" : "marquee");
+			marqueeStart = start;
+			marqueeEnd = end;
+		}
+		void Delete() override { operations.push_back("delete"); }
+		void Copy() override { operations.push_back("copy"); }
+		void CopyToFile() override { operations.push_back("copy to file"); }
+		bool IsClipboardEmpty() override { return clipboardEmpty; }
+		void Paste() override { operations.push_back("paste"); }
+		void PasteFromFile() override { operations.push_back("paste from file"); }
+		void Duplicate() override { operations.push_back("duplicate"); }
+		void Undo() override { operations.push_back("undo"); }
+		void Redo() override { operations.push_back("redo"); }
+		void ToggleProfiler() override { operations.push_back("toggle profiler"); }
+		void WriteProfile() override { operations.push_back("write profile"); }
+		void PutProbe() override { operations.push_back("put probe"); }
+	};
+
+	// Writes the script and plays it through the core until it is finished
+	bool Run(const string& script, EditorCore& core, ScriptedInput& input)
+	{
+		{
+			ofstream file("temp_editorcore.txt", ios::trunc);
+			file << script;
+		}
+		bool loaded = input.Load("temp_editorcore.txt");
+		remove("temp_editorcore.txt");
+		if (!loaded)
+		{
+			return false;
+		}
+		while (!input.IsFinished())
+		{
+			input.Update();
+			core.Update(input);
+		}
+		return true;
+	}
+	bool Run(const string& script, RecordingHost& host)
+	{
+		EditorCore core(&host);
+		ScriptedInput input;
+		return Run(script, core, input);
+	}
+}
+
+TEST(EditorCore_RightClickSelects)
+{
+	RecordingHost host;
+	// the button goes up in the second frame
+	CHECK(Run("move 100 100\ntap RBUTTON\nwait 2\n", host));
+	CHECK(host.operations == vector<string>{ "select" });
+}
+
+TEST(EditorCore_ShortDragIsAClick)
+{
+	RecordingHost host;
+	CHECK(Run("move 100 100\ndown RBUTTON\nwait 1\nmove 103 97\nup RBUTTON\nwait 1\n", host));
+	CHECK(host.operations == vector<string>{ "select" });
+}
+
+TEST(EditorCore_RightDragSelectsMarquee)
+{
+	RecordingHost host;
+	EditorCore core(&host);
+	ScriptedInput input;
+	CHECK(Run("move 100 100\ndown RBUTTON\nwait 1\nmove 150 180\nwait 1\n", core, input));
+	// still dragging, the editor draws the rectangle from here
+	CHECK(core.IsMarqueeActive());
+	CHECK_EQUAL(100.0f, core.GetMarqueeStart().x);
+	CHECK(host.operations.empty());
+
+	CHECK(Run("down LSHIFT\nup RBUTTON\nwait 1\n", core, input));
+	CHECK(!core.IsMarqueeActive());
+	CHECK(host.operations == vector<string>{ "marquee additive" });
+	CHECK_EQUAL(100.0f, host.marqueeStart.y);
+	CHECK_EQUAL(150.0f, host.marqueeEnd.x);
+	CHECK_EQUAL(180.0f, host.marqueeEnd.y);
+}
+
+TEST(EditorCore_ShiftClickIsAdditive)
+{
+	RecordingHost host;
+	CHECK(Run("down LSHIFT\ntap RBUTTON\nwait 2\n", host));
+	CHECK(host.operations == vector<string>{ "select additive" });
+}
+
+TEST(EditorCore_Shortcuts)
+{
+	RecordingHost host;
+	CHECK(Run(
+		"tap DELETE\nwait 1\n"
+		"down CONTROL\n"
+		"tap C\nwait 1\n"
+		"tap D\nwait 1\n"
+		"tap Z\nwait 1\n"
+		"tap Y\nwait 1\n"
+		"down SHIFT\ntap C\nwait 1\nup SHIFT\n"
+		"up CONTROL\nwait 1\n"
+		"tap F2\ntap F3\ntap F10\nwait 1\n", host));
+	vector<string> expected = { "delete", "copy", "duplicate", "undo", "redo", "copy to file", "toggle profiler", "write profile", "put probe" };
+	CHECK(host.operations == expected);
+}
+
+TEST(EditorCore_PasteFallsBackToTheFile)
+{
+	// a tapped key is up for a frame before it can be tapped again
+	const string script = "down CONTROL\ntap V\nwait 2\ndown SHIFT\ntap V\nwait 1\n";
+	{
+		RecordingHost host;
+		CHECK(Run(script, host));
+		vector<string> expected = { "paste from file", "paste from file" };
+		CHECK(host.operations == expected);
+	}
+	{
+		RecordingHost host;
+		host.clipboardEmpty = false;
+		CHECK(Run(script, host));
+		vector<string> expected = { "paste", "paste from file" };
+		CHECK(host.operations == expected);
+	}
+}
+
+TEST(EditorCore_HeldKeyRunsOnce)
+{
+	RecordingHost host;
+	CHECK(Run("down CONTROL\ndown Z\nwait 10\n", host));
+	CHECK_EQUAL(1u, host.operations.size());
+}
+
+TEST(EditorCore_FPSCameraMoves)
+{
+	RecordingHost host;
+	CHECK(Run("down W\nwait 2\nup W\ndown SHIFT\ndown A\nwait 1\ndown CONTROL\nwait 1\n", host));
+	CHECK_EQUAL(4u, host.cameras.size());
+	CHECK_EQUAL(0.1f, host.cameras[0].move.z);
+	CHECK_EQUAL(0.1f, host.cameras[1].move.z);
+	CHECK_EQUAL(-1.0f, host.cameras[2].move.x);
+	CHECK_EQUAL(0.0f, host.cameras[2].move.z);
+	// control is held for the shortcuts
+	CHECK_EQUAL(0.0f, host.cameras[3].move.x);
+}
+
+TEST(EditorCore_MiddleDragTurnsAndHoldsThePointer)
+{
+	RecordingHost host;
+	EditorCore core(&host);
+	ScriptedInput input;
+	CHECK(Run("move 100 100\nwait 1\ndown MBUTTON\nmove 160 130\nwait 1\n", core, input));
+	CHECK_EQUAL(2u, host.cameras.size());
+	CHECK_EQUAL(0.0f, host.cameras[0].rotation.x);
+	// pitch from the vertical, yaw from the horizontal movement
+	CHECK(fabs(host.cameras[1].rotation.x - 0.1f * 30 / 60) < 1e-6f);
+	CHECK(fabs(host.cameras[1].rotation.y - 0.1f * 60 / 60) < 1e-6f);
+	// the pointer is put back where the drag started
+	CHECK_EQUAL(100.0f, input.GetPointer().x);
+	CHECK_EQUAL(100.0f, input.GetPointer().y);
+}
+
+TEST(EditorCore_OrbitalCamera)
+{
+	RecordingHost host;
+	host.fpsCamera = false;
+	CHECK(Run("move 100 100\nwait 1\ndown MBUTTON\nmove 100 160\nwait 1\nmove 100 160\ndown LCONTROL\nwait 1\nmove 160 100\nup LCONTROL\ndown LSHIFT\nwait 1\n", host));
+	CHECK_EQUAL(4u, host.cameras.size());
+	CHECK(fabs(host.cameras[1].rotation.x - 0.1f * 60 / 60 * 2) < 1e-6f);
+	CHECK(fabs(host.cameras[2].zoom - 0.1f * 60 / 60 * 4) < 1e-6f);
+	CHECK_EQUAL(0.0f, host.cameras[2].rotation.x);
+	CHECK(fabs(host.cameras[3].pan.x - 0.1f * 60 / 60 * 10) < 1e-6f);
+}
+
+TEST(EditorCore_ScriptCommands)
+{
+	RecordingHost host;
+	EditorCore core(&host);
+	ScriptedInput input;
+	vector<string> commands;
+	input.SetCommandCallback([&](const string& command, const string& argument) {
+		commands.push_back(command + " " + argument);
+		// the scene is saved before the frame's input is handled
+		CHECK(host.operations.empty());
+	});
+	CHECK(Run("load scene.wiscene\ntap DELETE\nsave out.wiscene\nwait 1\n", core, input));
+	vector<string> expected = { "load scene.wiscene", "save out.wiscene" };
+	CHECK(commands == expected);
+	CHECK_EQUAL(1u, host.operations.size());
+}
+
+TEST(EditorCore_InvalidScript)
+{
+	ScriptedInput input;
+	{
+		ofstream file("temp_editorcore.txt", ios::trunc);
+		file << "wait 1\ndown NOSUCHKEY\n";
+	}
+	CHECK(!input.Load("temp_editorcore.txt"));
+	remove("temp_editorcore.txt");
+	CHECK(input.GetError().find("(2)") != string::npos);
+	CHECK(!input.Load("temp_editorcore_missing.txt"));
+	CHECK(!input.GetError().empty());
+}
@@ -0,0 +1,117 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "EngineInput.h"
+
+#include <vector>
+#include <fstream>
+#include <cstdio>
+
+using namespace std;
+
+namespace
+{
+	struct RecordingWriter
+	{
+		ofstream file;
+
+		RecordingWriter(const string& fileName, uint32_t version) :file(fileName, ios::binary | ios::trunc)
+		{
+			InputRecording::Header header;
+			header.magic = InputRecording::MAGIC;
+			header.version = version;
+			file.write((const char*)&header, sizeof(header));
+		}
+		void Frame(float x, float y, uint8_t flags, const vector<uint8_t>& keys)
+		{
+			uint8_t count = (uint8_t)keys.size();
+			file.write((const char*)&x, sizeof(x));
+			file.write((const char*)&y, sizeof(y));
+			file.write((const char*)&flags, sizeof(flags));
+			file.write((const char*)&count, sizeof(count));
+			file.write((const char*)keys.data(), keys.size());
+		}
+		void Translator(uint8_t flags, const vector<XMFLOAT4X4>& matrices)
+		{
+			file.write((const char*)&flags, sizeof(flags));
+			file.write((const char*)matrices.data(), sizeof(XMFLOAT4X4) * matrices.size());
+		}
+	};
+
+	XMFLOAT4X4 Translation(float x, float y, float z)
+	{
+		XMFLOAT4X4 m;
+		XMStoreFloat4x4(&m, XMMatrixTranslation(x, y, z));
+		return m;
+	}
+}
+
+TEST(ReplayInput_PlaysKeysPointerAndDrags)
+{
+	{
+		RecordingWriter writer("temp_replay_v2.wiir", InputRecording::VERSION);
+		writer.Frame(10, 20, 0, { VK_LBUTTON });
+		writer.Translator(0, {});
+		writer.Frame(11, 21, InputRecording::FRAME_BACKLOG_ACTIVE, { VK_LBUTTON, 'W' });
+		writer.Translator(InputRecording::TRANSLATOR_DRAG_ENDED, { Translation(1, 2, 3), Translation(4, 5, 6) });
+		// cut in half, the editor was killed while recording
+		writer.Frame(12, 22, 0, {});
+	}
+
+	ReplayInput input;
+	CHECK(input.Load("temp_replay_v2.wiir"));
+	XMFLOAT4X4 dragStart, dragEnd;
+	CHECK(!input.IsFinished());
+
+	input.Update();
+	CHECK(input.Down(VK_LBUTTON));
+	CHECK(input.Press(VK_LBUTTON));
+	CHECK(!input.Down('W'));
+	CHECK_EQUAL(10.0f, input.GetPointer().x);
+	CHECK(!input.IsBacklogActive());
+	CHECK(!input.UpdateTranslator(nullptr, dragStart, dragEnd));
+
+	input.Update();
+	CHECK(input.Down(VK_LBUTTON));
+	CHECK(!input.Press(VK_LBUTTON));
+	CHECK(input.Press('W'));
+	CHECK_EQUAL(21.0f, input.GetPointer().y);
+	CHECK(input.IsBacklogActive());
+	CHECK(input.UpdateTranslator(nullptr, dragStart, dragEnd));
+	CHECK_EQUAL(3.0f, dragStart._43);
+	CHECK_EQUAL(4.0f, dragEnd._41);
+	CHECK(input.IsFinished());
+
+	// the last frame is not played again, the drag doesn't end twice
+	input.Update();
+	CHECK(!input.Down(VK_LBUTTON));
+	CHECK(!input.UpdateTranslator(nullptr, dragStart, dragEnd));
+
+	remove("temp_replay_v2.wiir");
+}
+
+TEST(ReplayInput_LoadsVersion1)
+{
+	{
+		RecordingWriter writer("temp_replay_v1.wiir", 1);
+		writer.Frame(1, 2, 0, { 'A' });
+		writer.Frame(3, 4, 0, {});
+	}
+
+	ReplayInput input;
+	CHECK(input.Load("temp_replay_v1.wiir"));
+	XMFLOAT4X4 dragStart, dragEnd;
+	input.Update();
+	CHECK(input.Press('A'));
+	CHECK(!input.UpdateTranslator(nullptr, dragStart, dragEnd));
+	input.Update();
+	CHECK_EQUAL(3.0f, input.GetPointer().x);
+	CHECK(input.IsFinished());
+
+	// newer versions are refused
+	{
+		RecordingWriter writer("temp_replay_v1.wiir", InputRecording::VERSION + 1);
+	}
+	CHECK(!input.Load("temp_replay_v1.wiir"));
+
+	remove("temp_replay_v1.wiir");
+}
@@ -0,0 +1,249 @@
+#include "Tests.h"
+#include "HistoryJournal.h"
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+
+namespace
+{
+	// Stands in for the scene: every operation sets one value, the record holds the old and the new
+	//	value and a payload of random size, so that the arena wraps around and records get evicted
+	struct Document
+	{
+		vector<int> values;
+
+		Document() :values(64, 0) {}
+		bool operator==(const Document& other) const { return values == other.values; }
+	};
+
+	void Record(HistoryJournal& journal, Document& document, mt19937& random)
+	{
+		uint32_t index = random() % document.values.size();
+		int value = (int)(random() % 1000);
+		string payload(random() % 700, (char)('a' + index % 26));
+
+		HistoryJournal::Record& record = journal.Begin();
+		record << index << document.values[index] << value << payload;
+		document.values[index] = value;
+		journal.End();
+	}
+	void Replay(HistoryJournal::Record& record, Document& document, bool undo)
+	{
+		uint32_t index;
+		int before, after;
+		string payload;
+		record >> index >> before >> after >> payload;
+		CHECK(record.IsEnd());
+		CHECK(payload.empty() || payload[0] == (char)('a' + index % 26));
+		document.values[index] = undo ? before : after;
+	}
+
+	// Random operations, undos and redos, checked against every state the document went through.
+	//	Only the states that the journal still has records for can be reached.
+	void RunRecordReplay(HistoryJournal& journal, uint32_t seed)
+	{
+		mt19937 random(seed);
+		Document document;
+		vector<Document> states(1, document);
+		size_t current = 0;
+
+		for (int step = 0; step < 5000; ++step)
+		{
+			uint32_t action = random() % 10;
+			if (action < 5)
+			{
+				Record(journal, document, random);
+				states.resize(current + 1);
+				states.push_back(document);
+				current++;
+			}
+			else if (action < 8)
+			{
+				HistoryJournal::Record* record = journal.Undo();
+				if (record != nullptr)
+				{
+					Replay(*record, document, true);
+					CHECK(current > 0);
+					current--;
+				}
+			}
+			else
+			{
+				HistoryJournal::Record* record = journal.Redo();
+				if (record != nullptr)
+				{
+					Replay(*record, document, false);
+					CHECK(current + 1 < states.size());
+					current++;
+				}
+				else
+				{
+					CHECK(current + 1 == states.size());
+				}
+			}
+			CHECK(document == states[current]);
+			if (!(document == states[current]))
+			{
+				return;
+			}
+		}
+	}
+}
+
+TEST(HistoryJournal_RecordReplay)
+{
+	HistoryJournal journal(1024 * 1024);
+	RunRecordReplay(journal, 1);
+	CHECK_EQUAL(0u, journal.GetStats().spilledCount);
+}
+
+TEST(HistoryJournal_RecordReplayWithSpill)
+{
+	// A small arena, the oldest records go to the disk and come back from there
+	HistoryJournal journal(8 * 1024);
+	journal.SetSpillDirectory("./", 4096);
+	RunRecordReplay(journal, 2);
+	CHECK(journal.GetStats().spilledCount > 0);
+	CHECK(journal.GetStats().arenaUsed <= 8 * 1024);
+}
+
+TEST(HistoryJournal_RecordReplayWithEviction)
+{
+	// No spilling: the oldest records are dropped, undo stops early but stays consistent
+	HistoryJournal journal(8 * 1024);
+	RunRecordReplay(journal, 3);
+	CHECK_EQUAL(0u, journal.GetStats().spilledCount);
+}
+
+TEST(HistoryJournal_OversizedRecord)
+{
+	HistoryJournal journal(1024);
+	vector<uint64_t> discarded;
+	journal.SetDiscardCallback([&](uint64_t id) { discarded.push_back(id); });
+
+	HistoryJournal::Record& small = journal.Begin();
+	small << 1;
+	CHECK(journal.End());
+
+	// Doesn't fit the arena and can't be spilled: End() reports it
+	HistoryJournal::Record& large = journal.Begin();
+	uint64_t id = large.GetID();
+	large << string(4096, 'x');
+	CHECK(!journal.End());
+	CHECK(!discarded.empty() && discarded.back() == id);
+}
+
+TEST(HistoryJournal_OversizedRecordsKeepTheSpillCap)
+{
+	HistoryJournal journal(1024);
+	journal.SetSpillDirectory("./", 3);
+	for (int i = 0; i < 10; ++i)
+	{
+		HistoryJournal::Record& record = journal.Begin();
+		record << string(4096, (char)('a' + i));
+		CHECK(journal.End());
+	}
+	CHECK_EQUAL(3u, journal.GetStats().recordCount);
+	CHECK_EQUAL(3u, journal.GetStats().spilledCount);
+	// the newest ones are kept
+	string data;
+	*journal.Undo() >> data;
+	CHECK_EQUAL('j', data[0]);
+}
+
+TEST(HistoryJournal_ShrinkingKeepsRedoInOrder)
+{
+	HistoryJournal journal(4096);
+	for (int i = 0; i < 8; ++i)
+	{
+		HistoryJournal::Record& record = journal.Begin();
+		record << i << string(400, 'x');
+		CHECK(journal.End());
+	}
+	for (int i = 0; i < 4; ++i)
+	{
+		CHECK(journal.Undo() != nullptr);
+	}
+	CHECK(journal.CanRedo());
+
+	// the oldest records have to go: the redo branch is dropped with them rather than left with a gap
+	journal.SetBudget(1024);
+	CHECK(!journal.CanRedo());
+	CHECK(journal.GetStats().arenaUsed <= 1024);
+	int expected = 3, undone = 0;
+	while (HistoryJournal::Record* record = journal.Undo())
+	{
+		int i;
+		*record >> i;
+		CHECK_EQUAL(expected, i);
+		expected--;
+		undone++;
+	}
+	CHECK(undone > 0);
+}
+
+TEST(HistoryJournal_LostSpillFileIsNotReplayed)
+{
+	HistoryJournal journal(1024);
+	journal.SetSpillDirectory("temp_history_", 16);
+	vector<uint64_t> discarded;
+	journal.SetDiscardCallback([&](uint64_t id) { discarded.push_back(id); });
+	for (int i = 0; i < 6; ++i)
+	{
+		HistoryJournal::Record& record = journal.Begin();
+		record << i << string(400, 'x');
+		CHECK(journal.End());
+	}
+	CHECK(journal.GetStats().spilledCount > 0);
+	size_t spilled = journal.GetStats().spilledCount;
+
+	// the spill files are gone, e.g. the temp directory was cleaned
+	for (size_t i = 0; i < 6; ++i)
+	{
+		stringstream ss("");
+		ss << "temp_history_history" << i;
+		remove(ss.str().c_str());
+	}
+	size_t undone = 0;
+	while (HistoryJournal::Record* record = journal.Undo())
+	{
+		int i;
+		*record >> i;
+		CHECK_EQUAL(5 - (int)undone, i);
+		undone++;
+	}
+	CHECK_EQUAL(6 - spilled, undone);
+	CHECK(!journal.CanUndo());
+	CHECK_EQUAL(spilled, discarded.size());
+}
+
+BENCHMARK(HistoryJournal_UndoRedo)
+{
+	HistoryJournal journal(64 * 1024 * 1024);
+	mt19937 random(4);
+	Document document;
+	const int count = 20000;
+	for (int i = 0; i < count; ++i)
+	{
+		Record(journal, document, random);
+	}
+
+	auto start = chrono::high_resolution_clock::now();
+	while (HistoryJournal::Record* record = journal.Undo())
+	{
+		Replay(*record, document, true);
+	}
+	while (HistoryJournal::Record* record = journal.Redo())
+	{
+		Replay(*record, document, false);
+	}
+	double us = chrono::duration<double, micro>(chrono::high_resolution_clock::now() - start).count();
+
+	stringstream ss;
+	ss << count << " undos and redos, " << us / (2 * count) << " us per step";
+	Tests::Report(ss.str());
+}
@@ -0,0 +1,113 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "IconBatch.h"
+
+#include <vector>
+#include <random>
+#include <chrono>
+
+using namespace std;
+using namespace DirectX;
+
+namespace
+{
+	// Identity view-projection: the frustum is the clip space box, x and y in [-1, 1], z in [0, 1]
+	XMFLOAT4X4 Identity()
+	{
+		XMFLOAT4X4 m;
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				m.m[r][c] = r == c ? 1.0f : 0.0f;
+			}
+		}
+		return m;
+	}
+}
+
+TEST(IconBatch_CullAndSortByTexture)
+{
+	IconBatch batch;
+	batch.Begin(Identity(), 3);
+
+	// texture, position, expected to be visible
+	struct Icon
+	{
+		uint32_t texture;
+		XMFLOAT3 position;
+		bool visible;
+	};
+	const Icon icons[] = {
+		{ 2, XMFLOAT3(0, 0, 0.5f), true },
+		{ 0, XMFLOAT3(0.5f, 0.5f, 0.5f), true },
+		{ 2, XMFLOAT3(-0.9f, 0, 0.1f), true },
+		{ 1, XMFLOAT3(3, 0, 0.5f), false },		// right of the frustum
+		{ 0, XMFLOAT3(0, 0, -2), false },		// behind the camera
+		{ 2, XMFLOAT3(1.05f, 0, 0.5f), true },	// center outside, but the icon reaches in
+		{ 0, XMFLOAT3(0, -0.2f, 0.9f), true },
+		{ 7, XMFLOAT3(0, 0, 0.5f), false },		// unknown texture, ignored
+	};
+	uint32_t expectedCulled = 0;
+	for (size_t i = 0; i < _countof(icons); ++i)
+	{
+		batch.Add(icons[i].texture, icons[i].position, 0.2f, XMFLOAT4((float)i, 0, 0, 1));
+		expectedCulled += (!icons[i].visible && icons[i].texture < 3) ? 1 : 0;
+	}
+	batch.End();
+
+	CHECK_EQUAL(expectedCulled, batch.GetCulledCount());
+	const vector<IconBatch::Instance>& instances = batch.GetInstances();
+	const vector<IconBatch::Batch>& batches = batch.GetBatches();
+	CHECK_EQUAL((size_t)5, instances.size());
+
+	// One batch per used texture in texture order, the instances of a texture keep their order
+	CHECK_EQUAL((size_t)2, batches.size());
+	if (batches.size() == 2 && instances.size() == 5)
+	{
+		CHECK_EQUAL(0u, batches[0].texture);
+		CHECK_EQUAL(0u, batches[0].first);
+		CHECK_EQUAL(2u, batches[0].count);
+		CHECK_EQUAL(2u, batches[1].texture);
+		CHECK_EQUAL(2u, batches[1].first);
+		CHECK_EQUAL(3u, batches[1].count);
+
+		const float expectedOrder[] = { 1, 6, 0, 2, 5 };
+		for (size_t i = 0; i < instances.size(); ++i)
+		{
+			CHECK_EQUAL(expectedOrder[i], instances[i].color.x);
+		}
+	}
+
+	// A new frame starts empty
+	batch.Begin(Identity(), 3);
+	batch.End();
+	CHECK(batch.GetInstances().empty() && batch.GetBatches().empty() && batch.GetCulledCount() == 0);
+}
+
+BENCHMARK(IconBatch_Build)
+{
+	const int lightCount = 100000;
+	mt19937 random(11);
+	uniform_real_distribution<float> position(-2, 2);
+	vector<XMFLOAT3> positions(lightCount);
+	for (auto& x : positions)
+	{
+		x = XMFLOAT3(position(random), position(random), position(random) * 0.5f + 0.5f);
+	}
+
+	IconBatch batch;
+	auto start = chrono::high_resolution_clock::now();
+	batch.Begin(Identity(), 3);
+	for (int i = 0; i < lightCount; ++i)
+	{
+		batch.Add(i % 3, positions[i], 0.05f, XMFLOAT4(1, 1, 1, 1));
+	}
+	batch.End();
+	double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+	stringstream ss;
+	ss << lightCount << " icons: " << ms << " ms, " << batch.GetInstances().size() << " visible in "
+		<< batch.GetBatches().size() << " batches, " << batch.GetCulledCount() << " culled";
+	Tests::Report(ss.str());
+}
@@ -0,0 +1,53 @@
+#include "Tests.h"
+#include "IdleState.h"
+
+TEST(IdleState_IdlesAfterQuietFrames)
+{
+	IdleState state;
+	CHECK(!state.IsIdle());
+	for (uint32_t i = 0; i + 1 < IdleState::idleAfterFrames; ++i)
+	{
+		state.Update(true);
+	}
+	CHECK(!state.IsIdle());
+	// one busy frame starts the count over
+	state.Update(false);
+	for (uint32_t i = 0; i + 1 < IdleState::idleAfterFrames; ++i)
+	{
+		state.Update(true);
+	}
+	CHECK(!state.IsIdle());
+	state.Update(true);
+	CHECK(state.IsIdle());
+	state.Update(true);
+	CHECK(state.IsIdle());
+
+	state.Wake();
+	CHECK(!state.IsIdle());
+}
+
+// The frame after a wait runs one update, whether the wait timed out or a message ended it, and only that one
+TEST(IdleState_FrameAfterWaitDoesNotCatchUp)
+{
+	IdleState state;
+	CHECK(!state.ConsumeWait());
+	for (uint32_t i = 0; i < IdleState::idleAfterFrames; ++i)
+	{
+		state.Update(true);
+	}
+	CHECK(state.IsIdle());
+
+	// timed out: still idle, the timer frame doesn't catch up
+	state.Waited();
+	CHECK(state.IsIdle());
+	CHECK(state.ConsumeWait());
+	CHECK(!state.ConsumeWait());
+
+	// a message: awake, the next frame doesn't catch up either
+	state.Waited();
+	state.Wake();
+	CHECK(!state.IsIdle());
+	CHECK(state.ConsumeWait());
+	state.Update(false);
+	CHECK(!state.ConsumeWait());
+}
@@ -0,0 +1,266 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "LoadingPipeline.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+namespace
+{
+	// Synthetic texture of the benchmark: the read stage fills the top mip, decoding builds the mip chain
+	struct Texture
+	{
+		uint32_t index;
+		vector<uint32_t> texels;
+	};
+	const uint32_t textureSize = 64;
+
+	Texture* ReadTexture(uint32_t index)
+	{
+		Texture* texture = new Texture;
+		texture->index = index;
+		texture->texels.resize(textureSize * textureSize);
+		uint32_t state = index * 2654435761u + 1;
+		for (auto& x : texture->texels)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			x = state;
+		}
+		return texture;
+	}
+	void DecodeTexture(Texture* texture)
+	{
+		size_t offset = 0;
+		for (uint32_t size = textureSize; size > 1; size /= 2)
+		{
+			uint32_t half = size / 2;
+			size_t next = texture->texels.size();
+			texture->texels.resize(next + half * half);
+			for (uint32_t y = 0; y < half; ++y)
+			{
+				for (uint32_t x = 0; x < half; ++x)
+				{
+					uint32_t sum[4] = {};
+					for (uint32_t i = 0; i < 4; ++i)
+					{
+						uint32_t texel = texture->texels[offset + (y * 2 + i / 2) * size + x * 2 + i % 2];
+						for (uint32_t c = 0; c < 4; ++c)
+						{
+							sum[c] += (texel >> (c * 8)) & 0xFF;
+						}
+					}
+					uint32_t texel = 0;
+					for (uint32_t c = 0; c < 4; ++c)
+					{
+						texel |= (sum[c] / 4) << (c * 8);
+					}
+					texture->texels[next + y * half + x] = texel;
+				}
+			}
+			offset = next;
+		}
+	}
+	// Stands in for the resource creation on the main thread
+	uint64_t CreateTexture(Texture* texture)
+	{
+		uint64_t checksum = texture->index;
+		for (auto& x : texture->texels)
+		{
+			checksum = checksum * 31 + x;
+		}
+		delete texture;
+		return checksum;
+	}
+}
+
+TEST(BoundedQueue_OrderAndClose)
+{
+	BoundedQueue<int> queue(4);
+	for (int i = 0; i < 4; ++i)
+	{
+		CHECK(queue.Push(i));
+	}
+	int x = -1;
+	CHECK(queue.TryPop(x));
+	CHECK_EQUAL(0, x);
+	queue.Close();
+	CHECK(!queue.Push(10));
+	// what was pushed before closing can still be popped
+	for (int i = 1; i < 4; ++i)
+	{
+		CHECK(queue.Pop(x));
+		CHECK_EQUAL(i, x);
+	}
+	CHECK(!queue.Pop(x));
+	CHECK(!queue.TryPop(x));
+
+	queue.Reset(2);
+	CHECK(queue.Push(5));
+	CHECK(queue.Pop(x));
+	CHECK_EQUAL(5, x);
+}
+
+// Cancelling the loader: nothing that was queued reaches a consumer, a blocked producer gives up
+TEST(BoundedQueue_AbortDropsTheItems)
+{
+	BoundedQueue<int> queue(2);
+	atomic<bool> pushed(true);
+	thread producer([&] {
+		for (int i = 0; i < 3; ++i)
+		{
+			pushed = queue.Push(i);
+		}
+	});
+	this_thread::sleep_for(chrono::milliseconds(50));
+	deque<int> dropped = queue.Abort();
+	producer.join();
+	CHECK_EQUAL(2u, dropped.size());
+	CHECK_EQUAL(0, dropped.front());
+	CHECK(!pushed.load());
+	int x = -1;
+	CHECK(!queue.Pop(x));
+	CHECK(!queue.TryPop(x));
+}
+
+TEST(BoundedQueue_FullQueueBlocksProducer)
+{
+	BoundedQueue<int> queue(2);
+	atomic<int> pushed(0);
+	thread producer([&] {
+		for (int i = 0; i < 3; ++i)
+		{
+			queue.Push(i);
+			pushed++;
+		}
+	});
+	this_thread::sleep_for(chrono::milliseconds(50));
+	CHECK_EQUAL(2, pushed.load());
+	int x = -1;
+	CHECK(queue.Pop(x));
+	producer.join();
+	CHECK_EQUAL(3, pushed.load());
+}
+
+TEST(BoundedQueue_ManyProducersManyConsumers)
+{
+	const int producerCount = 8, consumerCount = 4, itemCount = 20000;
+	BoundedQueue<int> queue(16);
+	atomic<int> producersRunning(producerCount);
+	vector<thread> producers, consumers;
+	vector<int> counts(producerCount * itemCount, 0);
+	atomic<int> popped(0);
+	for (int p = 0; p < producerCount; ++p)
+	{
+		producers.push_back(thread([&, p] {
+			for (int i = 0; i < itemCount; ++i)
+			{
+				queue.Push(p * itemCount + i);
+			}
+			if (--producersRunning == 0)
+			{
+				queue.Close();
+			}
+		}));
+	}
+	for (int c = 0; c < consumerCount; ++c)
+	{
+		consumers.push_back(thread([&] {
+			int x;
+			while (queue.Pop(x))
+			{
+				// every item is popped by exactly one consumer, the slots don't overlap
+				counts[x]++;
+				popped++;
+			}
+		}));
+	}
+	for (auto& x : producers)
+	{
+		x.join();
+	}
+	for (auto& x : consumers)
+	{
+		x.join();
+	}
+	CHECK_EQUAL(producerCount * itemCount, popped.load());
+	bool once = true;
+	for (auto& x : counts)
+	{
+		once = once && x == 1;
+	}
+	CHECK(once);
+}
+
+// The stages of PackageLoader over a synthetic scene of 10k textures: one read thread, decoders on the
+//	rest of the cores, creation on the calling thread, against the same work done serially
+BENCHMARK(LoadingPipeline_10kTextures)
+{
+	const uint32_t textureCount = 10000;
+
+	auto start = chrono::high_resolution_clock::now();
+	uint64_t serialChecksum = 0;
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		Texture* texture = ReadTexture(i);
+		DecodeTexture(texture);
+		serialChecksum ^= CreateTexture(texture);
+	}
+	double serialMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+	start = chrono::high_resolution_clock::now();
+	uint32_t cores = thread::hardware_concurrency();
+	uint32_t decoders = cores > 1 ? cores - 1 : 1;
+	BoundedQueue<Texture*> readQueue(decoders * 2), decodedQueue(decoders * 2);
+	atomic<uint32_t> decodersRunning(decoders);
+	thread reader([&] {
+		for (uint32_t i = 0; i < textureCount; ++i)
+		{
+			readQueue.Push(ReadTexture(i));
+		}
+		readQueue.Close();
+	});
+	vector<thread> decodeThreads;
+	for (uint32_t i = 0; i < decoders; ++i)
+	{
+		decodeThreads.push_back(thread([&] {
+			Texture* texture;
+			while (readQueue.Pop(texture))
+			{
+				DecodeTexture(texture);
+				decodedQueue.Push(texture);
+			}
+			if (--decodersRunning == 0)
+			{
+				decodedQueue.Close();
+			}
+		}));
+	}
+	uint64_t pipelineChecksum = 0;
+	uint32_t created = 0;
+	Texture* texture;
+	while (decodedQueue.Pop(texture))
+	{
+		pipelineChecksum ^= CreateTexture(texture);
+		created++;
+	}
+	reader.join();
+	for (auto& x : decodeThreads)
+	{
+		x.join();
+	}
+	double pipelineMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+	CHECK_EQUAL(textureCount, created);
+	CHECK_EQUAL(serialChecksum, pipelineChecksum);
+
+	stringstream ss("");
+	ss << textureCount << " textures of " << textureSize << "x" << textureSize << ": serial " << serialMs << " ms, pipeline "
+		<< pipelineMs << " ms with " << decoders << " decoders (" << serialMs / pipelineMs << "x)";
+	Tests::Report(ss.str());
+}
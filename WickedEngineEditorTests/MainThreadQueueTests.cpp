@@ -0,0 +1,136 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "MainThreadQueue.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+using namespace std;
+
+TEST(MainThreadQueue_RunsInPostOrder)
+{
+	MainThreadQueue queue;
+	vector<int> order;
+	for (int i = 0; i < 5; ++i)
+	{
+		queue.Post([&order, i] { order.push_back(i); });
+	}
+	// tasks posted by a task run in the same drain
+	queue.Post([&] { queue.Post([&] { order.push_back(5); }); });
+	CHECK_EQUAL(7u, queue.Drain());
+	CHECK_EQUAL(6u, order.size());
+	for (int i = 0; i < (int)order.size(); ++i)
+	{
+		CHECK_EQUAL(i, order[i]);
+	}
+	CHECK_EQUAL(0u, queue.Drain());
+}
+
+// Many producers hammer the queue while the consumer drains it like the main loop does: every task
+//	runs exactly once, and the tasks of one producer run in the order they were posted
+TEST(MainThreadQueue_ManyProducersStress)
+{
+	const int producerCount = 16, taskCount = 20000;
+	MainThreadQueue queue;
+	atomic<int> wakeups(0);
+	queue.SetWakeup([&] { wakeups++; });
+
+	// only the consumer touches these, from inside the tasks
+	vector<int> nextExpected(producerCount, 0);
+	int outOfOrder = 0, run = 0;
+
+	atomic<int> producersRunning(producerCount);
+	vector<thread> producers;
+	for (int p = 0; p < producerCount; ++p)
+	{
+		producers.push_back(thread([&, p] {
+			for (int i = 0; i < taskCount; ++i)
+			{
+				queue.Post([&, p, i] {
+					if (nextExpected[p] != i)
+					{
+						outOfOrder++;
+					}
+					nextExpected[p] = i + 1;
+					run++;
+				});
+			}
+			producersRunning--;
+		}));
+	}
+
+	size_t drained = 0;
+	while (producersRunning.load() > 0)
+	{
+		drained += queue.Drain();
+	}
+	for (auto& x : producers)
+	{
+		x.join();
+	}
+	drained += queue.Drain();
+
+	CHECK_EQUAL((size_t)producerCount * taskCount, drained);
+	CHECK_EQUAL(producerCount * taskCount, run);
+	CHECK_EQUAL(0, outOfOrder);
+	CHECK_EQUAL(producerCount * taskCount, wakeups.load());
+	for (auto& x : nextExpected)
+	{
+		CHECK_EQUAL(taskCount, x);
+	}
+}
+
+// Tasks that are never drained are freed with the queue
+TEST(MainThreadQueue_DestroyedWithPendingTasks)
+{
+	auto counter = make_shared<int>(0);
+	{
+		MainThreadQueue queue;
+		for (int i = 0; i < 100; ++i)
+		{
+			queue.Post([counter] { (*counter)++; });
+		}
+		CHECK_EQUAL(101, (int)counter.use_count());
+	}
+	CHECK_EQUAL(1, (int)counter.use_count());
+	CHECK_EQUAL(0, *counter);
+}
+
+BENCHMARK(MainThreadQueue_PostsPerSecond)
+{
+	const int producerCount = 8, taskCount = 100000;
+	MainThreadQueue queue;
+	atomic<int> producersRunning(producerCount);
+	int run = 0;
+
+	auto start = chrono::high_resolution_clock::now();
+	vector<thread> producers;
+	for (int p = 0; p < producerCount; ++p)
+	{
+		producers.push_back(thread([&] {
+			for (int i = 0; i < taskCount; ++i)
+			{
+				queue.Post([&] { run++; });
+			}
+			producersRunning--;
+		}));
+	}
+	while (producersRunning.load() > 0)
+	{
+		queue.Drain();
+	}
+	for (auto& x : producers)
+	{
+		x.join();
+	}
+	queue.Drain();
+	double seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+	CHECK_EQUAL(producerCount * taskCount, run);
+	stringstream ss("");
+	ss << producerCount << " producers: " << (int)(run / seconds) << " tasks per second posted and run";
+	Tests::Report(ss.str());
+}
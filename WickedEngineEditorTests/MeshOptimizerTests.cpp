@@ -0,0 +1,106 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "MeshOptimizer.h"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+using namespace DirectX;
+
+namespace
+{
+	// Grid of size x size quads on the xz plane, the triangles shuffled like an exporter that doesn't care
+	void MakeShuffledGrid(uint32_t size, vector<XMFLOAT3>& positions, vector<uint32_t>& indices)
+	{
+		positions.clear();
+		for (uint32_t z = 0; z <= size; ++z)
+		{
+			for (uint32_t x = 0; x <= size; ++x)
+			{
+				positions.push_back(XMFLOAT3((float)x, 0, (float)z));
+			}
+		}
+		vector<uint32_t> triangles;
+		for (uint32_t z = 0; z < size; ++z)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				uint32_t i0 = z * (size + 1) + x, i1 = i0 + 1, i2 = i0 + size + 1, i3 = i2 + 1;
+				uint32_t quad[] = { i0, i2, i1, i1, i2, i3 };
+				triangles.insert(triangles.end(), quad, quad + 6);
+			}
+		}
+		vector<size_t> order(triangles.size() / 3);
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			order[i] = i;
+		}
+		shuffle(order.begin(), order.end(), mt19937(42));
+		indices.clear();
+		for (auto& x : order)
+		{
+			indices.insert(indices.end(), triangles.begin() + x * 3, triangles.begin() + x * 3 + 3);
+		}
+	}
+}
+
+TEST(MeshOptimizer_IsSameTopology)
+{
+	vector<uint32_t> before = { 0, 1, 2, 2, 1, 3 };
+	vector<uint32_t> none;
+
+	CHECK(MeshOptimizer::IsSameTopology(before, before, none));
+	// other triangle order, and a triangle rotated: same winding
+	CHECK(MeshOptimizer::IsSameTopology(before, { 1, 3, 2, 1, 2, 0 }, none));
+	// flipped winding
+	CHECK(!MeshOptimizer::IsSameTopology(before, { 0, 2, 1, 2, 1, 3 }, none));
+	// a different triangle, and a triangle missing
+	CHECK(!MeshOptimizer::IsSameTopology(before, { 0, 1, 2, 2, 1, 4 }, none));
+	CHECK(!MeshOptimizer::IsSameTopology(before, { 0, 1, 2 }, none));
+	// the same triangle twice doesn't stand in for an other one
+	CHECK(!MeshOptimizer::IsSameTopology(before, { 0, 1, 2, 0, 1, 2 }, none));
+	// not triangles
+	CHECK(!MeshOptimizer::IsSameTopology({ 0, 1, 2, 3 }, { 0, 1, 2, 3 }, none));
+
+	// renumbered vertices: old i is new remap[i]
+	vector<uint32_t> remap = { 1, 2, 3, 0 };
+	CHECK(MeshOptimizer::IsSameTopology(before, { 3, 2, 0, 1, 2, 3 }, remap));
+	CHECK(!MeshOptimizer::IsSameTopology(before, before, remap));
+}
+
+// The whole pass on one list: the triangles are only reordered and renumbered, and the cache does better
+TEST(MeshOptimizer_PassKeepsTheTopology)
+{
+	vector<XMFLOAT3> positions;
+	vector<uint32_t> original;
+	MakeShuffledGrid(64, positions, original);
+
+	vector<uint32_t> indices = original;
+	MeshOptimizer::OptimizeVertexCache(indices, positions.size());
+	CHECK(MeshOptimizer::IsSameTopology(original, indices, vector<uint32_t>()));
+	MeshOptimizer::OptimizeOverdraw(indices, positions.data(), positions.size());
+	CHECK(MeshOptimizer::IsSameTopology(original, indices, vector<uint32_t>()));
+
+	MeshOptimizer::Statistics before = MeshOptimizer::AnalyzeVertexCache(original, positions.size());
+	MeshOptimizer::Statistics after = MeshOptimizer::AnalyzeVertexCache(indices, positions.size());
+	CHECK(after.acmr < before.acmr);
+	CHECK_EQUAL(before.triangleCount, after.triangleCount);
+
+	vector<uint32_t> renumbered = indices;
+	vector<vector<uint32_t>*> lists = { &renumbered };
+	vector<uint32_t> remap = MeshOptimizer::OptimizeVertexFetch(lists, positions.size());
+	CHECK_EQUAL(positions.size(), remap.size());
+	CHECK(MeshOptimizer::IsSameTopology(original, renumbered, remap));
+	CHECK(!MeshOptimizer::IsSameTopology(original, renumbered, vector<uint32_t>()));
+	// the vertices are used in order
+	uint32_t next = 0;
+	bool ordered = true;
+	for (auto& x : renumbered)
+	{
+		ordered = ordered && x <= next;
+		next = max(next, x + 1);
+	}
+	CHECK(ordered);
+}
@@ -0,0 +1,105 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "MeshSimplifier.h"
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+
+using namespace std;
+using namespace DirectX;
+
+namespace
+{
+	// Bumpy sphere of rings x segments quads, as one subset. The bumps keep the simplifier from
+	//	collapsing everything for free, like on a real scanned or sculpted mesh.
+	void MakeSphere(uint32_t rings, uint32_t segments, vector<XMFLOAT3>& positions, MeshSimplifier::SubsetIndices& subsets)
+	{
+		const float pi = 3.14159265f;
+		positions.clear();
+		for (uint32_t r = 0; r <= rings; ++r)
+		{
+			float theta = pi * r / rings;
+			for (uint32_t s = 0; s <= segments; ++s)
+			{
+				float phi = 2 * pi * s / segments;
+				float radius = 1 + 0.05f * sinf(theta * 7) * cosf(phi * 5);
+				positions.push_back(XMFLOAT3(radius * sinf(theta) * cosf(phi), radius * cosf(theta), radius * sinf(theta) * sinf(phi)));
+			}
+		}
+		subsets.assign(1, vector<uint32_t>());
+		for (uint32_t r = 0; r < rings; ++r)
+		{
+			for (uint32_t s = 0; s < segments; ++s)
+			{
+				uint32_t i0 = r * (segments + 1) + s, i1 = i0 + 1, i2 = i0 + segments + 1, i3 = i2 + 1;
+				uint32_t quad[] = { i0, i2, i1, i1, i2, i3 };
+				subsets[0].insert(subsets[0].end(), quad, quad + 6);
+			}
+		}
+	}
+}
+
+TEST(MeshSimplifier_ChainHalvesTheTriangles)
+{
+	vector<XMFLOAT3> positions;
+	MeshSimplifier::SubsetIndices subsets;
+	MakeSphere(64, 128, positions, subsets);
+	size_t triangles = MeshSimplifier::CountTriangles(subsets);
+
+	vector<MeshSimplifier::Level> levels;
+	MeshSimplifier::BuildChain(positions.data(), positions.size(), subsets, 4, levels);
+	CHECK_EQUAL(4u, levels.size());
+	CHECK(levels[0].subsetIndices == subsets);
+	CHECK_EQUAL(0.0f, levels[0].error);
+	for (size_t l = 1; l < levels.size(); ++l)
+	{
+		CHECK(levels[l].triangleCount <= triangles >> l);
+		CHECK(levels[l].error >= levels[l - 1].error);
+		// only the indices change, they reference the original vertices
+		bool valid = levels[l].subsetIndices.size() == 1 && levels[l].subsetIndices[0].size() % 3 == 0;
+		for (auto& x : levels[l].subsetIndices[0])
+		{
+			valid = valid && x < positions.size();
+		}
+		CHECK(valid);
+	}
+	// half of the triangles of a smooth sphere go without moving the surface much
+	CHECK(levels[1].error < 0.05f);
+}
+
+TEST(MeshSimplifier_StopsAtTheErrorLimit)
+{
+	vector<XMFLOAT3> positions;
+	MeshSimplifier::SubsetIndices subsets;
+	MakeSphere(32, 64, positions, subsets);
+
+	MeshSimplifier::SubsetIndices result;
+	float error = MeshSimplifier::Simplify(positions.data(), positions.size(), subsets, 0, 0.01f, result);
+	CHECK(error <= 0.01f);
+	size_t triangles = MeshSimplifier::CountTriangles(result);
+	CHECK(triangles > 0);
+	CHECK(triangles < MeshSimplifier::CountTriangles(subsets));
+}
+
+// Triangles removed per second by one thread, the LOD build runs one mesh per core
+BENCHMARK(MeshSimplifier_TrianglesPerSecond)
+{
+	vector<XMFLOAT3> positions;
+	MeshSimplifier::SubsetIndices subsets;
+	MakeSphere(256, 512, positions, subsets);
+	size_t triangles = MeshSimplifier::CountTriangles(subsets);
+
+	auto start = chrono::high_resolution_clock::now();
+	MeshSimplifier::SubsetIndices result;
+	MeshSimplifier::Simplify(positions.data(), positions.size(), subsets, triangles / 8, FLT_MAX, result);
+	double seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+	size_t remaining = MeshSimplifier::CountTriangles(result);
+	CHECK(remaining <= triangles / 8);
+
+	stringstream ss("");
+	ss << triangles << " triangles to " << remaining << " in " << seconds * 1000 << " ms: " << (int)(triangles / seconds)
+		<< " input triangles per second";
+	Tests::Report(ss.str());
+}
@@ -0,0 +1,199 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "PickingBVH.h"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+
+using namespace std;
+using namespace DirectX;
+
+namespace
+{
+	// A scattered scene of small and a few large boxes, like props and buildings
+	vector<PickingBVH::Box> MakeBoxes(size_t count, mt19937& random)
+	{
+		uniform_real_distribution<float> position(-500, 500);
+		uniform_real_distribution<float> size(0.2f, 4.0f);
+		vector<PickingBVH::Box> boxes(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			XMFLOAT3 center(position(random), position(random) * 0.1f, position(random));
+			float extent = size(random) * (i % 100 == 0 ? 10 : 1);
+			boxes[i].min = XMFLOAT3(center.x - extent, center.y - extent, center.z - extent);
+			boxes[i].max = XMFLOAT3(center.x + extent, center.y + extent, center.z + extent);
+		}
+		return boxes;
+	}
+
+	// Linear scan over every box, what the engine's picking does before the triangle tests
+	void BruteForceRaycast(const vector<PickingBVH::Box>& boxes, const XMFLOAT3& origin, const XMFLOAT3& direction, vector<uint32_t>& hits)
+	{
+		hits.clear();
+		const float o[] = { origin.x, origin.y, origin.z };
+		const float d[] = { direction.x, direction.y, direction.z };
+		for (size_t i = 0; i < boxes.size(); ++i)
+		{
+			const float bmin[] = { boxes[i].min.x, boxes[i].min.y, boxes[i].min.z };
+			const float bmax[] = { boxes[i].max.x, boxes[i].max.y, boxes[i].max.z };
+			float enter = 0, exit = FLT_MAX;
+			for (int a = 0; a < 3; ++a)
+			{
+				float t0 = (bmin[a] - o[a]) / d[a];
+				float t1 = (bmax[a] - o[a]) / d[a];
+				enter = max(enter, min(t0, t1));
+				exit = min(exit, max(t0, t1));
+			}
+			if (exit >= enter)
+			{
+				hits.push_back((uint32_t)i);
+			}
+		}
+	}
+
+	void RandomRay(mt19937& random, XMFLOAT3& origin, XMFLOAT3& direction)
+	{
+		uniform_real_distribution<float> position(-600, 600);
+		uniform_real_distribution<float> unit(-1, 1);
+		origin = XMFLOAT3(position(random), 50, position(random));
+		XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(unit(random), unit(random) - 0.5f, unit(random), 0)));
+	}
+
+	bool SameHits(const vector<PickingBVH::Hit>& bvhHits, vector<uint32_t> expected)
+	{
+		vector<uint32_t> items;
+		for (size_t i = 0; i < bvhHits.size(); ++i)
+		{
+			items.push_back(bvhHits[i].item);
+			if (i > 0 && bvhHits[i - 1].distance > bvhHits[i].distance)
+			{
+				return false;
+			}
+		}
+		sort(items.begin(), items.end());
+		sort(expected.begin(), expected.end());
+		return items == expected;
+	}
+}
+
+TEST(PickingBVH_RaycastMatchesBruteForce)
+{
+	mt19937 random(8);
+	vector<PickingBVH::Box> boxes = MakeBoxes(5000, random);
+	PickingBVH bvh;
+	bvh.Build(boxes);
+
+	vector<PickingBVH::Hit> hits;
+	vector<uint32_t> expected;
+	for (int i = 0; i < 500; ++i)
+	{
+		XMFLOAT3 origin, direction;
+		RandomRay(random, origin, direction);
+		bvh.Raycast(origin, direction, hits);
+		BruteForceRaycast(boxes, origin, direction, expected);
+		CHECK(SameHits(hits, expected));
+	}
+
+	// Move every box, the refitted hierarchy has to give the same answers
+	for (auto& x : boxes)
+	{
+		x.min.x += 3;
+		x.max.x += 3;
+		x.max.y += 1;
+	}
+	CHECK(bvh.Refit(boxes));
+	for (int i = 0; i < 500; ++i)
+	{
+		XMFLOAT3 origin, direction;
+		RandomRay(random, origin, direction);
+		bvh.Raycast(origin, direction, hits);
+		BruteForceRaycast(boxes, origin, direction, expected);
+		CHECK(SameHits(hits, expected));
+	}
+	boxes.pop_back();
+	CHECK(!bvh.Refit(boxes));
+}
+
+TEST(PickingBVH_QueryMatchesBruteForce)
+{
+	mt19937 random(9);
+	vector<PickingBVH::Box> boxes = MakeBoxes(5000, random);
+	PickingBVH bvh;
+	bvh.Build(boxes);
+
+	// An axis aligned slab region, every box that touches it must be reported
+	XMFLOAT4 planes[] = {
+		XMFLOAT4(1, 0, 0, 100),		// x >= -100
+		XMFLOAT4(-1, 0, 0, 50),		// x <= 50
+		XMFLOAT4(0, 0, 1, 200),		// z >= -200
+		XMFLOAT4(0, 0, -1, -20),	// z <= -20
+	};
+	vector<uint32_t> result;
+	bvh.Query(planes, _countof(planes), result);
+
+	vector<uint32_t> expected;
+	for (size_t i = 0; i < boxes.size(); ++i)
+	{
+		if (boxes[i].max.x >= -100 && boxes[i].min.x <= 50 && boxes[i].max.z >= -200 && boxes[i].min.z <= -20)
+		{
+			expected.push_back((uint32_t)i);
+		}
+	}
+	sort(result.begin(), result.end());
+	CHECK(!expected.empty());
+	CHECK(result == expected);
+}
+
+// Picks per second of the hierarchy against scanning every box, at 100k objects
+BENCHMARK(PickingBVH_PicksPerSecond)
+{
+	mt19937 random(10);
+	vector<PickingBVH::Box> boxes = MakeBoxes(100000, random);
+
+	auto start = chrono::high_resolution_clock::now();
+	PickingBVH bvh;
+	bvh.Build(boxes);
+	double buildTime = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+	start = chrono::high_resolution_clock::now();
+	bvh.Refit(boxes);
+	double refitTime = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+	const int rayCount = 2000;
+	vector<XMFLOAT3> origins(rayCount), directions(rayCount);
+	for (int i = 0; i < rayCount; ++i)
+	{
+		RandomRay(random, origins[i], directions[i]);
+	}
+
+	vector<PickingBVH::Hit> hits;
+	size_t hitCount = 0;
+	start = chrono::high_resolution_clock::now();
+	for (int i = 0; i < rayCount; ++i)
+	{
+		bvh.Raycast(origins[i], directions[i], hits);
+		hitCount += hits.size();
+	}
+	double bvhTime = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+	vector<uint32_t> bruteHits;
+	size_t bruteCount = 0;
+	const int bruteRayCount = rayCount / 10;
+	start = chrono::high_resolution_clock::now();
+	for (int i = 0; i < bruteRayCount; ++i)
+	{
+		BruteForceRaycast(boxes, origins[i], directions[i], bruteHits);
+		bruteCount += bruteHits.size();
+	}
+	double bruteTime = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+	CHECK(hitCount > 0 && bruteCount > 0);
+
+	stringstream ss;
+	ss << "100k boxes: build " << buildTime << " ms, refit " << refitTime << " ms";
+	Tests::Report(ss.str());
+	ss.str("");
+	ss << "bvh: " << (int)(rayCount / bvhTime) << " picks/s, linear scan: " << (int)(bruteRayCount / bruteTime) << " picks/s";
+	Tests::Report(ss.str());
+}
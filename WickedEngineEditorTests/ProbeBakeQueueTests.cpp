@@ -0,0 +1,119 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "ProbeBakeQueue.h"
+
+#include <vector>
+#include <chrono>
+
+using namespace std;
+using namespace DirectX;
+
+namespace
+{
+	// Stands in for the renderer: a bake takes a fixed time per cube face texel, probes that were
+	//	forgotten by the scene are skipped the way the editor's bake function skips them
+	struct StubRenderer
+	{
+		double secondsPerTexel = 0;
+		vector<float> baked;	// x of the baked positions, in order
+		vector<void*> removed;
+
+		bool Bake(const ProbeBakeQueue::Request& request)
+		{
+			for (auto& x : removed)
+			{
+				if (x == request.replaces)
+				{
+					return false;
+				}
+			}
+			auto start = chrono::steady_clock::now();
+			double seconds = secondsPerTexel * 6.0 * request.resolution * request.resolution;
+			while (chrono::duration<double>(chrono::steady_clock::now() - start).count() < seconds)
+			{
+			}
+			baked.push_back(request.position.x);
+			return true;
+		}
+	};
+}
+
+TEST(ProbeBakeQueue_NewProbesBeforeStaleOnes)
+{
+	StubRenderer renderer;
+	ProbeBakeQueue queue;
+	queue.SetBakeFunction([&](const ProbeBakeQueue::Request& request) { return renderer.Bake(request); });
+
+	int probes[3];
+	queue.PushStale(XMFLOAT3(10, 0, 0), 16, &probes[0]);
+	queue.Push(XMFLOAT3(1, 0, 0), 16);
+	queue.PushStale(XMFLOAT3(11, 0, 0), 16, &probes[1]);
+	// a second rebake of the same probe only updates the waiting one
+	queue.PushStale(XMFLOAT3(10, 0, 0), 32, &probes[0]);
+	queue.Push(XMFLOAT3(2, 0, 0), 16);
+	CHECK_EQUAL(4u, queue.GetPendingCount());
+	CHECK_EQUAL(4u, queue.GetTotalCount());
+
+	CHECK_EQUAL(4u, queue.Update(1000.0f));
+	CHECK(queue.IsEmpty());
+	vector<float> expected = { 1, 2, 10, 11 };
+	CHECK(renderer.baked == expected);
+	// the counts restart when the queue runs empty
+	CHECK_EQUAL(0u, queue.GetTotalCount());
+	CHECK_EQUAL(0u, queue.GetCompletedCount());
+}
+
+TEST(ProbeBakeQueue_ForgetDropsTheRebake)
+{
+	StubRenderer renderer;
+	ProbeBakeQueue queue;
+	queue.SetBakeFunction([&](const ProbeBakeQueue::Request& request) { return renderer.Bake(request); });
+
+	int probes[2];
+	queue.PushStale(XMFLOAT3(10, 0, 0), 16, &probes[0]);
+	queue.PushStale(XMFLOAT3(11, 0, 0), 16, &probes[1]);
+	queue.Forget(&probes[0]);
+	CHECK_EQUAL(1u, queue.GetPendingCount());
+	CHECK_EQUAL(1u, queue.GetTotalCount());
+
+	// a probe that is gone without being forgotten is skipped by the bake function
+	renderer.removed.push_back(&probes[1]);
+	CHECK_EQUAL(0u, queue.Update(1000.0f));
+	CHECK(renderer.baked.empty());
+	CHECK(queue.IsEmpty());
+}
+
+TEST(ProbeBakeQueue_BakesWithinTheBudget)
+{
+	StubRenderer renderer;
+	renderer.secondsPerTexel = 0.002 / (6.0 * 32 * 32);	// 2 ms per 32x32 probe
+	ProbeBakeQueue queue;
+	queue.SetBakeFunction([&](const ProbeBakeQueue::Request& request) { return renderer.Bake(request); });
+
+	// without an estimate only the first bake of the frame runs, it measures the cost
+	for (int i = 0; i < 10; ++i)
+	{
+		queue.Push(XMFLOAT3((float)i, 0, 0), 32);
+	}
+	CHECK_EQUAL(1u, queue.Update(0.0f));
+	CHECK_EQUAL(1u, queue.GetCompletedCount());
+	CHECK_EQUAL(10u, queue.GetTotalCount());
+
+	// 2 ms bakes in a 7 ms budget: three fit, the fourth would go over
+	uint32_t baked = queue.Update(0.007f);
+	CHECK(baked >= 2 && baked <= 3);
+
+	// a probe that is bigger than the budget still gets baked, alone
+	queue.Clear();
+	queue.Push(XMFLOAT3(100, 0, 0), 128);
+	queue.Push(XMFLOAT3(101, 0, 0), 32);
+	CHECK_EQUAL(1u, queue.Update(0.001f));
+	CHECK_EQUAL(100.0f, renderer.baked.back());
+	CHECK_EQUAL(1u, queue.GetPendingCount());
+
+	// no renderer, no bakes
+	ProbeBakeQueue unbound;
+	unbound.Push(XMFLOAT3(0, 0, 0), 32);
+	CHECK_EQUAL(0u, unbound.Update(1000.0f));
+	CHECK_EQUAL(1u, unbound.GetPendingCount());
+}
@@ -0,0 +1,143 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "SceneIndex.h"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+	void CollectSubtree(Transform* node, vector<Transform*>& nodes)
+	{
+		nodes.push_back(node);
+		for (auto& x : node->children)
+		{
+			CollectSubtree(x, nodes);
+		}
+	}
+	// Unlinks the nodes first, so their destructors don't touch each other
+	void DeleteSubtree(Transform* node)
+	{
+		vector<Transform*> nodes;
+		CollectSubtree(node, nodes);
+		node->detach();
+		for (auto& x : nodes)
+		{
+			x->parent = nullptr;
+			x->children.clear();
+		}
+		for (auto& x : nodes)
+		{
+			delete x;
+		}
+	}
+}
+
+// Random edits through the same calls the editor makes, the index is checked against a walk of the
+//	tree after every step
+TEST(SceneIndex_RandomizedEdits)
+{
+	// Under the world node, so that lookups on a miss can find the nodes that were added unreported
+	Transform* root = new Transform;
+	root->attachTo(wiRenderer::GetScene().GetWorldNode());
+
+	SceneIndex index;
+	index.Add(root);
+	vector<Transform*> live(1, root);
+	mt19937 random(7);
+
+	for (int step = 0; step < 3000; ++step)
+	{
+		uint32_t action = random() % 10;
+		Transform* target = live[random() % live.size()];
+		if (action < 5)
+		{
+			// Add, like wiRenderer::Add() followed by SceneIndex::Add()
+			Transform* node = new Transform;
+			node->attachTo(target);
+			index.Add(node);
+			live.push_back(node);
+		}
+		else if (action < 7 && target != root)
+		{
+			// Delete a subtree, like a delete whose tombstone was discarded
+			vector<Transform*> subtree;
+			CollectSubtree(target, subtree);
+			index.Remove(target);
+			for (auto& x : subtree)
+			{
+				live.erase(find(live.begin(), live.end(), x));
+			}
+			DeleteSubtree(target);
+		}
+		else if (action < 9 && target != root)
+		{
+			// Reparent, like the translator does with the selection, the IDs don't change
+			Transform* newParent = live[random() % live.size()];
+			vector<Transform*> subtree;
+			CollectSubtree(target, subtree);
+			if (find(subtree.begin(), subtree.end(), newParent) == subtree.end())
+			{
+				target->detach();
+				target->attachTo(newParent);
+			}
+		}
+		else
+		{
+			// Added by a script, the index only hears about it on the first lookup
+			Transform* node = new Transform;
+			node->attachTo(target);
+			live.push_back(node);
+			CHECK(index.Find(node->GetID()) == node);
+		}
+
+		CHECK(index.Verify(root));
+		CHECK_EQUAL(live.size(), index.GetCount());
+		if (!index.Verify(root) || live.size() != index.GetCount())
+		{
+			break;
+		}
+	}
+
+	for (auto& x : live)
+	{
+		CHECK(index.Find(x->GetID()) == x);
+	}
+
+	DeleteSubtree(root);
+}
+
+// A model freed by the engine (unload, ClearWorld) is not reported, its nodes must not be handed out
+TEST(SceneIndex_ModelUnloadedBehindTheEditorsBack)
+{
+	wiRenderer::Scene& scene = wiRenderer::GetScene();
+	Model* model = new Model;
+	model->attachTo(scene.GetWorldNode());
+	scene.models.push_back(model);
+	Transform* node = new Transform;
+	node->attachTo(model);
+	uint64_t modelID = model->GetID(), nodeID = node->GetID();
+
+	SceneIndex index;
+	index.Rebuild(scene.GetWorldNode());
+	CHECK(index.Find(nodeID) == node);
+
+	// a model added later is found through the tree
+	Model* added = new Model;
+	added->attachTo(scene.GetWorldNode());
+	scene.models.push_back(added);
+	CHECK(index.Find(added->GetID()) == added);
+
+	scene.models.erase(scene.models.begin());
+	DeleteSubtree(model);
+	CHECK(index.Find(nodeID) == nullptr);
+	CHECK(index.Find(modelID) == nullptr);
+	CHECK(index.Find(added->GetID()) == added);
+	CHECK(index.Verify(scene.GetWorldNode()));
+
+	scene.models.clear();
+	DeleteSubtree(added);
+}
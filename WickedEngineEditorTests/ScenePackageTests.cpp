@@ -0,0 +1,252 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "ScenePackage.h"
+
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+using namespace std;
+
+namespace
+{
+	// Meshes in groups of three that share a material, enough vertices for a few model chunks, and an
+	//	object without a mesh and a light for the entities chunk
+	Model* CreateScene(size_t meshCount, size_t vertexCount)
+	{
+		Model* model = new Model;
+		Material* material = nullptr;
+		for (size_t i = 0; i < meshCount; ++i)
+		{
+			stringstream ss("");
+			ss << i;
+			if (i % 3 == 0)
+			{
+				material = new Material("material" + ss.str());
+				material->baseColor = XMFLOAT3((float)i, 0.5f, 0.25f);
+			}
+			Mesh* mesh = new Mesh("mesh" + ss.str());
+			mesh->vertices.resize(vertexCount);
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				mesh->vertices[v].pos = XMFLOAT4((float)v, (float)i, (float)(v % 7), 0);
+			}
+			mesh->subsets.push_back(MeshSubset());
+			mesh->subsets.back().material = material;
+			for (size_t v = 0; v + 2 < vertexCount; v += 3)
+			{
+				mesh->subsets.back().subsetIndices.push_back((uint32_t)v);
+				mesh->subsets.back().subsetIndices.push_back((uint32_t)v + 1);
+				mesh->subsets.back().subsetIndices.push_back((uint32_t)v + 2);
+			}
+			mesh->materialNames.push_back(material->name);
+
+			Object* object = new Object("object" + ss.str());
+			object->mesh = mesh;
+			object->meshfile = mesh->name;
+			object->translation_rest = XMFLOAT3((float)i, 0, 0);
+			model->Add(object);
+		}
+		model->Add(new Object("empty"));
+		model->Add(new Light);
+		return model;
+	}
+
+	// Every entity of the chunk models is moved into one model, in chunk order
+	Model* MergeChunks(vector<Model*>& chunks)
+	{
+		Model* model = new Model;
+		for (auto& x : chunks)
+		{
+			for (auto& y : x->objects)
+			{
+				model->Add(y);
+			}
+			for (auto& y : x->lights)
+			{
+				model->Add(y);
+			}
+			for (auto& y : x->decals)
+			{
+				model->Add(y);
+			}
+			x->objects.clear();
+			x->lights.clear();
+			x->decals.clear();
+			x->meshes.clear();
+			x->materials.clear();
+			SAFE_DELETE(x);
+		}
+		chunks.clear();
+		return model;
+	}
+
+	bool ReadBytes(const string& fileName, vector<char>& data)
+	{
+		ifstream file(fileName, ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+		return true;
+	}
+}
+
+TEST(ScenePackage_RoundTripIsBitExact)
+{
+	const int editorVersion = 1;
+	vector<uint8_t> lodData;
+	for (int i = 0; i < 1000; ++i)
+	{
+		lodData.push_back((uint8_t)(i * 31));
+	}
+
+	Model* scene = CreateScene(40, 4 * 1024);
+	CHECK(ScenePackage::Write(scene, "temp/roundtrip.wimf", editorVersion, lodData));
+	SAFE_DELETE(scene);
+
+	ScenePackage::Reader reader;
+	CHECK(reader.Open("temp/roundtrip.wimf", editorVersion));
+	// 160k vertices make three model chunks, then the entities and the LOD chains
+	CHECK_EQUAL(5u, reader.GetChunkCount());
+	vector<Model*> chunks;
+	for (uint32_t i = 0; i < reader.GetChunkCount(); ++i)
+	{
+		if (reader.GetChunk(i).type == ScenePackage::CHUNK_LODS)
+		{
+			vector<uint8_t> data;
+			CHECK(reader.ReadChunk(i, data));
+			CHECK(data == lodData);
+			continue;
+		}
+		Model* model = reader.LoadChunk(i);
+		CHECK(model != nullptr);
+		if (model != nullptr)
+		{
+			chunks.push_back(model);
+		}
+	}
+	reader.Close();
+	CHECK_EQUAL(4u, chunks.size());
+
+	Model* loaded = MergeChunks(chunks);
+	CHECK_EQUAL(41u, loaded->objects.size());
+	CHECK_EQUAL(40u, loaded->meshes.size());
+	CHECK_EQUAL(14u, loaded->materials.size());
+	CHECK_EQUAL(1u, loaded->lights.size());
+	CHECK(ScenePackage::Write(loaded, "temp/roundtrip2.wimf", editorVersion, lodData));
+	SAFE_DELETE(loaded);
+
+	vector<char> first, second;
+	CHECK(ReadBytes("temp/roundtrip.wimf", first));
+	CHECK(ReadBytes("temp/roundtrip2.wimf", second));
+	CHECK(!first.empty());
+	CHECK(first == second);
+
+	remove("temp/roundtrip.wimf");
+	remove("temp/roundtrip2.wimf");
+}
+
+TEST(ScenePackage_CorruptedChunkIsSkipped)
+{
+	const int editorVersion = 1;
+	Model* scene = CreateScene(3, 300);
+	CHECK(ScenePackage::Write(scene, "temp/corrupted.wimf", editorVersion));
+	SAFE_DELETE(scene);
+
+	ScenePackage::Header header;
+	vector<ScenePackage::ChunkEntry> toc;
+	{
+		fstream file("temp/corrupted.wimf", ios::binary | ios::in | ios::out);
+		file.read((char*)&header, sizeof(header));
+		CHECK_EQUAL(2u, header.chunkCount);
+		toc.resize(header.chunkCount);
+		file.read((char*)toc.data(), sizeof(ScenePackage::ChunkEntry) * toc.size());
+		// flip a byte in the middle of the first chunk
+		file.seekg(toc[0].offset + toc[0].size / 2);
+		char c = 0;
+		file.read(&c, 1);
+		c = ~c;
+		file.seekp(toc[0].offset + toc[0].size / 2);
+		file.write(&c, 1);
+	}
+
+	ScenePackage::Reader reader;
+	CHECK(reader.Open("temp/corrupted.wimf", editorVersion));
+	CHECK(reader.LoadChunk(0) == nullptr);
+	Model* entities = reader.LoadChunk(1);
+	CHECK(entities != nullptr);
+	SAFE_DELETE(entities);
+	// a newer file format is refused
+	reader.Close();
+	{
+		fstream file("temp/corrupted.wimf", ios::binary | ios::in | ios::out);
+		header.formatVersion = ScenePackage::FORMAT_VERSION + 1;
+		file.write((const char*)&header, sizeof(header));
+	}
+	CHECK(!reader.Open("temp/corrupted.wimf", editorVersion));
+
+	remove("temp/corrupted.wimf");
+}
+
+// Parent links are restored by name inside one chunk: a light under a meshed object of the last
+//	model chunk, a meshed object and a decal under an empty transform, and the meshes and materials
+//	that nothing uses must all come back
+TEST(ScenePackage_HierarchiesStayInOneChunk)
+{
+	const int editorVersion = 1;
+	Model* scene = CreateScene(40, 4 * 1024);
+	Light* light = new Light("lamp");
+	light->parentName = "object39";
+	scene->Add(light);
+	scene->Add(new Object("root"));
+	for (auto& x : scene->objects)
+	{
+		if (x->name == "object0")
+		{
+			x->parentName = "root";
+		}
+	}
+	Decal* decal = new Decal("sticker");
+	decal->parentName = "root";
+	scene->Add(decal);
+	Mesh* spare = new Mesh("spare");
+	spare->subsets.push_back(MeshSubset());
+	spare->subsets.back().material = new Material("spareMaterial");
+	spare->materialNames.push_back("spareMaterial");
+	scene->meshes[spare->name] = spare;
+	scene->materials["spareMaterial"] = spare->subsets.back().material;
+	scene->materials["loose"] = new Material("loose");
+
+	CHECK(ScenePackage::Write(scene, "temp/hierarchy.wimf", editorVersion));
+	SAFE_DELETE(scene);
+
+	vector<Model*> chunks;
+	CHECK(ScenePackage::Read("temp/hierarchy.wimf", editorVersion, chunks));
+	CHECK(chunks.size() > 2);
+	size_t linked = 0, unlinked = 0, meshes = 0, materials = 0;
+	for (auto& x : chunks)
+	{
+		vector<Transform*> entities(x->objects.begin(), x->objects.end());
+		entities.insert(entities.end(), x->lights.begin(), x->lights.end());
+		entities.insert(entities.end(), x->decals.begin(), x->decals.end());
+		for (auto& y : entities)
+		{
+			if (!y->parentName.empty())
+			{
+				(y->parent != nullptr ? linked : unlinked)++;
+			}
+		}
+		meshes += x->meshes.size();
+		materials += x->materials.size();
+		SAFE_DELETE(x);
+	}
+	CHECK_EQUAL(3u, linked);
+	CHECK_EQUAL(0u, unlinked);
+	CHECK_EQUAL(41u, meshes);
+	CHECK_EQUAL(16u, materials);
+
+	remove("temp/hierarchy.wimf");
+}
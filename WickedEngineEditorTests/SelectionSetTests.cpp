@@ -0,0 +1,172 @@
+#include "stdafx.h"
+#include "Tests.h"
+#include "SelectionSet.h"
+
+#include <list>
+#include <vector>
+#include <random>
+#include <chrono>
+
+using namespace std;
+
+namespace
+{
+	wiRenderer::Picked* MakePick(Transform* transform)
+	{
+		wiRenderer::Picked* picked = new wiRenderer::Picked;
+		picked->transform = transform;
+		return picked;
+	}
+
+	double MillisecondsSince(const chrono::high_resolution_clock::time_point& start)
+	{
+		return chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+TEST(SelectionSet_AddRemoveFind)
+{
+	Transform parent;
+	const int count = 100;
+	Transform* transforms = new Transform[count];
+	for (int i = 0; i < count; ++i)
+	{
+		transforms[i].attachTo(&parent);
+	}
+
+	SelectionSet selection;
+	for (int i = 0; i < count; ++i)
+	{
+		CHECK(selection.Add(MakePick(&transforms[i])));
+	}
+	wiRenderer::Picked* duplicate = MakePick(&transforms[0]);
+	CHECK(!selection.Add(duplicate));
+	SAFE_DELETE(duplicate);
+	CHECK_EQUAL((size_t)count, selection.size());
+
+	// Removing from the middle moves the last one into the hole, the index has to follow it
+	mt19937 random(5);
+	vector<bool> selectedFlags(count, true);
+	for (int step = 0; step < 1000; ++step)
+	{
+		int i = random() % count;
+		uint64_t version = selection.GetVersion();
+		if (selectedFlags[i])
+		{
+			CHECK(selection.Remove(transforms[i].GetID()));
+		}
+		else
+		{
+			CHECK(selection.Add(MakePick(&transforms[i])));
+		}
+		selectedFlags[i] = !selectedFlags[i];
+		CHECK(selection.GetVersion() != version);
+	}
+	size_t expected = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		CHECK_EQUAL((bool)selectedFlags[i], selection.Contains(transforms[i].GetID()));
+		expected += selectedFlags[i] ? 1 : 0;
+	}
+	CHECK_EQUAL(expected, selection.size());
+	for (size_t i = 0; i < selection.size(); ++i)
+	{
+		CHECK(selection.Find(selection[i]->transform->GetID()) == selection[i]);
+		CHECK(selection.GetSavedParent(i) == &parent);
+	}
+
+	selection.Clear();
+	CHECK(selection.empty());
+	delete[] transforms;
+}
+
+// The shift-click toggle and the per-light selection test of the old std::list<Picked*> against the
+//	set, with 50k selected transforms
+BENCHMARK(SelectionSet_VersusList)
+{
+	const int count = 50000;
+	const int lookups = 2000;
+	Transform* transforms = new Transform[count];
+	mt19937 random(6);
+	vector<uint64_t> queries(lookups);
+	for (auto& x : queries)
+	{
+		x = transforms[random() % count].GetID();
+	}
+
+	{
+		auto start = chrono::high_resolution_clock::now();
+		list<wiRenderer::Picked*> selectedList;
+		for (int i = 0; i < count; ++i)
+		{
+			selectedList.push_back(MakePick(&transforms[i]));
+		}
+		double addTime = MillisecondsSince(start);
+
+		start = chrono::high_resolution_clock::now();
+		size_t found = 0;
+		for (auto& id : queries)
+		{
+			for (auto& x : selectedList)
+			{
+				if (x->transform->GetID() == id)
+				{
+					found++;
+					break;
+				}
+			}
+		}
+		double lookupTime = MillisecondsSince(start);
+
+		start = chrono::high_resolution_clock::now();
+		size_t sum = 0;
+		for (auto& x : selectedList)
+		{
+			sum += (size_t)x->transform->GetID();
+		}
+		double iterateTime = MillisecondsSince(start);
+		CHECK(found == lookups && sum != 0);
+
+		stringstream ss;
+		ss << "list: add " << addTime << " ms, " << lookups << " lookups " << lookupTime << " ms, iterate " << iterateTime << " ms";
+		Tests::Report(ss.str());
+		for (auto& x : selectedList)
+		{
+			SAFE_DELETE(x);
+		}
+	}
+
+	{
+		auto start = chrono::high_resolution_clock::now();
+		SelectionSet selection;
+		for (int i = 0; i < count; ++i)
+		{
+			selection.Add(MakePick(&transforms[i]));
+		}
+		double addTime = MillisecondsSince(start);
+
+		start = chrono::high_resolution_clock::now();
+		size_t found = 0;
+		for (auto& id : queries)
+		{
+			found += selection.Contains(id) ? 1 : 0;
+		}
+		double lookupTime = MillisecondsSince(start);
+
+		start = chrono::high_resolution_clock::now();
+		size_t sum = 0;
+		for (auto& x : selection)
+		{
+			sum += (size_t)x->transform->GetID();
+		}
+		double iterateTime = MillisecondsSince(start);
+		CHECK(found == lookups && sum != 0);
+
+		stringstream ss;
+		ss << "set:  add " << addTime << " ms, " << lookups << " lookups " << lookupTime << " ms, iterate " << iterateTime << " ms";
+		Tests::Report(ss.str());
+		selection.Clear();
+	}
+
+	delete[] transforms;
+}
@@ -0,0 +1,93 @@
+#include "Tests.h"
+
+#include <vector>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+namespace Tests
+{
+	struct Case
+	{
+		const char* name;
+		Function function;
+		bool benchmark;
+	};
+
+	// Function local, the registrars run during static initialization
+	vector<Case>& GetCases()
+	{
+		static vector<Case> cases;
+		return cases;
+	}
+
+	int failureCount = 0;
+
+	Registrar::Registrar(const char* name, Function function, bool benchmark)
+	{
+		Case x;
+		x.name = name;
+		x.function = function;
+		x.benchmark = benchmark;
+		GetCases().push_back(x);
+	}
+
+	void Fail(const char* file, int line, const string& message)
+	{
+		cout << "    FAILED " << file << "(" << line << "): " << message << endl;
+		failureCount++;
+	}
+	void Report(const string& line)
+	{
+		cout << "    " << line << endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool benchmarks = false;
+	vector<string> filters;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-bench") == 0)
+		{
+			benchmarks = true;
+		}
+		else
+		{
+			filters.push_back(argv[i]);
+		}
+	}
+
+	int runCount = 0, failedCount = 0;
+	for (auto& x : Tests::GetCases())
+	{
+		if (x.benchmark && !benchmarks)
+		{
+			continue;
+		}
+		bool match = filters.empty();
+		for (auto& y : filters)
+		{
+			match = match || strstr(x.name, y.c_str()) != nullptr;
+		}
+		if (!match)
+		{
+			continue;
+		}
+
+		cout << x.name << endl;
+		int failuresBefore = Tests::failureCount;
+		auto start = chrono::high_resolution_clock::now();
+		x.function();
+		double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+		bool passed = Tests::failureCount == failuresBefore;
+		cout << "    " << (passed ? "ok" : "FAILED") << " (" << ms << " ms)" << endl;
+		runCount++;
+		failedCount += passed ? 0 : 1;
+	}
+
+	cout << endl << runCount << " cases, " << failedCount << " failed" << endl;
+	return failedCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <sstream>
+#include <iostream>
+
+// Minimal test runner for the editor modules, none of the cases needs a graphics device
+//	TEST() cases always run, BENCHMARK() cases only with -bench. A name on the command line runs only
+//	the cases whose name contains it.
+namespace Tests
+{
+	typedef void(*Function)();
+
+	struct Registrar
+	{
+		Registrar(const char* name, Function function, bool benchmark);
+	};
+
+	void Fail(const char* file, int line, const std::string& message);
+	// Benchmarks print their results through this, one line per measurement
+	void Report(const std::string& line);
+}
+
+#define TEST(name) \
+	static void name(); \
+	static Tests::Registrar name##_registrar(#name, name, false); \
+	static void name()
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static Tests::Registrar name##_registrar(#name, name, true); \
+	static void name()
+
+#define CHECK(condition) \
+	if (!(condition)) \
+	{ \
+		Tests::Fail(__FILE__, __LINE__, #condition); \
+	}
+
+#define CHECK_EQUAL(expected, actual) \
+	if (!((expected) == (actual))) \
+	{ \
+		std::stringstream ss; \
+		ss << #actual << " is " << (actual) << ", expected " << (expected); \
+		Tests::Fail(__FILE__, __LINE__, ss.str()); \
+	}